@@ -45,6 +45,16 @@ CREATE UNIQUE INDEX ag_label_name_graph_index ON ag_label USING btree (name, gra
 CREATE UNIQUE INDEX ag_label_graph_oid_index ON ag_label USING btree (graph, id);
 CREATE UNIQUE INDEX ag_label_relation_index ON ag_label USING btree (relation);
 
+-- filled in by analyze_graph(), the degree columns are NULL for vertex labels
+CREATE TABLE ag_label_stats (graph oid NOT NULL, id label_id, row_count bigint NOT NULL, avg_out_degree float8, max_out_degree bigint, avg_in_degree float8, max_in_degree bigint);
+
+CREATE UNIQUE INDEX ag_label_stats_graph_id_index ON ag_label_stats USING btree (graph, id);
+
+-- number of edges of an edge label per (start vertex label, end vertex label)
+CREATE TABLE ag_label_endpoint_stats (graph oid NOT NULL, id label_id, start_label_id label_id, end_label_id label_id, row_count bigint NOT NULL);
+
+CREATE UNIQUE INDEX ag_label_endpoint_stats_graph_id_index ON ag_label_endpoint_stats USING btree (graph, id, start_label_id, end_label_id);
+
 --
 -- catalog lookup functions
 --
@@ -53,11 +63,13 @@ CREATE FUNCTION _label_id(graph_name name, label_name name) RETURNS label_id LAN
 --
 -- utility functions
 --
-CREATE FUNCTION create_graph(graph_name name) RETURNS void LANGUAGE c AS 'MODULE_PATHNAME';
-CREATE FUNCTION create_graph_if_not_exists(graph_name name) RETURNS void LANGUAGE c AS 'MODULE_PATHNAME';
+CREATE FUNCTION create_graph(graph_name name, partitioned boolean = false) RETURNS void LANGUAGE c AS 'MODULE_PATHNAME';
+CREATE FUNCTION create_graph_if_not_exists(graph_name name, partitioned boolean = false) RETURNS void LANGUAGE c AS 'MODULE_PATHNAME';
 CREATE FUNCTION drop_graph(graph_name name, cascade boolean = false) RETURNS void LANGUAGE c AS 'MODULE_PATHNAME';
+CREATE FUNCTION analyze_graph(graph_name name) RETURNS void LANGUAGE c AS 'MODULE_PATHNAME';
+CREATE FUNCTION cluster_graph(graph_name name) RETURNS void LANGUAGE c AS 'MODULE_PATHNAME';
 CREATE FUNCTION create_vlabel(graph_name name, label_name name) RETURNS void LANGUAGE c AS 'MODULE_PATHNAME';
-CREATE FUNCTION create_elabel(graph_name name, label_name name) RETURNS void LANGUAGE c AS 'MODULE_PATHNAME';
+CREATE FUNCTION create_elabel(graph_name name, label_name name, partitions int = 0) RETURNS void LANGUAGE c AS 'MODULE_PATHNAME';
 CREATE FUNCTION alter_graph(graph_name name, operation cstring, new_value name) RETURNS void LANGUAGE c AS 'MODULE_PATHNAME';
 CREATE FUNCTION drop_label(graph_name name, label_name name, force boolean = false) RETURNS void LANGUAGE c AS 'MODULE_PATHNAME';
 
@@ -102,7 +114,7 @@ CREATE FUNCTION graphid_btree_sort(internal) RETURNS void LANGUAGE c IMMUTABLE R
 -- define operator classes for graphid
 --
 CREATE OPERATOR CLASS graphid_ops DEFAULT FOR TYPE graphid USING btree AS OPERATOR 1 <, OPERATOR 2 <=, OPERATOR 3 =, OPERATOR 4 >=, OPERATOR 5 >,
-FUNCTION 1 graphid_btree_cmp (graphid, graphid), FUNCTION 2 graphid_btree_sort (internal);
+FUNCTION 1 graphid_btree_cmp (graphid, graphid), FUNCTION 2 graphid_btree_sort (internal), FUNCTION 4 btequalimage (oid);
 
 --
 -- graphid functions
@@ -146,11 +158,12 @@ CREATE OPERATOR <> (FUNCTION = vertex_ne, LEFTARG = vertex, RIGHTARG = vertex, C
 --
 -- vertex - access operators (->, ->> )
 --
-CREATE FUNCTION vertex_property_access(vertex, text) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE FUNCTION vertex_accessor_support(internal) RETURNS internal LANGUAGE c IMMUTABLE STRICT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE FUNCTION vertex_property_access(vertex, text) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE SUPPORT vertex_accessor_support AS 'MODULE_PATHNAME';
 CREATE OPERATOR -> (LEFTARG = vertex, RIGHTARG = text, FUNCTION = vertex_property_access);
-CREATE FUNCTION vertex_property_access_gtype(vertex, gtype) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE FUNCTION vertex_property_access_gtype(vertex, gtype) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE SUPPORT vertex_accessor_support AS 'MODULE_PATHNAME';
 CREATE OPERATOR -> (LEFTARG = vertex, RIGHTARG = gtype, FUNCTION = vertex_property_access_gtype);
-CREATE FUNCTION vertex_property_access_text(vertex, text) RETURNS text LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE FUNCTION vertex_property_access_text(vertex, text) RETURNS text LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE SUPPORT vertex_accessor_support AS 'MODULE_PATHNAME';
 CREATE OPERATOR ->> (LEFTARG = vertex, RIGHTARG = text, FUNCTION = vertex_property_access_text);
 
 
@@ -165,20 +178,21 @@ CREATE OPERATOR <@ (LEFTARG = gtype, RIGHTARG = vertex, FUNCTION = vertex_contai
 --
 -- vertex - key existence operators (?, ?|, ?&)
 --
-CREATE FUNCTION vertex_exists(vertex, text) RETURNS boolean LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE FUNCTION vertex_exists_support(internal) RETURNS internal LANGUAGE c IMMUTABLE STRICT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE FUNCTION vertex_exists(vertex, text) RETURNS boolean LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE SUPPORT vertex_exists_support AS 'MODULE_PATHNAME';
 CREATE OPERATOR ? (LEFTARG = vertex, RIGHTARG = text, FUNCTION = vertex_exists, COMMUTATOR = '?', RESTRICT = contsel, JOIN = contjoinsel);
-CREATE FUNCTION vertex_exists_any(vertex, text[]) RETURNS boolean LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE FUNCTION vertex_exists_any(vertex, text[]) RETURNS boolean LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE SUPPORT vertex_exists_support AS 'MODULE_PATHNAME';
 CREATE OPERATOR ?| (LEFTARG = vertex, RIGHTARG = text[], FUNCTION = vertex_exists_any, RESTRICT = contsel, JOIN = contjoinsel);
-CREATE FUNCTION vertex_exists_all(vertex, text[]) RETURNS boolean LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE FUNCTION vertex_exists_all(vertex, text[]) RETURNS boolean LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE SUPPORT vertex_exists_support AS 'MODULE_PATHNAME';
 CREATE OPERATOR ?& (LEFTARG = vertex, RIGHTARG = text[], FUNCTION = vertex_exists_all, RESTRICT = contsel, JOIN = contjoinsel);
 
 --
 -- vertex functions
 --
-CREATE FUNCTION id(vertex) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME', 'vertex_id';
+CREATE FUNCTION id(vertex) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE SUPPORT vertex_accessor_support AS 'MODULE_PATHNAME', 'vertex_id';
 CREATE FUNCTION label(vertex) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME', 'vertex_label';
-CREATE FUNCTION properties(vertex) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME', 'vertex_properties';
-CREATE FUNCTION age_properties(vertex) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME', 'vertex_properties';
+CREATE FUNCTION properties(vertex) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE SUPPORT vertex_accessor_support AS 'MODULE_PATHNAME', 'vertex_properties';
+CREATE FUNCTION age_properties(vertex) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE SUPPORT vertex_accessor_support AS 'MODULE_PATHNAME', 'vertex_properties';
 
 --
 -- edge
@@ -192,7 +206,8 @@ CREATE FUNCTION build_edge(graphid, graphid, graphid, oid, gtype) RETURNS edge L
 CREATE TYPE edge (INPUT = edge_in, OUTPUT = edge_out, LIKE = jsonb);
 
 
-CREATE FUNCTION edge_property_access_gtype(edge, gtype) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE FUNCTION edge_accessor_support(internal) RETURNS internal LANGUAGE c IMMUTABLE STRICT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE FUNCTION edge_property_access_gtype(edge, gtype) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE SUPPORT edge_accessor_support AS 'MODULE_PATHNAME';
 CREATE OPERATOR -> (LEFTARG = edge, RIGHTARG = gtype, FUNCTION = edge_property_access_gtype);
 
 
@@ -207,12 +222,12 @@ CREATE OPERATOR <> (FUNCTION = edge_ne, LEFTARG = edge, RIGHTARG = edge, COMMUTA
 --
 -- edge functions
 --
-CREATE FUNCTION id(edge) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME', 'edge_id';
-CREATE FUNCTION start_id(edge) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME', 'edge_start_id';
-CREATE FUNCTION end_id(edge) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME', 'edge_end_id';
+CREATE FUNCTION id(edge) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE SUPPORT edge_accessor_support AS 'MODULE_PATHNAME', 'edge_id';
+CREATE FUNCTION start_id(edge) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE SUPPORT edge_accessor_support AS 'MODULE_PATHNAME', 'edge_start_id';
+CREATE FUNCTION end_id(edge) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE SUPPORT edge_accessor_support AS 'MODULE_PATHNAME', 'edge_end_id';
 CREATE FUNCTION label(edge) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME', 'edge_label';
-CREATE FUNCTION properties(edge) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME', 'edge_properties';
-CREATE FUNCTION age_properties(edge) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME', 'edge_properties';
+CREATE FUNCTION properties(edge) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE SUPPORT edge_accessor_support AS 'MODULE_PATHNAME', 'edge_properties';
+CREATE FUNCTION age_properties(edge) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE SUPPORT edge_accessor_support AS 'MODULE_PATHNAME', 'edge_properties';
 
 --
 -- path
@@ -225,6 +240,32 @@ CREATE FUNCTION build_traversal(variadic "any") RETURNS traversal LANGUAGE c IMM
 
 CREATE TYPE traversal (INPUT = traversal_in, OUTPUT = traversal_out, LIKE = jsonb);
 
+--
+-- traversal - comparison operators (=, <>, <, >, <=, >=)
+--
+CREATE FUNCTION traversal_eq(traversal, traversal) RETURNS boolean LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE OPERATOR = (FUNCTION = traversal_eq, LEFTARG = traversal, RIGHTARG = traversal, COMMUTATOR = =, NEGATOR = <>, RESTRICT = eqsel, JOIN = eqjoinsel, HASHES, MERGES);
+CREATE FUNCTION traversal_ne(traversal, traversal) RETURNS boolean LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE OPERATOR <> (FUNCTION = traversal_ne, LEFTARG = traversal, RIGHTARG = traversal, COMMUTATOR = <>, NEGATOR = =, RESTRICT = neqsel, JOIN = neqjoinsel);
+CREATE FUNCTION traversal_lt(traversal, traversal) RETURNS boolean LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE OPERATOR < (FUNCTION = traversal_lt, LEFTARG = traversal, RIGHTARG = traversal, COMMUTATOR = >, NEGATOR = >=, RESTRICT = scalarltsel, JOIN = scalarltjoinsel);
+CREATE FUNCTION traversal_gt(traversal, traversal) RETURNS boolean LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE OPERATOR > (FUNCTION = traversal_gt, LEFTARG = traversal, RIGHTARG = traversal, COMMUTATOR = <, NEGATOR = <=, RESTRICT = scalargtsel, JOIN = scalargtjoinsel);
+CREATE FUNCTION traversal_le(traversal, traversal) RETURNS boolean LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE OPERATOR <= (FUNCTION = traversal_le, LEFTARG = traversal, RIGHTARG = traversal, COMMUTATOR = >=, NEGATOR = >, RESTRICT = scalarlesel, JOIN = scalarlejoinsel);
+CREATE FUNCTION traversal_ge(traversal, traversal) RETURNS boolean LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE OPERATOR >= (FUNCTION = traversal_ge, LEFTARG = traversal, RIGHTARG = traversal, COMMUTATOR = <=, NEGATOR = <, RESTRICT = scalargesel, JOIN = scalargejoinsel);
+
+--
+-- traversal - btree and hash operator classes, on the graphids only
+--
+CREATE FUNCTION traversal_btree_cmp(traversal, traversal) RETURNS int LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE OPERATOR CLASS traversal_ops DEFAULT FOR TYPE traversal USING btree AS OPERATOR 1 <, OPERATOR 2 <=, OPERATOR 3 =, OPERATOR 4 >=, OPERATOR 5 >,
+FUNCTION 1 traversal_btree_cmp (traversal, traversal);
+CREATE FUNCTION traversal_hash_cmp(traversal) RETURNS INTEGER LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE FUNCTION traversal_hash_extended(traversal, int8) RETURNS int8 LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE OPERATOR CLASS traversal_ops_hash DEFAULT FOR TYPE traversal USING hash AS OPERATOR 1 =, FUNCTION 1 traversal_hash_cmp(traversal), FUNCTION 2 traversal_hash_extended(traversal, int8);
+
 --
 -- traversal functions
 --
@@ -261,6 +302,32 @@ CREATE FUNCTION build_variable_edge(variadic "any") RETURNS variable_edge LANGUA
 
 CREATE TYPE variable_edge (INPUT = variable_edge_in, OUTPUT = variable_edge_out, LIKE = jsonb);
 
+--
+-- variable_edge - comparison operators (=, <>, <, >, <=, >=)
+--
+CREATE FUNCTION variable_edge_eq(variable_edge, variable_edge) RETURNS boolean LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE OPERATOR = (FUNCTION = variable_edge_eq, LEFTARG = variable_edge, RIGHTARG = variable_edge, COMMUTATOR = =, NEGATOR = <>, RESTRICT = eqsel, JOIN = eqjoinsel, HASHES, MERGES);
+CREATE FUNCTION variable_edge_ne(variable_edge, variable_edge) RETURNS boolean LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE OPERATOR <> (FUNCTION = variable_edge_ne, LEFTARG = variable_edge, RIGHTARG = variable_edge, COMMUTATOR = <>, NEGATOR = =, RESTRICT = neqsel, JOIN = neqjoinsel);
+CREATE FUNCTION variable_edge_lt(variable_edge, variable_edge) RETURNS boolean LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE OPERATOR < (FUNCTION = variable_edge_lt, LEFTARG = variable_edge, RIGHTARG = variable_edge, COMMUTATOR = >, NEGATOR = >=, RESTRICT = scalarltsel, JOIN = scalarltjoinsel);
+CREATE FUNCTION variable_edge_gt(variable_edge, variable_edge) RETURNS boolean LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE OPERATOR > (FUNCTION = variable_edge_gt, LEFTARG = variable_edge, RIGHTARG = variable_edge, COMMUTATOR = <, NEGATOR = <=, RESTRICT = scalargtsel, JOIN = scalargtjoinsel);
+CREATE FUNCTION variable_edge_le(variable_edge, variable_edge) RETURNS boolean LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE OPERATOR <= (FUNCTION = variable_edge_le, LEFTARG = variable_edge, RIGHTARG = variable_edge, COMMUTATOR = >=, NEGATOR = >, RESTRICT = scalarlesel, JOIN = scalarlejoinsel);
+CREATE FUNCTION variable_edge_ge(variable_edge, variable_edge) RETURNS boolean LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE OPERATOR >= (FUNCTION = variable_edge_ge, LEFTARG = variable_edge, RIGHTARG = variable_edge, COMMUTATOR = <=, NEGATOR = <, RESTRICT = scalargesel, JOIN = scalargejoinsel);
+
+--
+-- variable_edge - btree and hash operator classes, on the graphids only
+--
+CREATE FUNCTION variable_edge_btree_cmp(variable_edge, variable_edge) RETURNS int LANGUAGE c IMMUTABLE RETURNS NULL ON NULL INPUT PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE OPERATOR CLASS variable_edge_ops DEFAULT FOR TYPE variable_edge USING btree AS OPERATOR 1 <, OPERATOR 2 <=, OPERATOR 3 =, OPERATOR 4 >=, OPERATOR 5 >,
+FUNCTION 1 variable_edge_btree_cmp (variable_edge, variable_edge);
+CREATE FUNCTION variable_edge_hash_cmp(variable_edge) RETURNS INTEGER LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE FUNCTION variable_edge_hash_extended(variable_edge, int8) RETURNS int8 LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE OPERATOR CLASS variable_edge_ops_hash DEFAULT FOR TYPE variable_edge USING hash AS OPERATOR 1 =, FUNCTION 1 variable_edge_hash_cmp(variable_edge), FUNCTION 2 variable_edge_hash_extended(variable_edge, int8);
+
 --
 -- gtype - mathematical operators (+, -, *, /, %, ^)
 --
@@ -284,7 +351,8 @@ CREATE OPERATOR ^ (FUNCTION = gtype_pow, LEFTARG = gtype, RIGHTARG = gtype);
 -- graphid - hash operator class
 --
 CREATE FUNCTION graphid_hash_cmp(graphid) RETURNS INTEGER LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME';
-CREATE OPERATOR CLASS graphid_ops_hash DEFAULT FOR TYPE graphid USING hash AS OPERATOR 1 =, FUNCTION 1 graphid_hash_cmp(graphid);
+CREATE FUNCTION graphid_hash_extended(graphid, int8) RETURNS int8 LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME';
+CREATE OPERATOR CLASS graphid_ops_hash DEFAULT FOR TYPE graphid USING hash AS OPERATOR 1 =, FUNCTION 1 graphid_hash_cmp(graphid), FUNCTION 2 graphid_hash_extended(graphid, int8);
 
 --
 -- gtype - comparison operators (=, <>, <, >, <=, >=)
@@ -538,6 +606,9 @@ CREATE FUNCTION keys(edge) RETURNS gtype LANGUAGE c IMMUTABLE RETURNS NULL ON NU
 CREATE FUNCTION range (gtype, gtype) RETURNS gtype LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_range';
 CREATE FUNCTION range (gtype, gtype, gtype) RETURNS gtype LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_range';
 CREATE FUNCTION unnest (gtype, block_types boolean = false) RETURNS SETOF gtype LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_unnest';
+CREATE FUNCTION unnest_range_support (internal) RETURNS internal LANGUAGE c IMMUTABLE STRICT PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_unnest_range_support';
+CREATE FUNCTION unnest_range (gtype, gtype) RETURNS SETOF gtype LANGUAGE c IMMUTABLE PARALLEL SAFE SUPPORT unnest_range_support AS 'MODULE_PATHNAME', 'gtype_unnest_range';
+CREATE FUNCTION unnest_range (gtype, gtype, gtype) RETURNS SETOF gtype LANGUAGE c IMMUTABLE PARALLEL SAFE SUPPORT unnest_range_support AS 'MODULE_PATHNAME', 'gtype_unnest_range';
 
 --
 -- String functions
@@ -585,8 +656,11 @@ CREATE FUNCTION rand () RETURNS gtype LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MOD
 --
 -- Agreggation
 --
--- accumlates floats into an array for aggregation
-CREATE FUNCTION gtype_accum(float8[], gtype) RETURNS float8[] LANGUAGE c IMMUTABLE STRICT PARALLEL SAFE AS 'MODULE_PATHNAME';
+-- accumlates floats for avg(), stdev() and stdevp()
+CREATE FUNCTION float_aggtransfn (internal, gtype) RETURNS internal LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_float_aggtransfn';
+CREATE FUNCTION float_aggcombinefn (internal, internal) RETURNS internal LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_float_aggcombinefn';
+CREATE FUNCTION float_aggserialfn (internal) RETURNS bytea LANGUAGE c IMMUTABLE STRICT PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_float_aggserialfn';
+CREATE FUNCTION float_aggdeserialfn (bytea, internal) RETURNS internal LANGUAGE c IMMUTABLE STRICT PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_float_aggdeserialfn';
 
 -- count
 CREATE AGGREGATE count(*) (stype = int8, sfunc = int8inc, finalfunc = int8_to_gtype, combinefunc = int8pl, finalfunc_modify = READ_ONLY, initcond = 0, parallel = SAFE);
@@ -596,16 +670,22 @@ CREATE AGGREGATE count(edge) (stype = int8, sfunc = int8inc_any, finalfunc = int
 CREATE AGGREGATE count(traversal) (stype = int8, sfunc = int8inc_any, finalfunc = int8_to_gtype, combinefunc = int8pl, finalfunc_modify = READ_ONLY, initcond = 0, parallel = SAFE);
 CREATE AGGREGATE count(variable_edge) (stype = int8, sfunc = int8inc_any, finalfunc = int8_to_gtype, combinefunc = int8pl, finalfunc_modify = READ_ONLY, initcond = 0, parallel = SAFE);
 -- stdev
-CREATE FUNCTION gtype_stddev_samp_final(float8[]) RETURNS gtype LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME';
-CREATE AGGREGATE stdev(gtype) (stype = float8[], sfunc = gtype_accum, finalfunc = gtype_stddev_samp_final, combinefunc = float8_combine, finalfunc_modify = READ_ONLY, initcond = '{0,0,0}', parallel = SAFE);
+CREATE FUNCTION stddev_samp_aggfinalfn (internal) RETURNS gtype LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_stddev_samp_aggfinalfn';
+CREATE AGGREGATE stdev(gtype) (stype = internal, sfunc = float_aggtransfn, finalfunc = stddev_samp_aggfinalfn, combinefunc = float_aggcombinefn, serialfunc = float_aggserialfn, deserialfunc = float_aggdeserialfn, finalfunc_modify = READ_ONLY, parallel = SAFE);
 -- stdevp
-CREATE FUNCTION gtype_stddev_pop_final(float8[]) RETURNS gtype LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME';
-CREATE AGGREGATE stdevp(gtype) (stype = float8[], sfunc = gtype_accum, finalfunc = gtype_stddev_pop_final, combinefunc = float8_combine, finalfunc_modify = READ_ONLY, initcond = '{0,0,0}', parallel = SAFE);
+CREATE FUNCTION stddev_pop_aggfinalfn (internal) RETURNS gtype LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_stddev_pop_aggfinalfn';
+CREATE AGGREGATE stdevp(gtype) (stype = internal, sfunc = float_aggtransfn, finalfunc = stddev_pop_aggfinalfn, combinefunc = float_aggcombinefn, serialfunc = float_aggserialfn, deserialfunc = float_aggdeserialfn, finalfunc_modify = READ_ONLY, parallel = SAFE);
 -- avg
-CREATE AGGREGATE avg(gtype) (stype = float8[], sfunc = gtype_accum, finalfunc = float8_avg, combinefunc = float8_combine, finalfunc_modify = READ_ONLY, initcond = '{0,0,0}', parallel = SAFE);
+CREATE FUNCTION avg_aggfinalfn (internal) RETURNS gtype LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_avg_aggfinalfn';
+CREATE AGGREGATE avg(gtype) (stype = internal, sfunc = float_aggtransfn, finalfunc = avg_aggfinalfn, combinefunc = float_aggcombinefn, serialfunc = float_aggserialfn, deserialfunc = float_aggdeserialfn, finalfunc_modify = READ_ONLY, parallel = SAFE);
 -- sum
 CREATE FUNCTION gtype_sum (gtype, gtype) RETURNS gtype LANGUAGE c IMMUTABLE STRICT PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_gtype_sum';
-CREATE AGGREGATE sum(gtype) (stype = gtype, sfunc = gtype_sum, combinefunc = gtype_sum, finalfunc_modify = READ_ONLY, parallel = SAFE);
+CREATE FUNCTION sum_aggtransfn (internal, gtype) RETURNS internal LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_sum_aggtransfn';
+CREATE FUNCTION sum_aggcombinefn (internal, internal) RETURNS internal LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_sum_aggcombinefn';
+CREATE FUNCTION sum_aggserialfn (internal) RETURNS bytea LANGUAGE c IMMUTABLE STRICT PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_sum_aggserialfn';
+CREATE FUNCTION sum_aggdeserialfn (bytea, internal) RETURNS internal LANGUAGE c IMMUTABLE STRICT PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_sum_aggdeserialfn';
+CREATE FUNCTION sum_aggfinalfn (internal) RETURNS gtype LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_sum_aggfinalfn';
+CREATE AGGREGATE sum(gtype) (stype = internal, sfunc = sum_aggtransfn, finalfunc = sum_aggfinalfn, combinefunc = sum_aggcombinefn, serialfunc = sum_aggserialfn, deserialfunc = sum_aggdeserialfn, finalfunc_modify = READ_ONLY, parallel = SAFE);
 -- max
 CREATE FUNCTION gtype_max_trans(gtype, gtype) RETURNS gtype LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME';
 CREATE AGGREGATE max(gtype) (stype = gtype, sfunc = gtype_max_trans, combinefunc = gtype_max_trans, finalfunc_modify = READ_ONLY, parallel = SAFE);
@@ -616,12 +696,32 @@ CREATE AGGREGATE min(gtype) (stype = gtype, sfunc = gtype_min_trans, combinefunc
 CREATE FUNCTION percentile_aggtransfn (internal, gtype, gtype) RETURNS internal LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_percentile_aggtransfn';
 CREATE FUNCTION percentile_cont_aggfinalfn (internal) RETURNS gtype LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_percentile_cont_aggfinalfn';
 CREATE FUNCTION percentile_disc_aggfinalfn (internal) RETURNS gtype LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_percentile_disc_aggfinalfn';
-CREATE AGGREGATE percentilecont(gtype, gtype) (stype = internal, sfunc = percentile_aggtransfn, finalfunc = percentile_cont_aggfinalfn, parallel = SAFE);
-CREATE AGGREGATE percentiledisc(gtype, gtype) (stype = internal, sfunc = percentile_aggtransfn, finalfunc = percentile_disc_aggfinalfn, parallel = SAFE);
+CREATE FUNCTION percentile_aggcombinefn (internal, internal) RETURNS internal LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_percentile_aggcombinefn';
+CREATE FUNCTION percentile_aggserialfn (internal) RETURNS bytea LANGUAGE c IMMUTABLE STRICT PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_percentile_aggserialfn';
+CREATE FUNCTION percentile_aggdeserialfn (bytea, internal) RETURNS internal LANGUAGE c IMMUTABLE STRICT PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_percentile_aggdeserialfn';
+CREATE AGGREGATE percentilecont(gtype, gtype) (stype = internal, sfunc = percentile_aggtransfn, finalfunc = percentile_cont_aggfinalfn, finalfunc_modify = READ_WRITE, combinefunc = percentile_aggcombinefn, serialfunc = percentile_aggserialfn, deserialfunc = percentile_aggdeserialfn, parallel = SAFE);
+CREATE AGGREGATE percentiledisc(gtype, gtype) (stype = internal, sfunc = percentile_aggtransfn, finalfunc = percentile_disc_aggfinalfn, finalfunc_modify = READ_WRITE, combinefunc = percentile_aggcombinefn, serialfunc = percentile_aggserialfn, deserialfunc = percentile_aggdeserialfn, parallel = SAFE);
+-- percentileApprox
+CREATE FUNCTION percentile_approx_aggtransfn (internal, gtype, gtype) RETURNS internal LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_percentile_approx_aggtransfn';
+CREATE FUNCTION percentile_approx_aggfinalfn (internal) RETURNS gtype LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_percentile_approx_aggfinalfn';
+CREATE FUNCTION percentile_approx_aggcombinefn (internal, internal) RETURNS internal LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_percentile_approx_aggcombinefn';
+CREATE FUNCTION percentile_approx_aggserialfn (internal) RETURNS bytea LANGUAGE c IMMUTABLE STRICT PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_percentile_approx_aggserialfn';
+CREATE FUNCTION percentile_approx_aggdeserialfn (bytea, internal) RETURNS internal LANGUAGE c IMMUTABLE STRICT PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_percentile_approx_aggdeserialfn';
+CREATE AGGREGATE percentileapprox(gtype, gtype) (stype = internal, sfunc = percentile_approx_aggtransfn, finalfunc = percentile_approx_aggfinalfn, combinefunc = percentile_approx_aggcombinefn, serialfunc = percentile_approx_aggserialfn, deserialfunc = percentile_approx_aggdeserialfn, parallel = SAFE);
+-- approx_count_distinct
+CREATE FUNCTION approx_count_distinct_aggtransfn (internal, gtype) RETURNS internal LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_approx_count_distinct_aggtransfn';
+CREATE FUNCTION approx_count_distinct_aggfinalfn (internal) RETURNS gtype LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_approx_count_distinct_aggfinalfn';
+CREATE FUNCTION approx_count_distinct_aggcombinefn (internal, internal) RETURNS internal LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_approx_count_distinct_aggcombinefn';
+CREATE FUNCTION approx_count_distinct_aggserialfn (internal) RETURNS bytea LANGUAGE c IMMUTABLE STRICT PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_approx_count_distinct_aggserialfn';
+CREATE FUNCTION approx_count_distinct_aggdeserialfn (bytea, internal) RETURNS internal LANGUAGE c IMMUTABLE STRICT PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_approx_count_distinct_aggdeserialfn';
+CREATE AGGREGATE approx_count_distinct(gtype) (stype = internal, sfunc = approx_count_distinct_aggtransfn, finalfunc = approx_count_distinct_aggfinalfn, combinefunc = approx_count_distinct_aggcombinefn, serialfunc = approx_count_distinct_aggserialfn, deserialfunc = approx_count_distinct_aggdeserialfn, parallel = SAFE);
 -- collect
 CREATE FUNCTION collect_aggtransfn (internal, gtype) RETURNS internal LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_collect_aggtransfn';
 CREATE FUNCTION collect_aggfinalfn (internal) RETURNS gtype LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_collect_aggfinalfn';
-CREATE AGGREGATE collect(gtype) (stype = internal, sfunc = collect_aggtransfn, finalfunc = collect_aggfinalfn, parallel = safe);
+CREATE FUNCTION collect_aggcombinefn (internal, internal) RETURNS internal LANGUAGE c IMMUTABLE PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_collect_aggcombinefn';
+CREATE FUNCTION collect_aggserialfn (internal) RETURNS bytea LANGUAGE c IMMUTABLE STRICT PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_collect_aggserialfn';
+CREATE FUNCTION collect_aggdeserialfn (bytea, internal) RETURNS internal LANGUAGE c IMMUTABLE STRICT PARALLEL SAFE AS 'MODULE_PATHNAME', 'gtype_collect_aggdeserialfn';
+CREATE AGGREGATE collect(gtype) (stype = internal, sfunc = collect_aggtransfn, finalfunc = collect_aggfinalfn, combinefunc = collect_aggcombinefn, serialfunc = collect_aggserialfn, deserialfunc = collect_aggdeserialfn, parallel = safe);
 
 CREATE FUNCTION vle (IN gtype, IN vertex, IN vertex, IN gtype, IN gtype, IN gtype, IN gtype, IN gtype, OUT edges variable_edge) RETURNS SETOF variable_edge LANGUAGE C STABLE CALLED ON NULL INPUT PARALLEL UNSAFE AS 'MODULE_PATHNAME', 'gtype_vle';
 
@@ -166,12 +166,121 @@ SELECT create_elabel(NULL, 'r');
 SELECT create_vlabel(NULL, NULL);
 SELECT create_elabel(NULL, NULL);
 
+-- analyze_graph()
+SELECT * FROM cypher('g', $$CREATE (a:n), (b:n), (c:m), (a)-[:r]->(b), (a)-[:r]->(c), (b)-[:r]->(a)$$) AS r(a gtype);
+
+SELECT analyze_graph('g');
+
+SELECT l.name, s.row_count, s.avg_out_degree, s.max_out_degree, s.avg_in_degree, s.max_in_degree
+FROM ag_label_stats s JOIN ag_label l ON l.graph = s.graph AND l.id = s.id
+ORDER BY l.kind, s.row_count;
+
+SELECT row_count FROM ag_label_endpoint_stats ORDER BY row_count;
+
+-- the statistics of a label are removed with the label
+SELECT drop_label('g', 'r', false);
+SELECT drop_label('g', 'm', false);
+SELECT drop_label('g', 'n', false);
+
+SELECT count(*) FROM ag_label_stats;
+SELECT count(*) FROM ag_label_endpoint_stats;
+
+SELECT analyze_graph(NULL);
+SELECT analyze_graph('nonexistent_graph');
+
+-- cluster_graph()
+SELECT * FROM cypher('g', $$CREATE (a:n), (b:n), (b)-[:r]->(a), (a)-[:r]->(b)$$) AS r(a gtype);
+
+SELECT cluster_graph('g');
+
+SELECT indexrelid::regclass, indisclustered
+FROM pg_index
+WHERE indrelid = 'g.r'::regclass
+ORDER BY indexrelid::regclass::text;
+
+SELECT * FROM cypher('g', $$MATCH (:n)-[e:r]->(:n) RETURN count(e)$$) AS r(c gtype);
+
+SELECT drop_label('g', 'r', false);
+SELECT drop_label('g', 'n', false);
+
+SELECT cluster_graph(NULL);
+SELECT cluster_graph('nonexistent_graph');
+
+-- create_graph() with declaratively partitioned labels
+SELECT create_graph('partitioned_graph', true);
+SELECT * FROM cypher('partitioned_graph', $$CREATE (:n)-[:e]->(:n), ()$$) AS r(a gtype);
+
+SELECT c.relname, c.relkind, p.relname AS parent, p.relkind AS parent_relkind
+FROM pg_inherits i
+JOIN pg_class c ON c.oid = i.inhrelid
+JOIN pg_class p ON p.oid = i.inhparent
+WHERE c.relnamespace = 'partitioned_graph'::regnamespace AND c.relkind = 'r'
+ORDER BY c.relname;
+
+SELECT * FROM cypher('partitioned_graph', $$MATCH (v) RETURN count(v)$$) AS r(c gtype);
+SELECT * FROM cypher('partitioned_graph', $$MATCH (v:n) RETURN count(v)$$) AS r(c gtype);
+SELECT * FROM cypher('partitioned_graph', $$MATCH (:n)-[e]->(:n) RETURN count(e)$$) AS r(c gtype);
+
+-- SET, DELETE and DETACH DELETE on partitioned labels
+SELECT * FROM cypher('partitioned_graph', $$MATCH (v:n) SET v.i = 1$$) AS r(a gtype);
+SELECT * FROM cypher('partitioned_graph', $$MATCH ()-[e:e]->() SET e.w = 2$$) AS r(a gtype);
+SELECT * FROM cypher('partitioned_graph', $$MATCH (v) WHERE v.i = 1 RETURN count(v)$$) AS r(c gtype);
+SELECT * FROM cypher('partitioned_graph', $$MATCH ()-[e]->() WHERE e.w = 2 RETURN count(e)$$) AS r(c gtype);
+
+SELECT * FROM cypher('partitioned_graph', $$MATCH (v) WHERE v.i IS NULL DELETE v$$) AS r(a gtype);
+SELECT * FROM cypher('partitioned_graph', $$MATCH (v:n)-[]->() DELETE v$$) AS r(a gtype);
+SELECT * FROM cypher('partitioned_graph', $$MATCH (v:n)-[]->() DETACH DELETE v$$) AS r(a gtype);
+SELECT count(*) FROM partitioned_graph._ag_label_vertex;
+SELECT count(*) FROM partitioned_graph._ag_label_edge;
+
+-- edge labels hash partitioned on start_id
+SELECT create_elabel('partitioned_graph', 'big', partitions => 4);
+SELECT c.relname, c.relkind
+FROM pg_inherits i
+JOIN pg_class c ON c.oid = i.inhrelid
+WHERE i.inhparent = 'partitioned_graph.big'::regclass
+ORDER BY c.relname;
+
+-- every label has a single index on id, cloned from the default label
+SELECT c.relname, count(*)
+FROM pg_index i JOIN pg_class c ON c.oid = i.indrelid
+WHERE c.relnamespace = 'partitioned_graph'::regnamespace
+GROUP BY c.relname
+ORDER BY c.relname;
+
+SELECT * FROM cypher('partitioned_graph', $$CREATE (:n)-[:big]->(:n), (:n)-[:big]->(:n), (:n)-[:big]->(:n)$$) AS r(a gtype);
+SELECT * FROM cypher('partitioned_graph', $$MATCH (:n)-[e:big]->(:n) RETURN count(e)$$) AS r(c gtype);
+SELECT count(*) FROM partitioned_graph.big;
+
+-- the edges of a start vertex are looked up in one partition only
+EXPLAIN (COSTS OFF)
+SELECT id FROM partitioned_graph.big WHERE start_id = '844424930131969'::graphid;
+
+SELECT * FROM cypher('partitioned_graph', $$MATCH ()-[e:big]->() DELETE e$$) AS r(a gtype);
+SELECT count(*) FROM partitioned_graph.big;
+
+SELECT create_elabel('g', 'big', partitions => 4);
+SELECT create_elabel('partitioned_graph', 'bigger', partitions => -1);
+
+SET client_min_messages TO WARNING;
+SELECT drop_graph('partitioned_graph', true);
+RESET client_min_messages;
+
 -- create graph IF NOT EXISTS
 SELECT create_graph_if_not_exists('new_g');
 SELECT create_graph_if_not_exists('new_g');
 
 SELECT name, namespace FROM postgraph.ag_graph;
 
+SELECT create_graph_if_not_exists('partitioned_g', true);
+SELECT relname, relkind FROM pg_class
+WHERE relnamespace = 'partitioned_g'::regnamespace AND relkind IN ('r', 'p')
+ORDER BY relname;
+
+SET client_min_messages TO WARNING;
+SELECT drop_graph('partitioned_g', true);
+RESET client_min_messages;
+
 -- dropping the graph
 SELECT drop_graph('new_g', true);
 SELECT drop_graph('g', true);
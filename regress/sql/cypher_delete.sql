@@ -246,6 +246,21 @@ END;
 
 SELECT * FROM cypher('cypher_delete', $$MATCH (u:vertices) RETURN u $$) AS (result vertex);
 
+--
+-- DETACH DELETE through the endpoint indexes of an edge table
+--
+SELECT * FROM cypher('cypher_delete', $$CREATE (a:indexed)-[:ie]->(b:indexed), (b)-[:ie]->(a), (a)-[:ie]->(a), (b)-[:ie]->(:indexed)$$) AS (a gtype);
+CREATE INDEX ON cypher_delete.ie (start_id);
+CREATE INDEX ON cypher_delete.ie (end_id);
+
+--Should Fail
+SELECT * FROM cypher('cypher_delete', $$MATCH (a:indexed)-[:ie]->(a) DELETE a$$) AS (a gtype);
+
+SELECT * FROM cypher('cypher_delete', $$MATCH (a:indexed)-[:ie]->(a) DETACH DELETE a$$) AS (a gtype);
+SELECT * FROM cypher('cypher_delete', $$MATCH ()-[e:ie]->() RETURN count(e)$$) AS (a gtype);
+SELECT * FROM cypher('cypher_delete', $$MATCH (n:indexed) DETACH DELETE n$$) AS (a gtype);
+SELECT * FROM cypher('cypher_delete', $$MATCH ()-[e:ie]->() RETURN count(e)$$) AS (a gtype);
+
 --
 -- Clean up
 --
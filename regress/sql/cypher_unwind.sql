@@ -49,4 +49,34 @@ SELECT * FROM cypher('cypher_unwind', $$
     RETURN a
 $$) as (i gtype);
 
+-- range() is unwound without building the list
+SELECT * FROM cypher('cypher_unwind', $$
+    UNWIND range(1, 5) AS i RETURN i
+$$) as (i gtype);
+
+SELECT * FROM cypher('cypher_unwind', $$
+    UNWIND range(10, 0, -3) AS i RETURN i
+$$) as (i gtype);
+
+SELECT * FROM cypher('cypher_unwind', $$
+    UNWIND range(1, 1000000000) AS i RETURN i LIMIT 3
+$$) as (i gtype);
+
+SELECT * FROM cypher('cypher_unwind', $$
+    UNWIND range(9223372036854775806, 9223372036854775807) AS i RETURN i
+$$) as (i gtype);
+
+SELECT * FROM cypher('cypher_unwind', $$
+    UNWIND range(1, 5, 0) AS i RETURN i
+$$) as (i gtype);
+
+-- unnest_range() also works as a table function
+SELECT * FROM unnest_range(1::int8::gtype, 3::int8::gtype);
+SELECT * FROM unnest_range(3::int8::gtype, 1::int8::gtype, NULL);
+
+-- the planner estimates the rows of unnest_range() from constant arguments
+EXPLAIN SELECT * FROM unnest_range(1::int8::gtype, 1000000::int8::gtype);
+EXPLAIN SELECT * FROM unnest_range(1::int8::gtype, 10::int8::gtype, 3::int8::gtype);
+EXPLAIN SELECT * FROM unnest_range(10::int8::gtype, 1::int8::gtype, (-2)::int8::gtype);
+
 SELECT drop_graph('cypher_unwind', true);
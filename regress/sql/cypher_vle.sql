@@ -278,6 +278,42 @@ SELECT * FROM show_list_use_vle('list01');
 SELECT prepend_node('list01', 'c');
 SELECT * FROM show_list_use_vle('list01');
 
+--
+-- A VLE whose start vertex has a lot more edges than its end vertex is
+-- searched from the end vertex. The paths must come out the same, and in the
+-- same order, as the ones of the equivalent fixed length patterns.
+--
+SELECT create_graph('vle_hub');
+SELECT * FROM cypher('vle_hub', $$
+    CREATE (h:hub)-[:e]->(t:target), (h)-[:e]->(m:mid)-[:e]->(t),
+           (h)-[:e]->(:leaf), (h)-[:e]->(:leaf), (h)-[:e]->(:leaf),
+           (h)-[:e]->(:leaf), (h)-[:e]->(:leaf), (h)-[:e]->(:leaf),
+           (h)-[:e]->(:leaf), (h)-[:e]->(:leaf), (h)-[:e]->(:leaf)
+$$) AS (a gtype);
+
+SELECT (SELECT string_agg(label(v)::text, ', ' ORDER BY i)
+        FROM unnest(nodes(p)) WITH ORDINALITY AS n(v, i)) AS path
+FROM cypher('vle_hub', $$MATCH p=(:hub)-[*1..2]->(:target) RETURN p $$) AS (p traversal)
+ORDER BY path;
+
+SELECT count(*) FROM (
+    SELECT * FROM cypher('vle_hub', $$MATCH p=(:hub)-[*1..2]->(:target) RETURN p $$) AS (p traversal)
+    EXCEPT
+    (SELECT * FROM cypher('vle_hub', $$MATCH p=(:hub)-[]->(:target) RETURN p $$) AS (p traversal)
+     UNION ALL
+     SELECT * FROM cypher('vle_hub', $$MATCH p=(:hub)-[]->()-[]->(:target) RETURN p $$) AS (p traversal))
+) AS d;
+
+SELECT count(*) FROM (
+    (SELECT * FROM cypher('vle_hub', $$MATCH p=(:hub)-[]->(:target) RETURN p $$) AS (p traversal)
+     UNION ALL
+     SELECT * FROM cypher('vle_hub', $$MATCH p=(:hub)-[]->()-[]->(:target) RETURN p $$) AS (p traversal))
+    EXCEPT
+    SELECT * FROM cypher('vle_hub', $$MATCH p=(:hub)-[*1..2]->(:target) RETURN p $$) AS (p traversal)
+) AS d;
+
+SELECT drop_graph('vle_hub', true);
+
 --
 -- Clean up
 --
@@ -71,4 +71,9 @@ SELECT properties(build_edge(_graphid(3, 1), '2'::graphid, '3'::graphid, graphid
 SELECT properties(build_edge(_graphid(3, 1),  '2'::graphid, '3'::graphid, graphid, gtype_build_map('id', 2))) FROM ag_graph;
 
 
+-- id(), start_id() and property access read the label table's columns
+SELECT * FROM cypher('edge', $$CREATE ()-[:elabel {weight: 2}]->()$$) AS (a gtype);
+EXPLAIN (VERBOSE, COSTS FALSE) SELECT * FROM cypher('edge', $$MATCH ()-[e:elabel]->() WITH e RETURN e.weight, id(e), start_id(e)$$) AS (weight gtype, id gtype, start_id gtype);
+SELECT * FROM cypher('edge', $$MATCH ()-[e:elabel]->() WITH e RETURN e.weight, id(e), start_id(e)$$) AS (weight gtype, id gtype, start_id gtype);
+
 SELECT drop_graph('edge', true);
@@ -1179,6 +1179,23 @@ $$) AS r(result vertex);
 SELECT * FROM cypher('regex', $$
 MATCH (n:Person) WHERE n.name =~ 'J.*' RETURN n
 $$) AS r(result vertex);
+-- anchored literal prefixes are matched without the regex engine
+SELECT * FROM cypher('regex', $$
+MATCH (n:Person) WHERE n.name =~ '^Jo.*' RETURN n
+$$) AS r(result vertex);
+SELECT * FROM cypher('regex', $$
+MATCH (n:Person) WHERE n.name =~ '^Je' RETURN n
+$$) AS r(result vertex);
+SELECT * FROM cypher('regex', $$
+MATCH (n:Person) WHERE n.name =~ '^Jo*' RETURN n
+$$) AS r(result vertex);
+SELECT * FROM cypher('regex', $$
+MATCH (n:Person) WHERE n.name =~ '^J[eo]an$' RETURN n
+$$) AS r(result vertex);
+-- should fail
+SELECT * FROM cypher('regex', $$
+MATCH (n:Person) WHERE n.name =~ '(' RETURN n
+$$) AS r(result vertex);
 
 --
 --Coearce to Postgres 3 int types (smallint, int, bigint)
@@ -1513,6 +1530,15 @@ $$) AS (startNode vertex);
 SELECT * FROM cypher('expr', $$
     RETURN startNode()
 $$) AS (startNode vertex);
+-- startNode() sees a SET made earlier in the transaction
+BEGIN;
+SELECT * FROM cypher('expr', $$
+    MATCH (v:v1 {id: 'middle'}) SET v.id = 'changed'
+$$) AS (a gtype);
+SELECT * FROM cypher('expr', $$
+    MATCH ()-[e]->() RETURN id(e), properties(startNode(e))
+$$) AS (id gtype, props gtype) ORDER BY id;
+ROLLBACK;
 -- endNode()
 SELECT * FROM cypher('expr', $$
     MATCH ()-[e]-() RETURN id(e), end_id(e), endNode(e)
@@ -2012,6 +2038,12 @@ $$) AS (results gtype);
 SELECT * FROM cypher('expr', $$
     RETURN substring("0123456789", 0)
 $$) AS (results gtype);
+SELECT * FROM cypher('expr', $$
+    RETURN substring("αβγδε", 1, 3)
+$$) AS (results gtype);
+SELECT * FROM cypher('expr', $$
+    RETURN left("αβγδε", -2)
+$$) AS (results gtype);
 -- should return null
 SELECT * FROM cypher('expr', $$
     RETURN substring(null, null, null)
@@ -2057,6 +2089,9 @@ $$) AS (results gtype);
 SELECT * FROM cypher('expr', $$
     RETURN split("a,b,c,d,e,f", "c,")
 $$) AS (results gtype);
+SELECT * FROM cypher('expr', $$
+    RETURN split(",a,,b,", ",")
+$$) AS (results gtype);
 -- should return null
 SELECT * FROM cypher('expr', $$
     RETURN split(null, null)
@@ -2395,6 +2430,9 @@ $$) AS (results gtype);
 SELECT * FROM cypher('expr', $$
     RETURN abs(-10)
 $$) AS (results gtype);
+SELECT * FROM cypher('expr', $$
+    RETURN abs(-2.5)
+$$) AS (results gtype);
 SELECT * FROM cypher('expr', $$
     RETURN ceil(0)
 $$) AS (results gtype);
@@ -2470,6 +2508,9 @@ $$) AS (results gtype);
 SELECT * FROM cypher('expr', $$
     RETURN sign(0)
 $$) AS (results gtype);
+SELECT * FROM cypher('expr', $$
+    RETURN sign(-2.5)
+$$) AS (results gtype);
 -- should return null
 SELECT * FROM cypher('expr', $$
     RETURN abs(null)
@@ -2614,6 +2655,9 @@ $$) as (result gtype);
 SELECT * from cypher('expr', $$
     RETURN sqrt(0)
 $$) as (result gtype);
+SELECT * from cypher('expr', $$
+    RETURN sqrt(3.0 * 3.0 + 4 * 4)
+$$) as (result gtype);
 -- should return null
 SELECT * from cypher('expr', $$
     RETURN sqrt(-1)
@@ -2737,6 +2781,13 @@ SELECT * FROM cypher('UCSC', $$ RETURN avg(NULL) $$) AS (avg gtype);
 SELECT * FROM cypher('UCSC', $$ RETURN sum(NULL) $$) AS (sum gtype);
 -- should return 0
 SELECT * FROM cypher('UCSC', $$ RETURN count(NULL) $$) AS (count gtype);
+-- sum() keeps the type of its most precise input
+SELECT * FROM cypher('UCSC', $$ UNWIND [1, 2, 3] AS x RETURN sum(x) $$) AS (sum gtype);
+SELECT * FROM cypher('UCSC', $$ UNWIND [1, 2, 3.5] AS x RETURN sum(x) $$) AS (sum gtype);
+SELECT * FROM cypher('UCSC', $$ UNWIND [1, 2.5, 4::numeric] AS x RETURN sum(x), avg(x) $$) AS (sum gtype, avg gtype);
+SELECT * FROM cypher('UCSC', $$ UNWIND [1, null, 3, 5] AS x RETURN sum(x), avg(x), stDev(x) $$) AS (sum gtype, avg gtype, stdev gtype);
+SELECT * FROM cypher('UCSC', $$ UNWIND [9223372036854775807, 1] AS x RETURN sum(x) $$) AS (sum gtype);
+SELECT * FROM cypher('UCSC', $$ UNWIND [1, 'a'] AS x RETURN sum(x) $$) AS (sum gtype);
 -- should fail
 SELECT * FROM cypher('UCSC', $$ RETURN avg() $$) AS (avg gtype);
 SELECT * FROM cypher('UCSC', $$ RETURN sum() $$) AS (sum gtype);
@@ -2788,7 +2839,7 @@ SELECT * FROM cypher('UCSC', $$ RETURN stDev() $$) AS (stDev gtype);
 SELECT * FROM cypher('UCSC', $$ RETURN stDevP() $$) AS (stDevP gtype);
 
 --
--- aggregate functions percentileCont() & percentileDisc()
+-- aggregate functions percentileCont(), percentileDisc() & percentileApprox()
 --
 SELECT * FROM cypher('UCSC', $$ MATCH (u) RETURN percentileCont(u.gpa, .55), percentileDisc(u.gpa, .55), percentileCont(u.gpa, .9), percentileDisc(u.gpa, .9) $$)
 AS (percentileCont1 gtype, percentileDisc1 gtype, percentileCont2 gtype, percentileDisc2 gtype);
@@ -2802,6 +2853,31 @@ SELECT * FROM cypher('UCSC', $$ RETURN percentileDisc(NULL, .5) $$) AS (percenti
 -- should fail
 SELECT * FROM cypher('UCSC', $$ RETURN percentileCont(.5, NULL) $$) AS (percentileCont gtype);
 SELECT * FROM cypher('UCSC', $$ RETURN percentileDisc(.5, NULL) $$) AS (percentileDisc gtype);
+SELECT * FROM cypher('UCSC', $$ RETURN percentileApprox(.5, NULL) $$) AS (percentileApprox gtype);
+-- percentileApprox() is exact while the input fits in one level of its sketch
+SELECT * FROM cypher('UCSC', $$ MATCH (u) RETURN percentileApprox(u.gpa, .55), percentileApprox(u.gpa, .9) $$)
+AS (percentileApprox1 gtype, percentileApprox2 gtype);
+-- should return null
+SELECT * FROM cypher('UCSC', $$ RETURN percentileApprox(NULL, .5) $$) AS (percentileApprox gtype);
+-- percentiles as partial aggregates in parallel workers
+CREATE TABLE percentile_table AS SELECT i::float8::gtype AS g FROM generate_series(1, 1000) i;
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+SET max_parallel_workers_per_gather = 2;
+EXPLAIN (COSTS OFF) SELECT percentilecont(g, 0.5::float8::gtype) FROM percentile_table;
+SELECT percentilecont(g, 0.5::float8::gtype), percentiledisc(g, 0.5::float8::gtype) FROM percentile_table;
+SELECT abs(percentileapprox(g, 0.5::float8::gtype)::float8 - 500) <= 50 AS close_enough FROM percentile_table;
+-- past work_mem, the values of percentileCont() and percentileDisc() are sorted by a tuplesort
+SET work_mem = '64kB';
+SELECT percentilecont(i::float8::gtype, 0.25::float8::gtype), percentiledisc(i::float8::gtype, 0.25::float8::gtype)
+FROM generate_series(10000, 1, -1) i;
+RESET work_mem;
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET max_parallel_workers_per_gather;
+DROP TABLE percentile_table;
 
 --
 -- aggregate function collect()
@@ -2820,6 +2896,20 @@ SELECT * FROM cypher('UCSC', $$ MATCH (u) WHERE u.name =~ "doesn't exist" RETURN
 -- should fail
 SELECT * FROM cypher('UCSC', $$ RETURN collect() $$) AS (collect gtype);
 
+-- collect() as a partial aggregate in parallel workers
+CREATE TABLE collect_table AS SELECT i::int8::gtype AS g FROM generate_series(1, 1000) i;
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+SET max_parallel_workers_per_gather = 2;
+EXPLAIN (COSTS OFF) SELECT collect(g) FROM collect_table;
+SELECT size(collect(g)) FROM collect_table;
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET max_parallel_workers_per_gather;
+DROP TABLE collect_table;
+
 -- test DISTINCT inside aggregate functions
 SELECT * FROM cypher('UCSC', $$CREATE (:students {name: "Sven", gpa: 3.2, age: 27, zip: 94110})$$)
 AS (a gtype);
@@ -2828,6 +2918,10 @@ SELECT * FROM cypher('UCSC', $$ MATCH (u) RETURN count(u.zip), count(DISTINCT u.
 AS (zip gtype, distinct_zip gtype);
 SELECT * FROM cypher('UCSC', $$ MATCH (u) RETURN count(u.age), count(DISTINCT u.age) $$)
 AS (age gtype, distinct_age gtype);
+SELECT * FROM cypher('UCSC', $$ MATCH (u) RETURN count(DISTINCT u.age), approx_count_distinct(u.age) $$)
+AS (distinct_age gtype, approx_distinct_age gtype);
+SELECT abs(approx_count_distinct((i % 5000)::int8::gtype)::float8 - 5000) <= 250 AS close_enough
+FROM generate_series(1, 20000) i;
 
 -- test AUTO GROUP BY for aggregate functions
 SELECT create_graph('group_by');
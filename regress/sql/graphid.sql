@@ -45,3 +45,18 @@ EXPLAIN (COSTS FALSE) SELECT * FROM graphid_table WHERE gid = '1';
 EXPLAIN (COSTS FALSE) SELECT * FROM graphid_table WHERE gid > '0';
 SET enable_seqscan = ON;
 DROP TABLE graphid_table;
+
+-- b-tree deduplication is enabled by the equalimage support function
+SELECT p.amproc
+FROM pg_amproc p
+JOIN pg_opfamily f ON f.oid = p.amprocfamily
+JOIN pg_am a ON a.oid = f.opfmethod
+WHERE f.opfname = 'graphid_ops' AND a.amname = 'btree' AND p.amprocnum = 4;
+
+-- hash support hashes graphid like int8
+SELECT graphid_hash_cmp('1'::graphid) = hashint8(1),
+       graphid_hash_cmp('-1'::graphid) = hashint8(-1),
+       graphid_hash_cmp('281474976710657'::graphid) = hashint8(281474976710657);
+SELECT graphid_hash_extended('1'::graphid, 0) = hashint8extended(1, 0),
+       graphid_hash_extended('-1'::graphid, 42) = hashint8extended(-1, 42),
+       graphid_hash_extended('281474976710657'::graphid, 42) = hashint8extended(281474976710657, 42);
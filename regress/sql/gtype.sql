@@ -439,6 +439,9 @@ SELECT gtype_exists('{"id": 1}','not_id');
 
 SELECT '{"id": 1}'::gtype ? 'id';
 SELECT '{"id": 1}'::gtype ? 'not_id';
+SELECT '{"a": 1, "bb": 2, "ccc": 3, "dd": 4, "e": 5}'::gtype ? 'dd';
+SELECT '{"a": 1, "bb": 2, "ccc": 3, "dd": 4, "e": 5}'::gtype ? 'd';
+SELECT '["id", 1]'::gtype ? 'id';
 
 SELECT gtype_exists_any('{"id": 1}', array['id']);
 SELECT gtype_exists_any('{"id": 1}', array['not_id']);
@@ -86,4 +86,154 @@ SELECT build_traversal(
 )
 FROM ag_graph;
 
+-- a vertex the path returns to is stored once
+SELECT build_traversal(
+        build_vertex(_graphid(3, 2), graphid, gtype_build_map()),
+        build_edge(_graphid(4, 1), '2'::graphid, '3'::graphid,  graphid, gtype_build_map()),
+        build_vertex(_graphid(3, 3), graphid, gtype_build_map()),
+        build_edge(_graphid(4, 4), '3'::graphid, '2'::graphid,  graphid, gtype_build_map()),
+        build_vertex(_graphid(3, 2),  graphid, gtype_build_map())
+)
+FROM ag_graph;
+
+SELECT size(t), array_length(nodes(t), 1), array_length(relationships(t), 1)
+FROM (
+    SELECT build_traversal(
+            build_vertex(_graphid(3, 2), graphid, gtype_build_map()),
+            build_edge(_graphid(4, 1), '2'::graphid, '3'::graphid,  graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 3), graphid, gtype_build_map()),
+            build_edge(_graphid(4, 4), '3'::graphid, '2'::graphid,  graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 2),  graphid, gtype_build_map())
+    ) AS t
+    FROM ag_graph
+) AS paths;
+
+-- pg_column_size() shows the revisited vertex takes no space, unless its properties differ
+SELECT pg_column_size(through) - pg_column_size(revisiting) = pg_column_size(v),
+       pg_column_size(changed) - pg_column_size(revisiting) = pg_column_size(w)
+FROM (
+    SELECT build_traversal(
+            build_vertex(_graphid(3, 2), graphid, gtype_build_map()),
+            build_edge(_graphid(4, 1), '2'::graphid, '3'::graphid,  graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 3), graphid, gtype_build_map()),
+            build_edge(_graphid(4, 4), '3'::graphid, '2'::graphid,  graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 2), graphid, gtype_build_map())
+        ) AS revisiting,
+        build_traversal(
+            build_vertex(_graphid(3, 2), graphid, gtype_build_map()),
+            build_edge(_graphid(4, 1), '2'::graphid, '3'::graphid,  graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 3), graphid, gtype_build_map()),
+            build_edge(_graphid(4, 4), '3'::graphid, '2'::graphid,  graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 5), graphid, gtype_build_map())
+        ) AS through,
+        build_traversal(
+            build_vertex(_graphid(3, 2), graphid, gtype_build_map()),
+            build_edge(_graphid(4, 1), '2'::graphid, '3'::graphid,  graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 3), graphid, gtype_build_map()),
+            build_edge(_graphid(4, 4), '3'::graphid, '2'::graphid,  graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 2), graphid, gtype_build_map('id', 2))
+        ) AS changed,
+        build_vertex(_graphid(3, 5), graphid, gtype_build_map()) AS v,
+        build_vertex(_graphid(3, 2), graphid, gtype_build_map('id', 2)) AS w
+    FROM ag_graph
+) AS paths;
+
+-- paths compare and hash on their graphids, not their properties
+SELECT p1 = p2, p1 <> p2, p1 < p3, p3 > p1, p3 <= p1
+FROM (
+    SELECT build_traversal(
+            build_vertex(_graphid(3, 2), graphid, gtype_build_map()),
+            build_edge(_graphid(4, 1), '2'::graphid, '3'::graphid,  graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 3),  graphid, gtype_build_map())
+        ) AS p1,
+        build_traversal(
+            build_vertex(_graphid(3, 2), graphid, gtype_build_map('id', 2)),
+            build_edge(_graphid(4, 1), '2'::graphid, '3'::graphid,  graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 3),  graphid, gtype_build_map())
+        ) AS p2,
+        build_traversal(
+            build_vertex(_graphid(3, 2), graphid, gtype_build_map()),
+            build_edge(_graphid(4, 1), '2'::graphid, '3'::graphid,  graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 3), graphid, gtype_build_map()),
+            build_edge(_graphid(4, 4), '3'::graphid, '5'::graphid,  graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 5),  graphid, gtype_build_map())
+        ) AS p3
+    FROM ag_graph
+) AS paths;
+
+SELECT count(*), count(DISTINCT p)
+FROM (
+    SELECT build_traversal(
+            build_vertex(_graphid(3, 2), graphid, gtype_build_map('id', g)),
+            build_edge(_graphid(4, 1), '2'::graphid, '3'::graphid,  graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 3),  graphid, gtype_build_map())
+        ) AS p
+    FROM ag_graph, generate_series(1, 3) AS g
+) AS paths;
+
+-- grouping and joins on paths can hash them
+CREATE TABLE traversals AS
+SELECT g, build_traversal(
+            build_vertex(_graphid(3, 2), graphid, gtype_build_map('id', g)),
+            build_edge(_graphid(4, 1), '2'::graphid, '3'::graphid,  graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 3),  graphid, gtype_build_map())
+        ) AS p
+FROM ag_graph, generate_series(1, 3) AS g;
+CREATE TABLE one_traversal AS
+SELECT build_traversal(
+            build_vertex(_graphid(3, 2), graphid, gtype_build_map()),
+            build_edge(_graphid(4, 1), '2'::graphid, '3'::graphid,  graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 3),  graphid, gtype_build_map())
+        ) AS p
+FROM ag_graph;
+ANALYZE traversals, one_traversal;
+SET enable_sort = OFF;
+EXPLAIN (COSTS OFF) SELECT count(*) FROM traversals GROUP BY p;
+SELECT count(*) FROM traversals GROUP BY p;
+RESET enable_sort;
+SET enable_mergejoin = OFF;
+SET enable_nestloop = OFF;
+EXPLAIN (COSTS OFF) SELECT count(*) FROM traversals t JOIN one_traversal o ON t.p = o.p;
+SELECT count(*) FROM traversals t JOIN one_traversal o ON t.p = o.p;
+RESET enable_mergejoin;
+RESET enable_nestloop;
+DROP TABLE traversals, one_traversal;
+
+-- the entities are found through the offset table
+SELECT id((nodes(t))[2]), id((nodes(t))[3]), id((relationships(t))[2])
+FROM (
+    SELECT build_traversal(
+            build_vertex(_graphid(3, 2), graphid, gtype_build_map()),
+            build_edge(_graphid(4, 1), '2'::graphid, '3'::graphid,  graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 3), graphid, gtype_build_map()),
+            build_edge(_graphid(4, 4), '3'::graphid, '5'::graphid,  graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 5),  graphid, gtype_build_map())
+        ) AS t
+    FROM ag_graph
+) AS paths;
+-- traversals written without the offset table are walked
+CREATE CAST (bytea AS traversal) WITHOUT FUNCTION;
+CREATE CAST (traversal AS bytea) WITHOUT FUNCTION;
+SELECT size(legacy), legacy = t, legacy::text = t::text, id((nodes(legacy))[3]), id((relationships(legacy))[2])
+FROM (
+    -- clear the flag in the count and drop the five offsets after it
+    SELECT t, (set_byte(set_byte(substring(b from 1 for 4), 0, get_byte(b, 0) & 127), 3, get_byte(b, 3) & 127) ||
+               substring(b from 25))::traversal AS legacy
+    FROM (
+        SELECT t, t::bytea AS b
+        FROM (
+            SELECT build_traversal(
+                    build_vertex(_graphid(3, 2), graphid, gtype_build_map()),
+                    build_edge(_graphid(4, 1), '2'::graphid, '3'::graphid,  graphid, gtype_build_map()),
+                    build_vertex(_graphid(3, 3), graphid, gtype_build_map()),
+                    build_edge(_graphid(4, 4), '3'::graphid, '5'::graphid,  graphid, gtype_build_map()),
+                    build_vertex(_graphid(3, 5),  graphid, gtype_build_map())
+                ) AS t
+            FROM ag_graph
+        ) AS paths
+    ) AS bytes
+) AS legacy_paths;
+DROP CAST (bytea AS traversal);
+DROP CAST (traversal AS bytea);
+
 SELECT drop_graph('variable_edge', true);
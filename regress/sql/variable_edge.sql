@@ -63,4 +63,56 @@ SELECT build_traversal(
 )
 FROM ag_graph;
 
+-- VariableEdges compare and hash on their graphids, not their properties
+SELECT v1 = v2, v1 <> v2, v1 < v3, v3 > v1, v3 <= v1, v1 >= v2, v1 <= v2
+FROM (
+    SELECT build_variable_edge(
+            build_edge(_graphid(4, 1), '2'::graphid, '3'::graphid, graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 3), graphid, gtype_build_map()),
+            build_edge(_graphid(4, 4), '3'::graphid, '5'::graphid, graphid, gtype_build_map())
+        ) AS v1,
+        build_variable_edge(
+            build_edge(_graphid(4, 1), '2'::graphid, '3'::graphid, graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 3), graphid, gtype_build_map('id', 2)),
+            build_edge(_graphid(4, 4), '3'::graphid, '5'::graphid, graphid, gtype_build_map())
+        ) AS v2,
+        build_variable_edge(
+            build_edge(_graphid(4, 1), '2'::graphid, '3'::graphid, graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 3), graphid, gtype_build_map()),
+            build_edge(_graphid(4, 6), '3'::graphid, '5'::graphid, graphid, gtype_build_map())
+        ) AS v3
+    FROM ag_graph
+) AS paths;
+
+SELECT count(*), count(DISTINCT v)
+FROM (
+    SELECT build_variable_edge(
+            build_edge(_graphid(4, 1), '2'::graphid, '3'::graphid, graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 3), graphid, gtype_build_map('id', g)),
+            build_edge(_graphid(4, 4), '3'::graphid, '5'::graphid, graphid, gtype_build_map())
+        ) AS v
+    FROM ag_graph, generate_series(1, 3) AS g
+) AS paths;
+
+-- a vertex the VariableEdge returns to is stored once
+SELECT pg_column_size(through) - pg_column_size(revisiting) = pg_column_size(v)
+FROM (
+    SELECT build_variable_edge(
+            build_edge(_graphid(4, 1), '2'::graphid, '3'::graphid, graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 3), graphid, gtype_build_map()),
+            build_edge(_graphid(4, 4), '3'::graphid, '5'::graphid, graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 3), graphid, gtype_build_map()),
+            build_edge(_graphid(4, 5), '5'::graphid, '3'::graphid, graphid, gtype_build_map())
+        ) AS revisiting,
+        build_variable_edge(
+            build_edge(_graphid(4, 1), '2'::graphid, '3'::graphid, graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 3), graphid, gtype_build_map()),
+            build_edge(_graphid(4, 4), '3'::graphid, '5'::graphid, graphid, gtype_build_map()),
+            build_vertex(_graphid(3, 5), graphid, gtype_build_map()),
+            build_edge(_graphid(4, 5), '5'::graphid, '3'::graphid, graphid, gtype_build_map())
+        ) AS through,
+        build_vertex(_graphid(3, 5), graphid, gtype_build_map()) AS v
+    FROM ag_graph
+) AS paths;
+
 SELECT drop_graph('variable_edge', true);
@@ -120,5 +120,28 @@ SELECT build_vertex(_graphid(1, 1), graphid, gtype_build_map()) ?& array['id'] F
 SELECT build_vertex(_graphid(1, 1), graphid, gtype_build_map('id', 2)) ?& array['id'] FROM ag_graph;
 SELECT build_vertex(_graphid(1, 1), graphid, gtype_build_map('id', 2)) ?& array['idd'] FROM ag_graph;
 
+--
+-- the operators are answered by a GIN index on a label table's properties column
+--
+SELECT * FROM cypher('vertex', $$CREATE (:vlabel {name: 'a'}), (:vlabel {age: 1})$$) AS (a gtype);
+CREATE INDEX ON vertex.vlabel USING gin (properties);
+SET enable_seqscan = OFF;
+EXPLAIN (COSTS FALSE) SELECT * FROM cypher('vertex', $$MATCH (n:vlabel) RETURN n$$) AS (n vertex) WHERE n ? 'name';
+SELECT properties(n) FROM cypher('vertex', $$MATCH (n:vlabel) RETURN n$$) AS (n vertex) WHERE n ? 'name';
+SELECT properties(n) FROM cypher('vertex', $$MATCH (n:vlabel) RETURN n$$) AS (n vertex) WHERE n ?| array['age', 'idd'];
+SELECT properties(n) FROM cypher('vertex', $$MATCH (n:vlabel) RETURN n$$) AS (n vertex) WHERE n ?& array['name', 'age'];
+SET enable_seqscan = ON;
+-- the columns of a table that is not a label table are not read directly
+CREATE TABLE vertex_props (id graphid, properties gtype);
+INSERT INTO vertex_props VALUES (_graphid(1, 1), gtype_build_map('name', 'a')), (_graphid(1, 2), gtype_build_map('age', 1));
+EXPLAIN (COSTS FALSE) SELECT properties FROM vertex_props WHERE build_vertex(id, tableoid, properties) ? 'name';
+SELECT properties FROM vertex_props WHERE build_vertex(id, tableoid, properties) ? 'name';
+-- id(), properties() and property access read the label table's columns
+EXPLAIN (VERBOSE, COSTS FALSE) SELECT * FROM cypher('vertex', $$MATCH (n:vlabel) WITH n RETURN n.name, id(n)$$) AS (name gtype, id gtype);
+SELECT * FROM cypher('vertex', $$MATCH (n:vlabel) WITH n RETURN n.name, id(n)$$) AS (name gtype, id gtype) ORDER BY id;
+-- over other tables the vertex is built
+SELECT id(v), v->>'name' FROM (SELECT build_vertex(id, tableoid, properties) AS v FROM vertex_props) AS s ORDER BY id(v);
+DROP TABLE vertex_props;
+
 SELECT drop_graph('vertex', true);
 
@@ -23,22 +23,30 @@
 #include "access/heapam.h"
 #include "access/htup.h"
 #include "access/htup_details.h"
+#include "access/relation.h"
 #include "access/skey.h"
 #include "access/stratnum.h"
 #include "catalog/indexing.h"
 #include "catalog/namespace.h"
+#include "catalog/pg_class.h"
+#include "catalog/pg_inherits.h"
 #include "fmgr.h"
 #include "nodes/execnodes.h"
 #include "nodes/makefuncs.h"
+#include "nodes/pathnodes.h"
+#include "partitioning/partbounds.h"
+#include "partitioning/partdesc.h"
 #include "storage/lockdefs.h"
 #include "utils/builtins.h"
 #include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
+#include "utils/partcache.h"
 #include "utils/rel.h"
 #include "utils/relcache.h"
 
 #include "catalog/ag_graph.h"
 #include "catalog/ag_label.h"
+#include "catalog/ag_label_stats.h"
 #include "commands/label_commands.h"
 #include "executor/cypher_utils.h"
 #include "utils/ag_cache.h"
@@ -101,6 +109,9 @@ void delete_label(Oid relation)
     Relation ag_label;
     SysScanDesc scan_desc;
     HeapTuple tuple;
+    Oid graph_oid;
+    int32 label_id;
+    bool is_null;
 
     ScanKeyInit(&scan_keys[0], Anum_ag_label_relation, BTEqualStrategyNumber,
                 F_OIDEQ, ObjectIdGetDatum(relation));
@@ -117,10 +128,20 @@ void delete_label(Oid relation)
                  errmsg("label (relation=%u) does not exist", relation)));
     }
 
+    graph_oid = DatumGetObjectId(heap_getattr(tuple, Anum_ag_label_graph,
+                                              RelationGetDescr(ag_label),
+                                              &is_null));
+    label_id = DatumGetInt32(heap_getattr(tuple, Anum_ag_label_id,
+                                          RelationGetDescr(ag_label),
+                                          &is_null));
+
     CatalogTupleDelete(ag_label, &tuple->t_self);
 
     systable_endscan(scan_desc);
     table_close(ag_label, RowExclusiveLock);
+
+    // the statistics gathered by analyze_graph() are stale now
+    delete_label_stats(graph_oid, label_id);
 }
 
 int32 get_label_id(const char *label_name, Oid graph_oid)
@@ -150,6 +171,142 @@ char *get_label_relation_name(const char *label_name, Oid graph_oid)
     return get_rel_name(get_label_relation(label_name, graph_oid));
 }
 
+/*
+ * Returns the relation that holds the rows of the label backed by the given
+ * relation. In a graph created with partitioned => true, the default labels
+ * are partitioned tables with no storage of their own. The rows of those
+ * labels live in the one partition that is not a label itself.
+ *
+ * Edge labels created with partitions => N are hash partitioned on start_id.
+ * For those the label relation itself is returned; rows are routed with
+ * get_label_partition_for_start_id().
+ */
+Oid get_label_storage_relation(Oid relation)
+{
+    Relation rel;
+    char strategy;
+    List *partitions;
+    ListCell *lc;
+
+    if (get_rel_relkind(relation) != RELKIND_PARTITIONED_TABLE)
+        return relation;
+
+    rel = relation_open(relation, AccessShareLock);
+    strategy = get_partition_strategy(RelationGetPartitionKey(rel));
+    relation_close(rel, NoLock);
+
+    if (strategy == PARTITION_STRATEGY_HASH)
+        return relation;
+
+    partitions = find_inheritance_children(relation, NoLock);
+    foreach (lc, partitions)
+    {
+        Oid partition = lfirst_oid(lc);
+
+        if (!search_label_relation_cache(partition))
+            return partition;
+    }
+
+    ereport(ERROR,
+            (errcode(ERRCODE_UNDEFINED_TABLE),
+             errmsg("label table \"%s\" has no partition for its own rows",
+                    get_rel_name(relation))));
+    return InvalidOid;
+}
+
+/*
+ * Returns all the relations that hold rows of the label backed by the given
+ * relation, for the callers that scan a label table by itself.
+ */
+List *get_label_storage_relations(Oid relation)
+{
+    List *partitions;
+    List *result = NIL;
+    ListCell *lc;
+
+    if (get_rel_relkind(relation) != RELKIND_PARTITIONED_TABLE)
+        return list_make1_oid(relation);
+
+    partitions = find_inheritance_children(relation, NoLock);
+    foreach (lc, partitions)
+    {
+        Oid partition = lfirst_oid(lc);
+
+        if (!search_label_relation_cache(partition))
+            result = lappend_oid(result, partition);
+    }
+
+    return result;
+}
+
+/*
+ * Returns whether node is a Var over the attno column of a label table in the
+ * query being planned, so planner support functions only rewrite expressions
+ * over rows that were read from a label table.
+ */
+bool is_label_column(Node *node, PlannerInfo *root, AttrNumber attno)
+{
+    Var *var;
+    RangeTblEntry *rte;
+
+    if (root == NULL || !IsA(node, Var))
+        return false;
+
+    var = (Var *)node;
+    if (var->varlevelsup != 0 || var->varattno != attno ||
+        var->varno < 1 || var->varno > list_length(root->parse->rtable))
+        return false;
+
+    rte = planner_rt_fetch(var->varno, root);
+
+    return rte->rtekind == RTE_RELATION &&
+           search_label_relation_cache(rte->relid) != NULL;
+}
+
+/*
+ * Returns the partition of a hash partitioned edge label that holds the edges
+ * starting at start_id. This is the partition the tuple routing of an INSERT
+ * into the label table would pick.
+ */
+Oid get_label_partition_for_start_id(Oid relation, graphid start_id)
+{
+    Relation rel;
+    PartitionKey key;
+    PartitionDesc partdesc;
+    Datum values[1];
+    bool isnull[1];
+    uint64 row_hash;
+    int part_index;
+    Oid partition;
+
+    rel = relation_open(relation, AccessShareLock);
+    key = RelationGetPartitionKey(rel);
+    partdesc = RelationGetPartitionDesc(rel, true);
+
+    Assert(get_partition_strategy(key) == PARTITION_STRATEGY_HASH);
+
+    values[0] = GRAPHID_GET_DATUM(start_id);
+    isnull[0] = false;
+    row_hash = compute_partition_hash_value(key->partnatts, key->partsupfunc,
+                                            key->partcollation, values,
+                                            isnull);
+
+    part_index = partdesc->boundinfo->indexes[row_hash %
+                                              partdesc->boundinfo->nindexes];
+    if (part_index < 0)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_NO_PARTITION_FOR_ROW),
+                 errmsg("no partition of \"%s\" for start_id %ld",
+                        RelationGetRelationName(rel), start_id)));
+    }
+    partition = partdesc->oids[part_index];
+
+    relation_close(rel, NoLock);
+
+    return partition;
+}
+
 PG_FUNCTION_INFO_V1(_label_name);
 
 /*
@@ -348,7 +505,7 @@ char *get_label_name(const char *graph_name, int64 label_id)
 
     result = NameStr(*DatumGetName(
         heap_getattr(tuple, Anum_ag_label_name, tupdesc, &column_is_null)));
-    result = strdup(result);
+    result = pstrdup(result);
 
     systable_endscan(scan_desc);
     table_close(ag_label, ShareLock);
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2023 PostGraphDB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/heapam.h"
+#include "access/htup.h"
+#include "access/htup_details.h"
+#include "access/skey.h"
+#include "access/stratnum.h"
+#include "catalog/indexing.h"
+#include "storage/lockdefs.h"
+#include "utils/fmgroids.h"
+#include "utils/rel.h"
+
+#include "catalog/ag_label_stats.h"
+#include "utils/graphid.h"
+
+static void delete_label_stats_from(Oid relation_id, Oid index_id,
+                                    AttrNumber graph_attno,
+                                    AttrNumber id_attno, Oid graph_oid,
+                                    int32 label_id);
+
+// INSERT INTO postgraph.ag_label_stats VALUES (...)
+void insert_label_stats(label_stats *stats)
+{
+    Datum values[Natts_ag_label_stats];
+    bool nulls[Natts_ag_label_stats];
+    Relation ag_label_stats;
+    HeapTuple tuple;
+
+    AssertArg(label_id_is_valid(stats->id));
+
+    ag_label_stats = table_open(ag_label_stats_relation_id(),
+                                RowExclusiveLock);
+
+    values[Anum_ag_label_stats_graph - 1] = ObjectIdGetDatum(stats->graph);
+    nulls[Anum_ag_label_stats_graph - 1] = false;
+
+    values[Anum_ag_label_stats_id - 1] = Int32GetDatum(stats->id);
+    nulls[Anum_ag_label_stats_id - 1] = false;
+
+    values[Anum_ag_label_stats_row_count - 1] = Int64GetDatum(stats->row_count);
+    nulls[Anum_ag_label_stats_row_count - 1] = false;
+
+    values[Anum_ag_label_stats_avg_out_degree - 1] =
+        Float8GetDatum(stats->avg_out_degree);
+    nulls[Anum_ag_label_stats_avg_out_degree - 1] = !stats->has_degrees;
+
+    values[Anum_ag_label_stats_max_out_degree - 1] =
+        Int64GetDatum(stats->max_out_degree);
+    nulls[Anum_ag_label_stats_max_out_degree - 1] = !stats->has_degrees;
+
+    values[Anum_ag_label_stats_avg_in_degree - 1] =
+        Float8GetDatum(stats->avg_in_degree);
+    nulls[Anum_ag_label_stats_avg_in_degree - 1] = !stats->has_degrees;
+
+    values[Anum_ag_label_stats_max_in_degree - 1] =
+        Int64GetDatum(stats->max_in_degree);
+    nulls[Anum_ag_label_stats_max_in_degree - 1] = !stats->has_degrees;
+
+    tuple = heap_form_tuple(RelationGetDescr(ag_label_stats), values, nulls);
+
+    /*
+     * CatalogTupleInsert() is originally for PostgreSQL's catalog. However,
+     * it is used at here for convenience.
+     */
+    CatalogTupleInsert(ag_label_stats, tuple);
+
+    table_close(ag_label_stats, RowExclusiveLock);
+}
+
+// INSERT INTO postgraph.ag_label_endpoint_stats VALUES (...)
+void insert_label_endpoint_stats(Oid graph_oid, int32 label_id,
+                                 int32 start_label_id, int32 end_label_id,
+                                 int64 row_count)
+{
+    Datum values[Natts_ag_label_endpoint_stats];
+    bool nulls[Natts_ag_label_endpoint_stats];
+    Relation ag_label_endpoint_stats;
+    HeapTuple tuple;
+
+    AssertArg(label_id_is_valid(label_id));
+
+    ag_label_endpoint_stats = table_open(ag_label_endpoint_stats_relation_id(),
+                                         RowExclusiveLock);
+
+    values[Anum_ag_label_endpoint_stats_graph - 1] =
+        ObjectIdGetDatum(graph_oid);
+    nulls[Anum_ag_label_endpoint_stats_graph - 1] = false;
+
+    values[Anum_ag_label_endpoint_stats_id - 1] = Int32GetDatum(label_id);
+    nulls[Anum_ag_label_endpoint_stats_id - 1] = false;
+
+    values[Anum_ag_label_endpoint_stats_start_label_id - 1] =
+        Int32GetDatum(start_label_id);
+    nulls[Anum_ag_label_endpoint_stats_start_label_id - 1] = false;
+
+    values[Anum_ag_label_endpoint_stats_end_label_id - 1] =
+        Int32GetDatum(end_label_id);
+    nulls[Anum_ag_label_endpoint_stats_end_label_id - 1] = false;
+
+    values[Anum_ag_label_endpoint_stats_row_count - 1] =
+        Int64GetDatum(row_count);
+    nulls[Anum_ag_label_endpoint_stats_row_count - 1] = false;
+
+    tuple = heap_form_tuple(RelationGetDescr(ag_label_endpoint_stats), values,
+                            nulls);
+
+    CatalogTupleInsert(ag_label_endpoint_stats, tuple);
+
+    table_close(ag_label_endpoint_stats, RowExclusiveLock);
+}
+
+/*
+ * DELETE FROM postgraph.ag_label_stats WHERE graph = graph_oid AND id = label_id
+ * and the same for ag_label_endpoint_stats. If label_id is INVALID_LABEL_ID,
+ * the statistics of all the labels of the graph are deleted.
+ */
+void delete_label_stats(Oid graph_oid, int32 label_id)
+{
+    delete_label_stats_from(ag_label_stats_relation_id(),
+                            ag_label_stats_graph_id_index_id(),
+                            Anum_ag_label_stats_graph, Anum_ag_label_stats_id,
+                            graph_oid, label_id);
+    delete_label_stats_from(ag_label_endpoint_stats_relation_id(),
+                            ag_label_endpoint_stats_graph_id_index_id(),
+                            Anum_ag_label_endpoint_stats_graph,
+                            Anum_ag_label_endpoint_stats_id, graph_oid,
+                            label_id);
+}
+
+static void delete_label_stats_from(Oid relation_id, Oid index_id,
+                                    AttrNumber graph_attno,
+                                    AttrNumber id_attno, Oid graph_oid,
+                                    int32 label_id)
+{
+    ScanKeyData scan_keys[2];
+    int nkeys = 1;
+    Relation rel;
+    SysScanDesc scan_desc;
+    HeapTuple tuple;
+
+    ScanKeyInit(&scan_keys[0], graph_attno, BTEqualStrategyNumber, F_OIDEQ,
+                ObjectIdGetDatum(graph_oid));
+    if (label_id != INVALID_LABEL_ID)
+    {
+        ScanKeyInit(&scan_keys[1], id_attno, BTEqualStrategyNumber, F_INT4EQ,
+                    Int32GetDatum(label_id));
+        nkeys++;
+    }
+
+    rel = table_open(relation_id, RowExclusiveLock);
+    scan_desc = systable_beginscan(rel, index_id, true, NULL, nkeys,
+                                   scan_keys);
+
+    while (HeapTupleIsValid(tuple = systable_getnext(scan_desc)))
+        CatalogTupleDelete(rel, &tuple->t_self);
+
+    systable_endscan(scan_desc);
+    table_close(rel, RowExclusiveLock);
+}
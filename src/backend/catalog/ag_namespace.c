@@ -19,16 +19,17 @@
 
 #include "postgraph.h"
 
-#include "catalog/namespace.h"
+#include "catalog/pg_namespace.h"
 
 #include "catalog/ag_namespace.h"
+#include "utils/ag_cache.h"
 
 Oid postgraph_namespace_id(void)
 {
-    return get_namespace_oid(CATALOG_SCHEMA, false);
+    return search_namespace_oid_cache();
 }
 
 Oid pg_catalog_namespace_id(void)
 {
-    return get_namespace_oid("pg_catalog", false);
+    return PG_CATALOG_NAMESPACE;
 }
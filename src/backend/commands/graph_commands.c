@@ -21,8 +21,13 @@
 
 #include "access/genam.h"
 #include "access/heapam.h"
+#include "access/htup_details.h"
+#include "access/skey.h"
+#include "access/stratnum.h"
+#include "access/tableam.h"
 #include "access/xact.h"
 #include "catalog/dependency.h"
+#include "catalog/index.h"
 #include "catalog/objectaddress.h"
 #include "commands/defrem.h"
 #include "commands/schemacmds.h"
@@ -33,13 +38,24 @@
 #include "nodes/nodes.h"
 #include "nodes/parsenodes.h"
 #include "nodes/pg_list.h"
+#include "nodes/plannodes.h"
 #include "nodes/value.h"
 #include "parser/parser.h"
+#include "tcop/dest.h"
+#include "tcop/utility.h"
+#include "utils/fmgroids.h"
+#include "utils/hsearch.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/relcache.h"
+#include "utils/snapmgr.h"
+#include "utils/tuplesort.h"
+#include "utils/typcache.h"
 
 #include "catalog/ag_graph.h"
 #include "catalog/ag_label.h"
+#include "catalog/ag_label_stats.h"
 #include "commands/label_commands.h"
 #include "utils/graphid.h"
 
@@ -50,9 +66,33 @@
 #define gen_graph_namespace_name(graph_name) (graph_name)
 
 static Oid create_schema_for_graph(const Name graph_name);
+static void create_default_labels(char *graph_name, bool partitioned);
 static void drop_schema_for_graph(char *graph_name_str, const bool cascade);
 static void remove_schema(Node *schema_name, DropBehavior behavior);
 static void rename_graph(const Name graph_name, const Name new_name);
+static void analyze_label(Oid graph_oid, int32 label_id, char label_kind,
+                          Oid label_relation);
+static Tuplesortstate *begin_degree_sort(void);
+static void summarize_degrees(Tuplesortstate *ids, int64 edge_count,
+                              float8 *avg_degree, int64 *max_degree);
+static void cluster_edge_relation(Oid relid);
+static void create_edge_endpoint_index(char *schema_name, char *rel_name,
+                                       char *index_name, char *first_column,
+                                       char *second_column);
+static void process_utility_subcommand(Node *stmt, const char *query_string);
+
+// number of edges of an edge label per (start label, end label) pair
+typedef struct endpoint_stats_key
+{
+    int32 start_label_id;
+    int32 end_label_id;
+} endpoint_stats_key;
+
+typedef struct endpoint_stats_entry
+{
+    endpoint_stats_key key;
+    int64 row_count;
+} endpoint_stats_entry;
 
 PG_FUNCTION_INFO_V1(create_graph_if_not_exists);
 
@@ -62,6 +102,7 @@ Datum create_graph_if_not_exists(PG_FUNCTION_ARGS)
     Name graph_name;
     char *graph_name_str;
     Oid nsp_id;
+    bool partitioned;
 
     if (PG_ARGISNULL(0))
     {
@@ -69,6 +110,7 @@ Datum create_graph_if_not_exists(PG_FUNCTION_ARGS)
                         errmsg("graph name must not be NULL")));
     }
     graph_name = PG_GETARG_NAME(0);
+    partitioned = !PG_ARGISNULL(1) && PG_GETARG_BOOL(1);
 
     graph_name_str = NameStr(*graph_name);
     if (graph_exists(graph_name_str))
@@ -85,8 +127,7 @@ Datum create_graph_if_not_exists(PG_FUNCTION_ARGS)
 
     //Create the default label tables
     graph = graph_name->data;
-    create_label(graph, AG_DEFAULT_LABEL_VERTEX, LABEL_TYPE_VERTEX, NIL);
-    create_label(graph, AG_DEFAULT_LABEL_EDGE, LABEL_TYPE_EDGE, NIL);
+    create_default_labels(graph, partitioned);
 
     ereport(NOTICE,
             (errmsg("graph \"%s\" has been created", NameStr(*graph_name))));
@@ -103,6 +144,7 @@ Datum create_graph(PG_FUNCTION_ARGS)
     Name graph_name;
     char *graph_name_str;
     Oid nsp_id;
+    bool partitioned;
 
     if (PG_ARGISNULL(0))
     {
@@ -110,6 +152,7 @@ Datum create_graph(PG_FUNCTION_ARGS)
                         errmsg("graph name must not be NULL")));
     }
     graph_name = PG_GETARG_NAME(0);
+    partitioned = !PG_ARGISNULL(1) && PG_GETARG_BOOL(1);
 
     graph_name_str = NameStr(*graph_name);
     if (graph_exists(graph_name_str))
@@ -128,8 +171,7 @@ Datum create_graph(PG_FUNCTION_ARGS)
 
     //Create the default label tables
     graph = graph_name->data;
-    create_label(graph, AG_DEFAULT_LABEL_VERTEX, LABEL_TYPE_VERTEX, NIL);
-    create_label(graph, AG_DEFAULT_LABEL_EDGE, LABEL_TYPE_EDGE, NIL);
+    create_default_labels(graph, partitioned);
 
     ereport(NOTICE,
             (errmsg("graph \"%s\" has been created", NameStr(*graph_name))));
@@ -137,6 +179,27 @@ Datum create_graph(PG_FUNCTION_ARGS)
     PG_RETURN_VOID();
 }
 
+static void create_default_labels(char *graph_name, bool partitioned)
+{
+    if (partitioned)
+    {
+        /*
+         * The other labels become partitions of these instead of inheriting
+         * from them, so that MATCH can prune them by the label bits of id.
+         */
+        create_partitioned_label(graph_name, AG_DEFAULT_LABEL_VERTEX,
+                                 LABEL_TYPE_VERTEX);
+        create_partitioned_label(graph_name, AG_DEFAULT_LABEL_EDGE,
+                                 LABEL_TYPE_EDGE);
+    }
+    else
+    {
+        create_label(graph_name, AG_DEFAULT_LABEL_VERTEX, LABEL_TYPE_VERTEX,
+                     NIL);
+        create_label(graph_name, AG_DEFAULT_LABEL_EDGE, LABEL_TYPE_EDGE, NIL);
+    }
+}
+
 static Oid create_schema_for_graph(const Name graph_name)
 {
     char *graph_name_str = NameStr(*graph_name);
@@ -412,6 +475,397 @@ List *get_graphnames(void)
     return graphnames;
 }
 
+PG_FUNCTION_INFO_V1(analyze_graph);
+
+/*
+ * Gathers per-label statistics of the given graph and stores them in
+ * ag_label_stats and ag_label_endpoint_stats. Each label table is scanned
+ * on its own, without its inheritance children, so that the numbers of a
+ * label do not include the rows of the labels that inherit from it.
+ *
+ * Nothing in the extension reads these tables yet; they are only exposed to
+ * users. They are meant for the row estimates of the Cypher planner. The VLE
+ * does not need them to pick its search direction, because the graph context
+ * already holds the exact degree of both end vertices.
+ */
+Datum analyze_graph(PG_FUNCTION_ARGS)
+{
+    Name graph_name;
+    Oid graph_oid;
+    ScanKeyData scan_keys[1];
+    Relation ag_label;
+    SysScanDesc scan_desc;
+    HeapTuple tuple;
+    TupleDesc tupdesc;
+    List *label_ids = NIL;
+    List *label_kinds = NIL;
+    List *label_relations = NIL;
+    ListCell *lc_id;
+    ListCell *lc_kind;
+    ListCell *lc_relation;
+
+    if (PG_ARGISNULL(0))
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                        errmsg("graph name must not be NULL")));
+    }
+    graph_name = PG_GETARG_NAME(0);
+
+    graph_oid = get_graph_oid(NameStr(*graph_name));
+    if (!OidIsValid(graph_oid))
+    {
+        ereport(ERROR, (errcode(ERRCODE_UNDEFINED_SCHEMA),
+                        errmsg("graph \"%s\" does not exist",
+                               NameStr(*graph_name))));
+    }
+
+    // SELECT id, kind, relation FROM ag_label WHERE graph = graph_oid
+    ScanKeyInit(&scan_keys[0], Anum_ag_label_graph, BTEqualStrategyNumber,
+                F_OIDEQ, ObjectIdGetDatum(graph_oid));
+
+    ag_label = table_open(ag_label_relation_id(), AccessShareLock);
+    scan_desc = systable_beginscan(ag_label, ag_label_graph_oid_index_id(),
+                                   true, NULL, 1, scan_keys);
+    tupdesc = RelationGetDescr(ag_label);
+
+    while (HeapTupleIsValid(tuple = systable_getnext(scan_desc)))
+    {
+        bool is_null;
+
+        label_ids = lappend_int(label_ids, DatumGetInt32(heap_getattr(
+            tuple, Anum_ag_label_id, tupdesc, &is_null)));
+        label_kinds = lappend_int(label_kinds, DatumGetChar(heap_getattr(
+            tuple, Anum_ag_label_kind, tupdesc, &is_null)));
+        label_relations = lappend_oid(label_relations,
+                                      DatumGetObjectId(heap_getattr(
+            tuple, Anum_ag_label_relation, tupdesc, &is_null)));
+    }
+
+    systable_endscan(scan_desc);
+    table_close(ag_label, AccessShareLock);
+
+    forthree(lc_id, label_ids, lc_kind, label_kinds, lc_relation,
+             label_relations)
+    {
+        analyze_label(graph_oid, lfirst_int(lc_id), (char)lfirst_int(lc_kind),
+                      lfirst_oid(lc_relation));
+    }
+
+    CommandCounterIncrement();
+
+    PG_RETURN_VOID();
+}
+
+static void analyze_label(Oid graph_oid, int32 label_id, char label_kind,
+                          Oid label_relation)
+{
+    label_stats stats;
+    Relation rel;
+    TableScanDesc scan_desc;
+    HeapTuple tuple;
+    TupleDesc tupdesc;
+    ListCell *lc;
+    Tuplesortstate *start_ids = NULL;
+    Tuplesortstate *end_ids = NULL;
+    HTAB *endpoints = NULL;
+
+    MemSet(&stats, 0, sizeof(stats));
+    stats.graph = graph_oid;
+    stats.id = label_id;
+    stats.has_degrees = (label_kind == LABEL_KIND_EDGE);
+
+    if (stats.has_degrees)
+    {
+        HASHCTL ctl;
+
+        start_ids = begin_degree_sort();
+        end_ids = begin_degree_sort();
+
+        MemSet(&ctl, 0, sizeof(ctl));
+        ctl.keysize = sizeof(endpoint_stats_key);
+        ctl.entrysize = sizeof(endpoint_stats_entry);
+        ctl.hcxt = CurrentMemoryContext;
+        endpoints = hash_create("analyze_graph endpoints", 64, &ctl,
+                                HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+    }
+
+    foreach(lc, get_label_storage_relations(label_relation))
+    {
+        rel = table_open(lfirst_oid(lc), AccessShareLock);
+        scan_desc = table_beginscan(rel, GetActiveSnapshot(), 0, NULL);
+        tupdesc = RelationGetDescr(rel);
+
+        while (HeapTupleIsValid(tuple = heap_getnext(scan_desc,
+                                                      ForwardScanDirection)))
+        {
+            graphid start_id;
+            graphid end_id;
+            endpoint_stats_key key;
+            endpoint_stats_entry *entry;
+            bool is_null;
+            bool found;
+
+            stats.row_count++;
+
+            if (!stats.has_degrees)
+                continue;
+
+            start_id = DATUM_GET_GRAPHID(heap_getattr(
+                tuple, Anum_ag_label_edge_table_start_id, tupdesc, &is_null));
+            end_id = DATUM_GET_GRAPHID(heap_getattr(
+                tuple, Anum_ag_label_edge_table_end_id, tupdesc, &is_null));
+
+            tuplesort_putdatum(start_ids, GRAPHID_GET_DATUM(start_id), false);
+            tuplesort_putdatum(end_ids, GRAPHID_GET_DATUM(end_id), false);
+
+            key.start_label_id = GET_LABEL_ID(start_id);
+            key.end_label_id = GET_LABEL_ID(end_id);
+            entry = hash_search(endpoints, &key, HASH_ENTER, &found);
+            if (!found)
+                entry->row_count = 0;
+            entry->row_count++;
+        }
+
+        table_endscan(scan_desc);
+        table_close(rel, AccessShareLock);
+    }
+
+    delete_label_stats(graph_oid, label_id);
+
+    if (stats.has_degrees)
+    {
+        HASH_SEQ_STATUS seq;
+        endpoint_stats_entry *entry;
+
+        summarize_degrees(start_ids, stats.row_count, &stats.avg_out_degree,
+                          &stats.max_out_degree);
+        summarize_degrees(end_ids, stats.row_count, &stats.avg_in_degree,
+                          &stats.max_in_degree);
+
+        hash_seq_init(&seq, endpoints);
+        while ((entry = hash_seq_search(&seq)) != NULL)
+        {
+            insert_label_endpoint_stats(graph_oid, label_id,
+                                        entry->key.start_label_id,
+                                        entry->key.end_label_id,
+                                        entry->row_count);
+        }
+
+        tuplesort_end(start_ids);
+        tuplesort_end(end_ids);
+        hash_destroy(endpoints);
+    }
+
+    insert_label_stats(&stats);
+}
+
+/*
+ * The degrees are counted by sorting the start (or end) ids of the edges
+ * rather than with a hash table with an entry per vertex. The sort spills
+ * to disk past work_mem, so analyzing a large graph does not need memory
+ * in proportion to its number of vertices.
+ */
+static Tuplesortstate *begin_degree_sort(void)
+{
+    TypeCacheEntry *typentry;
+
+    typentry = lookup_type_cache(GRAPHIDOID, TYPECACHE_LT_OPR);
+
+    return tuplesort_begin_datum(GRAPHIDOID, typentry->lt_opr, InvalidOid,
+                                 false, work_mem, NULL, false);
+}
+
+/*
+ * The sorted ids come in one run per vertex, the length of the run being the
+ * degree of the vertex. The average degree only counts the vertices that have
+ * at least one edge of the label, which is what a traversal starting from a
+ * matched vertex sees.
+ */
+static void summarize_degrees(Tuplesortstate *ids, int64 edge_count,
+                              float8 *avg_degree, int64 *max_degree)
+{
+    Datum value;
+    bool is_null;
+    graphid prev_id = 0;
+    int64 degree = 0;
+    int64 num_vertices = 0;
+
+    tuplesort_performsort(ids);
+
+    *max_degree = 0;
+    while (tuplesort_getdatum(ids, true, &value, &is_null, NULL))
+    {
+        graphid id = DATUM_GET_GRAPHID(value);
+
+        if (degree > 0 && id == prev_id)
+        {
+            degree++;
+            continue;
+        }
+
+        if (degree > *max_degree)
+            *max_degree = degree;
+
+        prev_id = id;
+        degree = 1;
+        num_vertices++;
+    }
+
+    if (degree > *max_degree)
+        *max_degree = degree;
+
+    *avg_degree = num_vertices > 0 ? (float8)edge_count / num_vertices : 0;
+}
+
+PG_FUNCTION_INFO_V1(cluster_graph);
+
+/*
+ * Rewrites the edge label tables of the given graph in (start_id, end_id)
+ * order, so that the out-edges of a vertex are stored on adjacent pages.
+ * Every edge table gets an index on (start_id, end_id), which the table is
+ * clustered on, and an index on (end_id, start_id) for the in-edges. Both
+ * are created when missing. CLUSTER remembers the clustering index, so a
+ * plain CLUSTER restores the order after more edges have been added.
+ */
+Datum cluster_graph(PG_FUNCTION_ARGS)
+{
+    Name graph_name;
+    Oid graph_oid;
+    ScanKeyData scan_keys[1];
+    Relation ag_label;
+    SysScanDesc scan_desc;
+    HeapTuple tuple;
+    TupleDesc tupdesc;
+    List *label_relations = NIL;
+    ListCell *lc;
+
+    if (PG_ARGISNULL(0))
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                        errmsg("graph name must not be NULL")));
+    }
+    graph_name = PG_GETARG_NAME(0);
+
+    graph_oid = get_graph_oid(NameStr(*graph_name));
+    if (!OidIsValid(graph_oid))
+    {
+        ereport(ERROR, (errcode(ERRCODE_UNDEFINED_SCHEMA),
+                        errmsg("graph \"%s\" does not exist",
+                               NameStr(*graph_name))));
+    }
+
+    // SELECT relation FROM ag_label WHERE graph = graph_oid AND kind = 'e'
+    ScanKeyInit(&scan_keys[0], Anum_ag_label_graph, BTEqualStrategyNumber,
+                F_OIDEQ, ObjectIdGetDatum(graph_oid));
+
+    ag_label = table_open(ag_label_relation_id(), AccessShareLock);
+    scan_desc = systable_beginscan(ag_label, ag_label_graph_oid_index_id(),
+                                   true, NULL, 1, scan_keys);
+    tupdesc = RelationGetDescr(ag_label);
+
+    while (HeapTupleIsValid(tuple = systable_getnext(scan_desc)))
+    {
+        bool is_null;
+        char kind = DatumGetChar(heap_getattr(tuple, Anum_ag_label_kind,
+                                              tupdesc, &is_null));
+
+        if (kind != LABEL_KIND_EDGE)
+            continue;
+
+        label_relations = lappend_oid(label_relations,
+                                      DatumGetObjectId(heap_getattr(
+            tuple, Anum_ag_label_relation, tupdesc, &is_null)));
+    }
+
+    systable_endscan(scan_desc);
+    table_close(ag_label, AccessShareLock);
+
+    foreach(lc, label_relations)
+    {
+        ListCell *lc_storage;
+
+        // a partitioned label table is clustered one partition at a time
+        foreach(lc_storage, get_label_storage_relations(lfirst_oid(lc)))
+            cluster_edge_relation(lfirst_oid(lc_storage));
+    }
+
+    PG_RETURN_VOID();
+}
+
+static void cluster_edge_relation(Oid relid)
+{
+    char *schema_name = get_namespace_name(get_rel_namespace(relid));
+    char *rel_name = get_rel_name(relid);
+    char *out_index_name;
+    char *in_index_name;
+    ClusterStmt *cluster_stmt;
+
+    out_index_name = makeObjectName(rel_name, "start_id_end_id", "idx");
+    in_index_name = makeObjectName(rel_name, "end_id_start_id", "idx");
+
+    create_edge_endpoint_index(schema_name, rel_name, out_index_name,
+                               AG_EDGE_COLNAME_START_ID,
+                               AG_EDGE_COLNAME_END_ID);
+    create_edge_endpoint_index(schema_name, rel_name, in_index_name,
+                               AG_EDGE_COLNAME_END_ID,
+                               AG_EDGE_COLNAME_START_ID);
+
+    // CLUSTER `schema_name`.`rel_name` USING `out_index_name`
+    cluster_stmt = makeNode(ClusterStmt);
+    cluster_stmt->relation = makeRangeVar(schema_name, rel_name, -1);
+    cluster_stmt->indexname = out_index_name;
+    cluster_stmt->params = NIL;
+
+    process_utility_subcommand((Node *)cluster_stmt,
+                               "(generated CLUSTER command)");
+}
+
+// CREATE INDEX IF NOT EXISTS `index_name` ON `schema_name`.`rel_name`
+//   (`first_column`, `second_column`)
+static void create_edge_endpoint_index(char *schema_name, char *rel_name,
+                                       char *index_name, char *first_column,
+                                       char *second_column)
+{
+    IndexStmt *index_stmt;
+    IndexElem *first;
+    IndexElem *second;
+
+    first = makeNode(IndexElem);
+    first->name = first_column;
+    first->ordering = SORTBY_DEFAULT;
+    first->nulls_ordering = SORTBY_NULLS_DEFAULT;
+
+    second = makeNode(IndexElem);
+    second->name = second_column;
+    second->ordering = SORTBY_DEFAULT;
+    second->nulls_ordering = SORTBY_NULLS_DEFAULT;
+
+    index_stmt = makeNode(IndexStmt);
+    index_stmt->idxname = index_name;
+    index_stmt->relation = makeRangeVar(schema_name, rel_name, -1);
+    index_stmt->accessMethod = DEFAULT_INDEX_TYPE;
+    index_stmt->indexParams = list_make2(first, second);
+    index_stmt->if_not_exists = true;
+
+    process_utility_subcommand((Node *)index_stmt,
+                               "(generated CREATE INDEX command)");
+}
+
+static void process_utility_subcommand(Node *stmt, const char *query_string)
+{
+    PlannedStmt *wrapper;
+
+    wrapper = makeNode(PlannedStmt);
+    wrapper->commandType = CMD_UTILITY;
+    wrapper->canSetTag = false;
+    wrapper->utilityStmt = stmt;
+    wrapper->stmt_location = -1;
+    wrapper->stmt_len = 0;
+
+    ProcessUtility(wrapper, query_string, false, PROCESS_UTILITY_SUBCOMMAND,
+                   NULL, NULL, None_Receiver, NULL);
+}
+
 // deletes all the graphs in the list.
 void drop_graphs(List *graphnames)
 {
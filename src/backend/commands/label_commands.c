@@ -22,6 +22,7 @@
 #include "access/heapam.h"
 #include "access/xact.h"
 #include "catalog/dependency.h"
+#include "catalog/index.h"
 #include "catalog/namespace.h"
 #include "catalog/objectaddress.h"
 #include "catalog/pg_class_d.h"
@@ -59,18 +60,30 @@
  */
 #define gen_label_relation_name(label_name) (label_name)
 
+static void create_label_internal(char *graph_name, char *label_name,
+                                  char label_type, List *parents,
+                                  bool partitioned, int32 hash_partitions);
 static void create_table_for_label(char *graph_name, char *label_name,
                                    char *schema_name, char *rel_name,
                                    char *seq_name, char label_type,
-                                   List *parents);
+                                   List *parents, PartitionSpec *partspec,
+                                   PartitionBoundSpec *partbound);
+static bool is_partitioned_parent(List *parents);
+static PartitionSpec *build_label_partition_spec(char *strategy,
+                                                 char *column_name);
+static PartitionBoundSpec *build_label_partition_bound(int32 label_id);
+static PartitionBoundSpec *build_hash_partition_bound(int32 modulus,
+                                                      int32 remainder);
+static Node *build_graphid_bound_datum(uint64 value);
+static void create_index_on_label_id(char *schema_name, char *rel_name);
 
 // common
 static List *create_edge_table_elements(char *graph_name, char *label_name,
                                         char *schema_name, char *rel_name,
-                                        char *seq_name);
+                                        char *seq_name, bool primary_key);
 static List *create_vertex_table_elements(char *graph_name, char *label_name,
                                           char *schema_name, char *rel_name,
-                                          char *seq_name);
+                                          char *seq_name, bool primary_key);
 static void create_sequence_for_label(RangeVar *seq_range_var);
 static Constraint *build_pk_constraint(void);
 static Constraint *build_id_default(char *graph_name, char *label_name,
@@ -180,9 +193,10 @@ PG_FUNCTION_INFO_V1(create_elabel);
 /*
  * This is a callback function
  * This function will be called when the user will call SELECT create_elabel.
- * The function takes two parameters
+ * The function takes three parameters
  * 1. Graph name
  * 2. Label Name
+ * 3. Number of hash partitions on start_id, 0 for a plain table
  * Function will create an edge label
  * Function returns an error if graph or label names or not provided
 */
@@ -200,6 +214,7 @@ Datum create_elabel(PG_FUNCTION_ARGS)
     char *label;
     Name label_name;
     char *label_name_str;
+    int32 partitions;
 
     // checking if user has not provided the graph name
     if (PG_ARGISNULL(0))
@@ -217,6 +232,13 @@ Datum create_elabel(PG_FUNCTION_ARGS)
 
     graph_name = PG_GETARG_NAME(0);
     label_name = PG_GETARG_NAME(1);
+    partitions = PG_ARGISNULL(2) ? 0 : PG_GETARG_INT32(2);
+
+    if (partitions < 0)
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("number of partitions must not be negative")));
+    }
 
     graph_name_str = NameStr(*graph_name);
     label_name_str = NameStr(*label_name);
@@ -246,7 +268,8 @@ Datum create_elabel(PG_FUNCTION_ARGS)
     rv = get_label_range_var(graph, graph_oid, AG_DEFAULT_LABEL_EDGE);
 
     parent = list_make1(rv);
-    create_label(graph, label, LABEL_TYPE_EDGE, parent);
+    create_label_internal(graph, label, LABEL_TYPE_EDGE, parent, false,
+                          partitions);
 
     ereport(NOTICE,
             (errmsg("ELabel \"%s\" has been created", NameStr(*label_name))));
@@ -261,6 +284,33 @@ Datum create_elabel(PG_FUNCTION_ARGS)
  */
 void create_label(char *graph_name, char *label_name, char label_type,
                   List *parents)
+{
+    create_label_internal(graph_name, label_name, label_type, parents, false,
+                          0);
+}
+
+/*
+ * Creates a default label of a graph created with partitioned => true. The
+ * label table is range partitioned on "id", one partition per label id, so
+ * the label bits of a graphid select the partition. The rows of the default
+ * label itself go to a partition that is not a label. The default labels have
+ * a plain index on "id" instead of a primary key, because a unique constraint
+ * would have to include the start_id key of hash partitioned labels.
+ */
+void create_partitioned_label(char *graph_name, char *label_name,
+                              char label_type)
+{
+    create_label_internal(graph_name, label_name, label_type, NIL, true, 0);
+}
+
+/*
+ * When hash_partitions is greater than 0, the label table of the new edge
+ * label is itself hash partitioned on start_id into that many partitions.
+ * This is only possible for the labels of a partitioned graph.
+ */
+static void create_label_internal(char *graph_name, char *label_name,
+                                  char label_type, List *parents,
+                                  bool partitioned, int32 hash_partitions)
 {
     graph_cache_data *cache_data;
     Oid graph_oid;
@@ -271,6 +321,9 @@ void create_label(char *graph_name, char *label_name, char label_type,
     RangeVar *seq_range_var;
     int32 label_id;
     Oid relation_id;
+    PartitionSpec *partspec = NULL;
+    PartitionBoundSpec *partbound = NULL;
+    int32 i;
 
     cache_data = search_graph_name_cache(graph_name);
     if (!cache_data)
@@ -278,6 +331,14 @@ void create_label(char *graph_name, char *label_name, char label_type,
         ereport(ERROR, (errcode(ERRCODE_UNDEFINED_SCHEMA),
                         errmsg("graph \"%s\" does not exist", graph_name)));
     }
+
+    if (hash_partitions > 0 && !is_partitioned_parent(parents))
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("hash partitioned labels require a graph created with partitioned => true")));
+    }
+
     graph_oid = cache_data->oid;
     nsp_id = cache_data->namespace;
 
@@ -288,13 +349,57 @@ void create_label(char *graph_name, char *label_name, char label_type,
     seq_range_var = makeRangeVar(schema_name, seq_name, -1);
     create_sequence_for_label(seq_range_var);
 
+    // get a new "id" for the new label
+    label_id = get_new_label_id(graph_oid, nsp_id);
+
+    // the labels of a partitioned graph are partitions of the default label
+    if (partitioned)
+        partspec = build_label_partition_spec("range", AG_VERTEX_COLNAME_ID);
+    else if (is_partitioned_parent(parents))
+        partbound = build_label_partition_bound(label_id);
+
+    if (hash_partitions > 0)
+        partspec = build_label_partition_spec("hash",
+                                              AG_EDGE_COLNAME_START_ID);
+
     // create a table for the new label
     create_table_for_label(graph_name, label_name, schema_name, rel_name,
-                           seq_name, label_type, parents);
+                           seq_name, label_type, parents, partspec,
+                           partbound);
 
     // record the new label in ag_label
     relation_id = get_relname_relid(rel_name, nsp_id);
 
+    // create the partition that holds the rows of the label itself
+    if (partitioned)
+    {
+        char *part_name = ChooseRelationName(rel_name, NULL, "rows", nsp_id,
+                                             false);
+
+        create_table_for_label(graph_name, label_name, schema_name, part_name,
+                               seq_name, label_type,
+                               list_make1(makeRangeVar(schema_name, rel_name,
+                                                       -1)),
+                               NULL, build_label_partition_bound(label_id));
+
+        create_index_on_label_id(schema_name, rel_name);
+    }
+
+    // create the hash partitions that hold the rows of the label
+    for (i = 0; i < hash_partitions; i++)
+    {
+        char *part_name = ChooseRelationName(rel_name, NULL,
+                                             psprintf("p%d", i), nsp_id,
+                                             false);
+
+        create_table_for_label(graph_name, label_name, schema_name, part_name,
+                               seq_name, label_type,
+                               list_make1(makeRangeVar(schema_name, rel_name,
+                                                       -1)),
+                               NULL,
+                               build_hash_partition_bound(hash_partitions, i));
+    }
+
     // If a label has parents, switch the parents id default, with its own.
     if (list_length(parents) != 0)
         change_label_id_default(graph_name, label_name, schema_name, seq_name,
@@ -303,9 +408,6 @@ void create_label(char *graph_name, char *label_name, char label_type,
     // associate the sequence with the "id" column
     alter_sequence_owned_by_for_label(seq_range_var, rel_name);
 
-    // get a new "id" for the new label
-    label_id = get_new_label_id(graph_oid, nsp_id);
-
     insert_label(label_name, graph_oid, label_id, label_type, relation_id);
 
     CommandCounterIncrement();
@@ -316,11 +418,19 @@ void create_label(char *graph_name, char *label_name, char label_type,
 //   "start_id" graphid NOT NULL note: only for edge labels
 //   "end_id" graphid NOT NULL  note: only for edge labels
 //   "properties" gtype NOT NULL DEFAULT CATALOG_SCHEMA."gtype_build_map"()
-// )
+// ) [ PARTITION BY RANGE ("id") ]
+//
+// or, for the labels of a partitioned graph,
+//
+// CREATE TABLE `schema_name`.`rel_name` PARTITION OF `parent`
+//   FOR VALUES FROM (...) TO (...) [ PARTITION BY HASH ("start_id") ]
+//
+// A partitioned table is created without the primary key.
 static void create_table_for_label(char *graph_name, char *label_name,
                                    char *schema_name, char *rel_name,
                                    char *seq_name, char label_type,
-                                   List *parents)
+                                   List *parents, PartitionSpec *partspec,
+                                   PartitionBoundSpec *partbound)
 {
     CreateStmt *create_stmt;
     PlannedStmt *wrapper;
@@ -339,16 +449,19 @@ static void create_table_for_label(char *graph_name, char *label_name,
         create_stmt->tableElts = NIL;
     else if (label_type == LABEL_TYPE_EDGE)
         create_stmt->tableElts = create_edge_table_elements(
-            graph_name, label_name, schema_name, rel_name, seq_name);
+            graph_name, label_name, schema_name, rel_name, seq_name,
+            partspec == NULL);
     else if (label_type == LABEL_TYPE_VERTEX)
         create_stmt->tableElts = create_vertex_table_elements(
-            graph_name, label_name, schema_name, rel_name, seq_name);
+            graph_name, label_name, schema_name, rel_name, seq_name,
+            partspec == NULL);
     else
         ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
                         errmsg("undefined label type \'%c\'", label_type)));
 
     create_stmt->inhRelations = parents;
-    create_stmt->partbound = NULL;
+    create_stmt->partbound = partbound;
+    create_stmt->partspec = partspec;
     create_stmt->ofTypename = NULL;
     create_stmt->constraints = NIL;
     create_stmt->options = NIL;
@@ -369,6 +482,143 @@ static void create_table_for_label(char *graph_name, char *label_name,
     // CommandCounterIncrement() is called in ProcessUtility()
 }
 
+// returns true if the parent of a new label is range partitioned on "id"
+static bool is_partitioned_parent(List *parents)
+{
+    Oid parent_relid;
+
+    if (list_length(parents) != 1)
+        return false;
+
+    parent_relid = RangeVarGetRelid(linitial(parents), NoLock, false);
+
+    return get_rel_relkind(parent_relid) == RELKIND_PARTITIONED_TABLE;
+}
+
+// PARTITION BY `strategy` (`column_name`)
+static PartitionSpec *build_label_partition_spec(char *strategy,
+                                                 char *column_name)
+{
+    PartitionSpec *partspec;
+    PartitionElem *column;
+
+    column = makeNode(PartitionElem);
+    column->name = column_name;
+    column->expr = NULL;
+    column->collation = NIL;
+    column->opclass = NIL;
+    column->location = -1;
+
+    partspec = makeNode(PartitionSpec);
+    partspec->strategy = strategy;
+    partspec->partParams = list_make1(column);
+    partspec->location = -1;
+
+    return partspec;
+}
+
+/*
+ * FOR VALUES FROM (`label_id` << ENTRY_ID_BITS)
+ *            TO ((`label_id` + 1) << ENTRY_ID_BITS)
+ *
+ * graphid is compared as a signed integer, so the label ids with the top bit
+ * set map to negative ranges. The range of the last label id with the top
+ * bit clear would wrap around, so it is bounded by MAXVALUE instead.
+ */
+static PartitionBoundSpec *build_label_partition_bound(int32 label_id)
+{
+    PartitionBoundSpec *partbound;
+    uint64 lower;
+    uint64 upper;
+    Node *upper_datum;
+
+    lower = ((uint64)label_id) << ENTRY_ID_BITS;
+    upper = ((uint64)label_id + 1) << ENTRY_ID_BITS;
+
+    if ((int64)upper < (int64)lower)
+    {
+        ColumnRef *maxvalue = makeNode(ColumnRef);
+
+        maxvalue->fields = list_make1(makeString("maxvalue"));
+        maxvalue->location = -1;
+        upper_datum = (Node *)maxvalue;
+    }
+    else
+    {
+        upper_datum = build_graphid_bound_datum(upper);
+    }
+
+    partbound = makeNode(PartitionBoundSpec);
+    partbound->strategy = PARTITION_STRATEGY_RANGE;
+    partbound->is_default = false;
+    partbound->lowerdatums = list_make1(build_graphid_bound_datum(lower));
+    partbound->upperdatums = list_make1(upper_datum);
+    partbound->location = -1;
+
+    return partbound;
+}
+
+// FOR VALUES WITH (MODULUS `modulus`, REMAINDER `remainder`)
+static PartitionBoundSpec *build_hash_partition_bound(int32 modulus,
+                                                      int32 remainder)
+{
+    PartitionBoundSpec *partbound;
+
+    partbound = makeNode(PartitionBoundSpec);
+    partbound->strategy = PARTITION_STRATEGY_HASH;
+    partbound->is_default = false;
+    partbound->modulus = modulus;
+    partbound->remainder = remainder;
+    partbound->location = -1;
+
+    return partbound;
+}
+
+// a string constant that is coerced to graphid by graphid_in()
+static Node *build_graphid_bound_datum(uint64 value)
+{
+    char buf[32]; // greater than MAXINT8LEN+1
+    A_Const *datum;
+
+    pg_lltoa((int64)value, buf);
+
+    datum = makeNode(A_Const);
+    datum->val.type = T_String;
+    datum->val.val.str = pstrdup(buf);
+    datum->location = -1;
+
+    return (Node *)datum;
+}
+
+// CREATE INDEX ON `schema_name`.`rel_name` ("id")
+static void create_index_on_label_id(char *schema_name, char *rel_name)
+{
+    IndexStmt *index_stmt;
+    IndexElem *id;
+    PlannedStmt *wrapper;
+
+    id = makeNode(IndexElem);
+    id->name = AG_VERTEX_COLNAME_ID;
+    id->ordering = SORTBY_DEFAULT;
+    id->nulls_ordering = SORTBY_NULLS_DEFAULT;
+
+    index_stmt = makeNode(IndexStmt);
+    index_stmt->relation = makeRangeVar(schema_name, rel_name, -1);
+    index_stmt->accessMethod = DEFAULT_INDEX_TYPE;
+    index_stmt->indexParams = list_make1(id);
+
+    wrapper = makeNode(PlannedStmt);
+    wrapper->commandType = CMD_UTILITY;
+    wrapper->canSetTag = false;
+    wrapper->utilityStmt = (Node *)index_stmt;
+    wrapper->stmt_location = -1;
+    wrapper->stmt_len = 0;
+
+    ProcessUtility(wrapper, "(generated CREATE INDEX command)", false,
+                   PROCESS_UTILITY_SUBCOMMAND, NULL, NULL, None_Receiver,
+                   NULL);
+}
+
 // CREATE TABLE `schema_name`.`rel_name` (
 //   "id" graphid PRIMARY KEY DEFAULT CATALOG_SCHEMA."_graphid"(...),
 //   "start_id" graphid NOT NULL
@@ -377,18 +627,19 @@ static void create_table_for_label(char *graph_name, char *label_name,
 // )
 static List *create_edge_table_elements(char *graph_name, char *label_name,
                                         char *schema_name, char *rel_name,
-                                        char *seq_name)
+                                        char *seq_name, bool primary_key)
 {
     ColumnDef *id;
     ColumnDef *start_id;
     ColumnDef *end_id;
     ColumnDef *props;
 
-    // "id" graphid PRIMARY KEY DEFAULT CATALOG_SCHEMA."_graphid"(...)
+    // "id" graphid [ PRIMARY KEY ] DEFAULT CATALOG_SCHEMA."_graphid"(...)
     id = makeColumnDef(AG_EDGE_COLNAME_ID, GRAPHIDOID, -1, InvalidOid);
-    id->constraints = list_make2(build_pk_constraint(),
-                                 build_id_default(graph_name, label_name,
+    id->constraints = list_make1(build_id_default(graph_name, label_name,
                                                   schema_name, seq_name));
+    if (primary_key)
+        id->constraints = lcons(build_pk_constraint(), id->constraints);
 
     // "start_id" graphid NOT NULL
     start_id = makeColumnDef(AG_EDGE_COLNAME_START_ID, GRAPHIDOID, -1,
@@ -414,16 +665,17 @@ static List *create_edge_table_elements(char *graph_name, char *label_name,
 // )
 static List *create_vertex_table_elements(char *graph_name, char *label_name,
                                           char *schema_name, char *rel_name,
-                                          char *seq_name)
+                                          char *seq_name, bool primary_key)
 {
     ColumnDef *id;
     ColumnDef *props;
 
-    // "id" graphid PRIMARY KEY DEFAULT CATALOG_SCHEMA."_graphid"(...)
+    // "id" graphid [ PRIMARY KEY ] DEFAULT CATALOG_SCHEMA."_graphid"(...)
     id = makeColumnDef(AG_VERTEX_COLNAME_ID, GRAPHIDOID, -1, InvalidOid);
-    id->constraints = list_make2(build_pk_constraint(),
-                                 build_id_default(graph_name, label_name,
+    id->constraints = list_make1(build_id_default(graph_name, label_name,
                                                   schema_name, seq_name));
+    if (primary_key)
+        id->constraints = lcons(build_pk_constraint(), id->constraints);
 
     // "properties" gtype NOT NULL DEFAULT CATALOG_SCHEMA."gtype_build_map"()
     props = makeColumnDef(AG_VERTEX_COLNAME_PROPERTIES, GTYPEOID, -1,
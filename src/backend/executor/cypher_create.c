@@ -69,35 +69,22 @@ const CustomExecMethods cypher_create_exec_methods = {CREATE_SCAN_STATE_NAME,
                                                       NULL,
                                                       NULL};
 
-static void
-append_to_buffer(StringInfo buffer, const char *data, int len) {
-    int offset = reserve_from_buffer(buffer, len);
-    memcpy(buffer->data + offset, data, len);
-}
-
 
 static Datum create_traversal(List *entities) {
     ListCell *lc;
-    StringInfoData buffer;
-    initStringInfo(&buffer);
-
-    // header
-    reserve_from_buffer(&buffer, VARHDRSZ);
+    path_builder pb;
+    int i = 0;
 
-    // length
-    reserve_from_buffer(&buffer, sizeof(pentry));
+    init_traversal(&pb, list_length(entities));
 
     foreach(lc, entities) {
-	Datum d = lfirst(lc);
-        append_to_buffer(&buffer, d, VARSIZE_ANY(d));
-    }
-
-    traversal *p = (traversal *)buffer.data;
+        Datum d = PointerGetDatum(lfirst(lc));
 
-    p->children[0] = list_length(entities);
-    SET_VARSIZE(p, buffer.len);
+        // the entities may come from a scanned tuple, compressed or out of line
+        append_traversal_entity(&pb, i++, (char *)PG_DETOAST_DATUM(d));
+    }
 
-    return TRAVERSAL_GET_DATUM(p);
+    return TRAVERSAL_GET_DATUM(finish_path_builder(&pb));
 }
 
 static void begin_cypher_create(CustomScanState *node, EState *estate, int eflags) {
@@ -133,7 +120,8 @@ static void begin_cypher_create(CustomScanState *node, EState *estate, int eflag
                 continue;
 
             // Open relation and aquire a row exclusive lock.
-            rel = table_open(cypher_node->relid, RowExclusiveLock);
+            rel = table_open(get_label_storage_relation(cypher_node->relid),
+                             RowExclusiveLock);
 
             // Initialize resultRelInfo for the vertex
             cypher_node->resultRelInfo = makeNode(ResultRelInfo);
@@ -19,11 +19,16 @@
 
 #include "postgres.h"
 
+#include "access/genam.h"
 #include "access/heapam.h"
 #include "access/htup_details.h"
 #include "access/multixact.h"
+#include "access/stratnum.h"
 #include "access/table.h"
+#include "access/tableam.h"
 #include "access/xact.h"
+#include "catalog/pg_am_d.h"
+#include "catalog/pg_index.h"
 #include "executor/tuptable.h"
 #include "nodes/execnodes.h"
 #include "nodes/extensible.h"
@@ -52,6 +57,20 @@ static void process_delete_list(CustomScanState *node);
 static void find_connected_edges(CustomScanState *node, char *graph_name,
                                  List *labels, char *var_name, graphid id,
                                  bool detach_delete);
+static void scan_connected_edges(EState *estate,
+                                 ResultRelInfo *resultRelInfo, char *var_name,
+                                 graphid id, bool detach_delete);
+static void index_scan_connected_edges(EState *estate,
+                                       ResultRelInfo *resultRelInfo,
+                                       Relation index, char *var_name,
+                                       graphid id, bool detach_delete,
+                                       bool skip_self_loops);
+static Relation find_endpoint_index(ResultRelInfo *resultRelInfo,
+                                    AttrNumber attnum);
+static void delete_connected_edge(EState *estate,
+                                  ResultRelInfo *resultRelInfo,
+                                  HeapTuple tuple, char *var_name,
+                                  bool detach_delete);
 static void delete_entity(EState *estate, ResultRelInfo *resultRelInfo,
                           HeapTuple tuple);
 
@@ -356,6 +375,7 @@ static void process_delete_list(CustomScanState *node) {
              char *label = extract_edge_label(e);
 
              resultRelInfo = create_entity_result_rel_info(estate, css->delete_data->graph_name, label); 
+             resultRelInfo = route_edge_result_rel_info(estate, resultRelInfo, EXTRACT_EDGE_STARTID(e));
 
 	     ScanKeyInit(&scan_keys[0], Anum_ag_label_edge_table_id,
                          BTEqualStrategyNumber, F_GRAPHIDEQ, GRAPHID_GET_DATUM(gid));
@@ -409,75 +429,189 @@ static void find_connected_edges(CustomScanState *node, char *graph_name,
     cypher_delete_custom_scan_state *css =
         (cypher_delete_custom_scan_state *)node;
     EState *estate = css->css.ss.ps.state;
+    List *resultRelInfos = NIL;
     ListCell *lc;
 
     Increment_Estate_CommandId(estate);
 
     /*
-     * We need to scan through all the edges to see if this vertex has
-     * any edges attached to it.
-     *
-     * XXX: If we implement an on-disc graph storage system. Such as
-     * an adjacency matrix, the performace of this check can be massively
-     * improved. However, right now we have to scan every edge to see if
-     * one has this vertex as a start or end vertex.
+     * We need to check all the edges to see if this vertex has any edges
+     * attached to it. An edge table with btree indexes leading with start_id
+     * and end_id, such as the ones cluster_graph() creates, is searched
+     * through them. Otherwise every edge of the table has to be scanned to
+     * see if one has this vertex as a start or end vertex.
      */
     foreach(lc, labels)
     {
         char *label_name = lfirst(lc);
-        ResultRelInfo *resultRelInfo;
-        TableScanDesc scan_desc;
-        HeapTuple tuple;
-        TupleTableSlot *slot;
 
-        resultRelInfo = create_entity_result_rel_info(estate,
-                                                      graph_name, label_name);
+        // a hash partitioned label is scanned one partition at a time
+        resultRelInfos = list_concat(resultRelInfos,
+                                     create_entity_result_rel_infos(
+                                         estate, graph_name, label_name));
+    }
 
-        scan_desc = table_beginscan(resultRelInfo->ri_RelationDesc,
-                                    estate->es_snapshot, 0, NULL);
+    foreach(lc, resultRelInfos)
+    {
+        ResultRelInfo *resultRelInfo = lfirst(lc);
+        Relation start_index;
+        Relation end_index;
 
-        slot = ExecInitExtraTupleSlot(
-            estate, RelationGetDescr(resultRelInfo->ri_RelationDesc),
-            &TTSOpsHeapTuple);
+        start_index = find_endpoint_index(resultRelInfo,
+                                          Anum_ag_label_edge_table_start_id);
+        end_index = find_endpoint_index(resultRelInfo,
+                                        Anum_ag_label_edge_table_end_id);
 
-        // scan the table
-        while(true)
+        if (start_index != NULL && end_index != NULL)
         {
-            graphid startid, endid;
-            bool isNull;
+            index_scan_connected_edges(estate, resultRelInfo, start_index,
+                                       var_name, id, detach_delete, false);
+            // self loops were found through start_id already
+            index_scan_connected_edges(estate, resultRelInfo, end_index,
+                                       var_name, id, detach_delete, true);
+        }
+        else
+        {
+            scan_connected_edges(estate, resultRelInfo, var_name, id,
+                                 detach_delete);
+        }
 
-            tuple = heap_getnext(scan_desc, ForwardScanDirection);
+        destroy_entity_result_rel_info(resultRelInfo);
+    }
 
-            // no more tuples to process, break and scan the next label.
-            if (!HeapTupleIsValid(tuple))
-                break;
+    Decrement_Estate_CommandId(estate);
+}
+
+// scans the whole edge table for the edges of the vertex
+static void scan_connected_edges(EState *estate,
+                                 ResultRelInfo *resultRelInfo, char *var_name,
+                                 graphid id, bool detach_delete)
+{
+    TableScanDesc scan_desc;
+    HeapTuple tuple;
+    TupleTableSlot *slot;
 
-            ExecStoreHeapTuple(tuple, slot, false);
-
-            startid = GRAPHID_GET_DATUM(slot_getattr(slot, Anum_ag_label_edge_table_start_id, &isNull));
-            endid = GRAPHID_GET_DATUM(slot_getattr(slot, Anum_ag_label_edge_table_end_id, &isNull));
-
-            if (id == startid || id == endid)
-            {
-                /*
-                 * We have found an edge that uses the vertex. Either delete the
-                 * edge or throw an error. Depending on whether the DETACH
-                 * option was specified in the query.
-                 */
-                if (detach_delete)
-                    delete_entity(estate, resultRelInfo, tuple);
-                else
-                    ereport(ERROR,
-                            (errcode(ERRCODE_INTERNAL_ERROR),
-                             errmsg("Cannot delete vertex %s, because it still has edges attached. "
-                                    "To delete this vertex, you must first delete the attached edges.",
-                                    var_name)));
-            }
+    scan_desc = table_beginscan(resultRelInfo->ri_RelationDesc,
+                                estate->es_snapshot, 0, NULL);
+
+    slot = ExecInitExtraTupleSlot(
+        estate, RelationGetDescr(resultRelInfo->ri_RelationDesc),
+        &TTSOpsHeapTuple);
+
+    // scan the table
+    while(true)
+    {
+        graphid startid, endid;
+        bool isNull;
+
+        tuple = heap_getnext(scan_desc, ForwardScanDirection);
+
+        // no more tuples to process, break and scan the next label.
+        if (!HeapTupleIsValid(tuple))
+            break;
+
+        ExecStoreHeapTuple(tuple, slot, false);
+
+        startid = GRAPHID_GET_DATUM(slot_getattr(slot, Anum_ag_label_edge_table_start_id, &isNull));
+        endid = GRAPHID_GET_DATUM(slot_getattr(slot, Anum_ag_label_edge_table_end_id, &isNull));
+
+        if (id == startid || id == endid)
+            delete_connected_edge(estate, resultRelInfo, tuple, var_name,
+                                  detach_delete);
+    }
+
+    table_endscan(scan_desc);
+}
+
+/*
+ * Looks up the edges of the vertex in an index whose first column is one of
+ * the endpoints. When skip_self_loops is set, the edges that start at the
+ * vertex are skipped, because they were found through the start_id index.
+ */
+static void index_scan_connected_edges(EState *estate,
+                                       ResultRelInfo *resultRelInfo,
+                                       Relation index, char *var_name,
+                                       graphid id, bool detach_delete,
+                                       bool skip_self_loops)
+{
+    Relation rel = resultRelInfo->ri_RelationDesc;
+    IndexScanDesc scan_desc;
+    ScanKeyData scan_keys[1];
+    TupleTableSlot *slot;
+
+    ScanKeyInit(&scan_keys[0], 1, BTEqualStrategyNumber, F_GRAPHIDEQ,
+                GRAPHID_GET_DATUM(id));
+
+    slot = table_slot_create(rel, NULL);
+
+    scan_desc = index_beginscan(rel, index, estate->es_snapshot, 1, 0);
+    index_rescan(scan_desc, scan_keys, 1, NULL, 0);
+
+    while (index_getnext_slot(scan_desc, ForwardScanDirection, slot))
+    {
+        HeapTupleData tuple;
+
+        if (skip_self_loops)
+        {
+            bool isNull;
+            graphid startid = DATUM_GET_GRAPHID(slot_getattr(
+                slot, Anum_ag_label_edge_table_start_id, &isNull));
+
+            if (startid == id)
+                continue;
         }
 
-        table_endscan(scan_desc);
-        destroy_entity_result_rel_info(resultRelInfo);
+        // delete_entity() locks the tuple, which reads it by its TID
+        tuple.t_self = slot->tts_tid;
+        tuple.t_tableOid = RelationGetRelid(rel);
+
+        delete_connected_edge(estate, resultRelInfo, &tuple, var_name,
+                              detach_delete);
     }
 
-    Decrement_Estate_CommandId(estate);
+    index_endscan(scan_desc);
+    ExecDropSingleTupleTableSlot(slot);
+}
+
+/*
+ * Returns a valid, non-partial btree index of the edge table whose first
+ * column is the given endpoint column, or NULL when there is none.
+ */
+static Relation find_endpoint_index(ResultRelInfo *resultRelInfo,
+                                    AttrNumber attnum)
+{
+    int i;
+
+    for (i = 0; i < resultRelInfo->ri_NumIndices; i++)
+    {
+        Relation index = resultRelInfo->ri_IndexRelationDescs[i];
+
+        if (index->rd_rel->relam == BTREE_AM_OID &&
+            index->rd_index->indisvalid &&
+            index->rd_index->indkey.values[0] == attnum &&
+            heap_attisnull(index->rd_indextuple, Anum_pg_index_indpred, NULL))
+            return index;
+    }
+
+    return NULL;
+}
+
+/*
+ * We have found an edge that uses the vertex. Either delete the edge or
+ * throw an error. Depending on whether the DETACH option was specified in
+ * the query.
+ */
+static void delete_connected_edge(EState *estate,
+                                  ResultRelInfo *resultRelInfo,
+                                  HeapTuple tuple, char *var_name,
+                                  bool detach_delete)
+{
+    if (detach_delete)
+        delete_entity(estate, resultRelInfo, tuple);
+    else
+        ereport(ERROR,
+                (errcode(ERRCODE_INTERNAL_ERROR),
+                 errmsg("Cannot delete vertex %s, because it still has edges attached. "
+                        "To delete this vertex, you must first delete the attached edges.",
+                        var_name)));
 }
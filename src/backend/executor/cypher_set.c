@@ -499,6 +499,7 @@ static void process_update_list(CustomScanState *node)
                                                   new_property_value, remove_property);
 
             resultRelInfo = create_entity_result_rel_info(estate, css->set_list->graph_name, label_name);
+            resultRelInfo = route_edge_result_rel_info(estate, resultRelInfo, startid);
 
             slot = ExecInitExtraTupleSlot(estate, RelationGetDescr(resultRelInfo->ri_RelationDesc), &TTSOpsHeapTuple);
 
@@ -49,6 +49,10 @@
 #include "utils/gtype.h"
 #include "utils/graphid.h"
 
+static ResultRelInfo *get_partition_result_rel_info(EState *estate,
+                                                    ResultRelInfo *root,
+                                                    Oid partition);
+
 /*
  * Given the graph name and the label name, create a ResultRelInfo for the table
  * those to variables represent. Open the Indices too.
@@ -75,6 +79,19 @@ ResultRelInfo *create_entity_result_rel_info(EState *estate, char *graph_name,
 
     label_relation = parserOpenTable(pstate, rv, RowExclusiveLock);
 
+    // partitioned default labels keep their rows in a partition
+    if (label_relation->rd_rel->relkind == RELKIND_PARTITIONED_TABLE)
+    {
+        Oid relid = RelationGetRelid(label_relation);
+        Oid storage = get_label_storage_relation(relid);
+
+        if (storage != relid)
+        {
+            table_close(label_relation, NoLock);
+            label_relation = table_open(storage, RowExclusiveLock);
+        }
+    }
+
     // initialize the resultRelInfo
     InitResultRelInfo(resultRelInfo, label_relation,
                       list_length(estate->es_range_table), NULL,
@@ -88,6 +105,108 @@ ResultRelInfo *create_entity_result_rel_info(EState *estate, char *graph_name,
     return resultRelInfo;
 }
 
+/*
+ * Create a ResultRelInfo for every table that holds rows of the given label.
+ * That is the label table itself, unless the label table is partitioned.
+ */
+List *create_entity_result_rel_infos(EState *estate, char *graph_name,
+                                     char *label_name)
+{
+    ResultRelInfo *resultRelInfo;
+    List *result = NIL;
+    ListCell *lc;
+
+    resultRelInfo = create_entity_result_rel_info(estate, graph_name,
+                                                  label_name);
+    if (resultRelInfo->ri_RelationDesc->rd_rel->relkind !=
+        RELKIND_PARTITIONED_TABLE)
+        return list_make1(resultRelInfo);
+
+    foreach (lc, get_label_storage_relations(
+                     RelationGetRelid(resultRelInfo->ri_RelationDesc)))
+    {
+        ResultRelInfo *partition = palloc(sizeof(ResultRelInfo));
+
+        InitResultRelInfo(partition, table_open(lfirst_oid(lc),
+                                                RowExclusiveLock),
+                          list_length(estate->es_range_table), NULL,
+                          estate->es_instrument);
+        ExecOpenIndices(partition, false);
+
+        result = lappend(result, partition);
+    }
+
+    destroy_entity_result_rel_info(resultRelInfo);
+
+    return result;
+}
+
+/*
+ * If the ResultRelInfo is for an edge label that is hash partitioned on
+ * start_id, replace it with one for the partition that holds the edges
+ * starting at start_id.
+ */
+ResultRelInfo *route_edge_result_rel_info(EState *estate,
+                                          ResultRelInfo *resultRelInfo,
+                                          graphid start_id)
+{
+    Oid partition;
+
+    if (resultRelInfo->ri_RelationDesc->rd_rel->relkind !=
+        RELKIND_PARTITIONED_TABLE)
+        return resultRelInfo;
+
+    partition = get_label_partition_for_start_id(
+        RelationGetRelid(resultRelInfo->ri_RelationDesc), start_id);
+
+    destroy_entity_result_rel_info(resultRelInfo);
+
+    resultRelInfo = palloc(sizeof(ResultRelInfo));
+    InitResultRelInfo(resultRelInfo, table_open(partition, RowExclusiveLock),
+                      list_length(estate->es_range_table), NULL,
+                      estate->es_instrument);
+    ExecOpenIndices(resultRelInfo, false);
+
+    return resultRelInfo;
+}
+
+/*
+ * Returns the ResultRelInfo of a partition of a hash partitioned edge label,
+ * for the inserts into the label. These are kept with the tuple routing
+ * result relations of the executor, which closes them at the end of the
+ * query.
+ */
+static ResultRelInfo *get_partition_result_rel_info(EState *estate,
+                                                    ResultRelInfo *root,
+                                                    Oid partition)
+{
+    ResultRelInfo *resultRelInfo;
+    MemoryContext oldcxt;
+    ListCell *lc;
+
+    foreach (lc, estate->es_tuple_routing_result_relations)
+    {
+        resultRelInfo = lfirst(lc);
+
+        if (RelationGetRelid(resultRelInfo->ri_RelationDesc) == partition)
+            return resultRelInfo;
+    }
+
+    oldcxt = MemoryContextSwitchTo(estate->es_query_cxt);
+
+    resultRelInfo = makeNode(ResultRelInfo);
+    InitResultRelInfo(resultRelInfo, table_open(partition, RowExclusiveLock),
+                      0, root, estate->es_instrument);
+    ExecOpenIndices(resultRelInfo, false);
+
+    estate->es_tuple_routing_result_relations =
+        lappend(estate->es_tuple_routing_result_relations, resultRelInfo);
+
+    MemoryContextSwitchTo(oldcxt);
+
+    return resultRelInfo;
+}
+
 // close the result_rel_info and close all the indices
 void destroy_entity_result_rel_info(ResultRelInfo *result_rel_info)
 {
@@ -189,7 +308,8 @@ bool entity_exists(EState *estate, Oid graph_oid, graphid id)
     ScanKeyInit(&scan_keys[0], 1, BTEqualStrategyNumber,
                 F_GRAPHIDEQ, GRAPHID_GET_DATUM(id));
 
-    rel = table_open(label->relation, RowExclusiveLock);
+    rel = table_open(get_label_storage_relation(label->relation),
+                     RowExclusiveLock);
     scan_desc = table_beginscan(rel, estate->es_snapshot, 1, scan_keys);
 
     tuple = heap_getnext(scan_desc, ForwardScanDirection);
@@ -238,6 +358,21 @@ HeapTuple insert_entity_tuple_cid(ResultRelInfo *resultRelInfo,
     HeapTuple tuple = NULL;
 
     ExecStoreVirtualTuple(elemTupleSlot);
+
+    // edges of a hash partitioned label go to the partition of their start_id
+    if (resultRelInfo->ri_RelationDesc->rd_rel->relkind ==
+        RELKIND_PARTITIONED_TABLE)
+    {
+        bool isnull;
+        graphid start_id = DATUM_GET_GRAPHID(slot_getattr(
+            elemTupleSlot, Anum_ag_label_edge_table_start_id, &isnull));
+        Oid partition = get_label_partition_for_start_id(
+            RelationGetRelid(resultRelInfo->ri_RelationDesc), start_id);
+
+        resultRelInfo = get_partition_result_rel_info(estate, resultRelInfo,
+                                                      partition);
+    }
+
     tuple = ExecFetchSlotHeapTuple(elemTupleSlot, true, NULL);
 
     /* Check the constraints of the tuple */
@@ -776,8 +776,8 @@ static Query *transform_cypher_delete(cypher_parsestate *cpstate, cypher_clause
 /*
  * transform_cypher_unwind
  *      It contains logic to convert the form of an array into a row. Here, we
- *      are simply calling `age_unnest` function, and the actual transformation
- *      is handled by `age_unnest` function.
+ *      are simply calling `unnest` function, and the actual transformation
+ *      is handled by `unnest` function, or by `unnest_range` for range().
  */
 static Query *transform_cypher_unwind(cypher_parsestate *cpstate, cypher_clause *clause) {
     ParseState *pstate = (ParseState *) cpstate;
@@ -786,6 +786,7 @@ static Query *transform_cypher_unwind(cypher_parsestate *cpstate, cypher_clause
     Query *query;
     Node *expr;
     FuncCall *unwind;
+    List *args;
     ParseExprKind old_expr_kind;
     Node *funcexpr;
     TargetEntry *te;
@@ -812,12 +813,21 @@ static Query *transform_cypher_unwind(cypher_parsestate *cpstate, cypher_clause
 
     expr = transform_cypher_expr(cpstate, self->target->val, EXPR_KIND_SELECT_TARGET);
 
-    unwind = makeFuncCall(list_make1(makeString("unnest")), NIL, COERCE_SQL_SYNTAX, -1);
-
+    /*
+     * UNWIND range(...) generates the elements one at a time rather than
+     * building the list and unnesting it.
+     */
+    if (IsA(expr, FuncExpr) && is_oid_ag_func(((FuncExpr *)expr)->funcid, "range")) {
+        unwind = makeFuncCall(list_make1(makeString("unnest_range")), NIL, COERCE_SQL_SYNTAX, -1);
+        args = ((FuncExpr *)expr)->args;
+    } else {
+        unwind = makeFuncCall(list_make1(makeString("unnest")), NIL, COERCE_SQL_SYNTAX, -1);
+        args = list_make2(expr, makeBoolConst(true, false));
+    }
 
     old_expr_kind = pstate->p_expr_kind;
     pstate->p_expr_kind = EXPR_KIND_SELECT_TARGET;
-    funcexpr = ParseFuncOrColumn(pstate, unwind->funcname, list_make2(expr, makeBoolConst(true, false)),
+    funcexpr = ParseFuncOrColumn(pstate, unwind->funcname, args,
                                  pstate->p_last_srf, unwind, false, target_syntax_loc);
 
     pstate->p_expr_kind = old_expr_kind;
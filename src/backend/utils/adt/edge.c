@@ -22,26 +22,69 @@
 
 #include "postgraph.h"
 
+#include "access/genam.h"
 #include "access/relscan.h"
 #include "access/sdir.h"
 #include "access/skey.h"
 #include "access/table.h"
 #include "access/tableam.h"
+#include "catalog/pg_am.h"
+#include "nodes/makefuncs.h"
+#include "nodes/supportnodes.h"
 #include "utils/fmgrprotos.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/relcache.h"
 #include "utils/snapmgr.h"
 #include "utils/varlena.h"
 
 #include "catalog/ag_label.h"
 #include "commands/label_commands.h"
 #include "utils/ag_cache.h"
+#include "utils/ag_func.h"
+#include "utils/age_global_graph.h"
 #include "utils/gtype.h"
 #include "utils/graphid.h"
 #include "utils/edge.h"
 #include "utils/vertex.h"
 
+/*
+ * Number of vertices startNode()/endNode() keep per query. Edges are usually
+ * read grouped by one of their endpoints, so a small cache gets most hits.
+ */
+#define VERTEX_CACHE_SIZE 64
+
+typedef struct vertex_cache_entry
+{
+    graphid id;
+    Oid graph_oid;
+    uint64 last_used;
+    vertex *v;
+} vertex_cache_entry;
+
+/*
+ * Per-query state of startNode()/endNode(), kept in fn_extra: a small LRU
+ * cache of the vertices already returned, and the id index of the last
+ * label table that was searched. The cached vertices are only valid for the
+ * snapshot they were read with, see is_ggctx_invalid().
+ */
+typedef struct vertex_cache
+{
+    uint64 clock;
+    int nentries;
+    vertex_cache_entry entries[VERTEX_CACHE_SIZE];
+    Oid relation;
+    Oid index;
+    TransactionId xmin;
+    TransactionId xmax;
+    CommandId curcid;
+} vertex_cache;
+
 static void append_to_buffer(StringInfo buffer, const char *data, int len);
-static Datum get_vertex(const char *graph, const char *vertex_label, int64 graphid);
+static Datum get_vertex(FunctionCallInfo fcinfo, Oid graph_oid, graphid id);
+static vertex_cache *get_vertex_cache(FunctionCallInfo fcinfo);
+static vertex *fetch_vertex(vertex_cache *cache, Oid graph_oid, graphid id);
+static Oid find_vertex_id_index(Relation rel);
 
 /*
  * I/O routines for vertex type
@@ -211,6 +254,62 @@ edge_ne(PG_FUNCTION_ARGS) {
 /*
  * Functions
  */
+/*
+ * Planner support for the edge accessors, see vertex_accessor_support().
+ */
+PG_FUNCTION_INFO_V1(edge_accessor_support);
+Datum
+edge_accessor_support(PG_FUNCTION_ARGS) {
+    Node *rawreq = (Node *) PG_GETARG_POINTER(0);
+    SupportRequestSimplify *req;
+    FuncExpr *func;
+    FuncExpr *build;
+    Node *id;
+    FuncExpr *result;
+
+    if (!IsA(rawreq, SupportRequestSimplify))
+        PG_RETURN_POINTER(NULL);
+
+    req = (SupportRequestSimplify *) rawreq;
+    func = req->fcall;
+
+    if (list_length(func->args) < 1 || !IsA(linitial(func->args), FuncExpr))
+        PG_RETURN_POINTER(NULL);
+
+    build = linitial(func->args);
+    if (list_length(build->args) != 5 || !is_oid_ag_func(build->funcid, "build_edge") ||
+        !is_label_column(linitial(build->args), req->root, Anum_ag_label_edge_table_id) ||
+        !is_label_column(lsecond(build->args), req->root, Anum_ag_label_edge_table_start_id) ||
+        !is_label_column(lthird(build->args), req->root, Anum_ag_label_edge_table_end_id) ||
+        !is_label_column(list_nth(build->args, 4), req->root, Anum_ag_label_edge_table_properties))
+        PG_RETURN_POINTER(NULL);
+
+    if (is_oid_ag_func(func->funcid, "properties") || is_oid_ag_func(func->funcid, "age_properties"))
+        PG_RETURN_POINTER(list_nth(build->args, 4));
+
+    if (is_oid_ag_func(func->funcid, "edge_property_access_gtype")) {
+        result = makeFuncExpr(get_ag_func_oid("gtype_field_access", 2, GTYPEOID, GTYPEOID), GTYPEOID,
+                              list_make2(list_nth(build->args, 4), lsecond(func->args)), InvalidOid,
+                              func->inputcollid, COERCE_EXPLICIT_CALL);
+    } else {
+        if (is_oid_ag_func(func->funcid, "id"))
+            id = linitial(build->args);
+        else if (is_oid_ag_func(func->funcid, "start_id"))
+            id = lsecond(build->args);
+        else if (is_oid_ag_func(func->funcid, "end_id"))
+            id = lthird(build->args);
+        else
+            PG_RETURN_POINTER(NULL);
+
+        result = makeFuncExpr(get_ag_func_oid("graphid_to_gtype", 1, GRAPHIDOID), GTYPEOID,
+                              list_make1(id), InvalidOid, InvalidOid, COERCE_EXPLICIT_CALL);
+    }
+
+    result->location = func->location;
+
+    PG_RETURN_POINTER(result);
+}
+
 PG_FUNCTION_INFO_V1(edge_id);
 Datum
 edge_id(PG_FUNCTION_ARGS) {
@@ -263,94 +362,184 @@ edge_properties(PG_FUNCTION_ARGS) {
 
 PG_FUNCTION_INFO_V1(edge_startnode);
 Datum edge_startnode(PG_FUNCTION_ARGS) {
-    gtype *agt_arg = NULL;
-    gtype_value *agtv_object = NULL;
-    gtype_value *agtv_value = NULL;
-    char *graph_name = NULL;
-    char *label_name = NULL;
-    graphid graph_oid;
-    Datum result;
-
-    agt_arg = AG_GET_ARG_GTYPE_P(0);
-    Assert(AGT_ROOT_IS_SCALAR(agt_arg));
-    agtv_object = get_ith_gtype_value_from_container(&agt_arg->root, 0);
-    Assert(agtv_object->type == AGTV_STRING);
-    graph_name = strndup(agtv_object->val.string.val, agtv_object->val.string.len);
-
     edge *e = AG_GET_ARG_EDGE(1);
-    graph_oid = *((int64 *)(&e->children[2]));
-
-    label_name = get_label_name(graph_name, graph_oid);
-    Assert(label_name != NULL);
-    result = get_vertex(graph_name, label_name, graph_oid);
 
-    return result;
+    /*
+     * The graph name argument is kept for compatibility. The edge already
+     * carries the graph oid, which is all we need to find the vertex.
+     */
+    PG_RETURN_DATUM(get_vertex(fcinfo, EXTRACT_EDGE_GRAPH_OID(e), EXTRACT_EDGE_STARTID(e)));
 }
 
 
 PG_FUNCTION_INFO_V1(edge_endnode);
 Datum edge_endnode(PG_FUNCTION_ARGS) {
-    gtype *agt_arg = NULL;
-    gtype_value *agtv_object = NULL;
-    gtype_value *agtv_value = NULL;
-    char *graph_name = NULL;
-    char *label_name = NULL;
-    graphid graph_oid;
-    Datum result;
-
-    agt_arg = AG_GET_ARG_GTYPE_P(0);
-    Assert(AGT_ROOT_IS_SCALAR(agt_arg));
-    agtv_object = get_ith_gtype_value_from_container(&agt_arg->root, 0);
-    Assert(agtv_object->type == AGTV_STRING);
-    graph_name = strndup(agtv_object->val.string.val, agtv_object->val.string.len);
-
     edge *e = AG_GET_ARG_EDGE(1);
-    graph_oid = *((int64 *)(&e->children[4]));
 
-    label_name = get_label_name(graph_name, graph_oid);
-    Assert(label_name != NULL);
-    result = get_vertex(graph_name, label_name, graph_oid);
+    PG_RETURN_DATUM(get_vertex(fcinfo, EXTRACT_EDGE_GRAPH_OID(e), EXTRACT_EDGE_ENDID(e)));
+}
 
-    return result;
+/*
+ * Finds the vertex with the given id, checking the per-query cache first.
+ * The returned vertex is a copy in the caller's memory context, because
+ * the cached one can be evicted at any time.
+ */
+static Datum get_vertex(FunctionCallInfo fcinfo, Oid graph_oid, graphid id) {
+    vertex_cache *cache = get_vertex_cache(fcinfo);
+    vertex_cache_entry *entry = NULL;
+    vertex *v;
+
+    cache->clock++;
+
+    for (int i = 0; i < cache->nentries; i++) {
+        if (cache->entries[i].id == id && cache->entries[i].graph_oid == graph_oid) {
+            entry = &cache->entries[i];
+            entry->last_used = cache->clock;
+
+            v = palloc(VARSIZE(entry->v));
+            memcpy(v, entry->v, VARSIZE(entry->v));
+
+            return VERTEX_GET_DATUM(v);
+        }
+    }
+
+    v = fetch_vertex(cache, graph_oid, id);
+
+    // use a free slot if there is one, otherwise evict the least recently used entry
+    if (cache->nentries < VERTEX_CACHE_SIZE) {
+        entry = &cache->entries[cache->nentries++];
+    } else {
+        entry = &cache->entries[0];
+        for (int i = 1; i < VERTEX_CACHE_SIZE; i++)
+            if (cache->entries[i].last_used < entry->last_used)
+                entry = &cache->entries[i];
+
+        pfree(entry->v);
+    }
+
+    entry->id = id;
+    entry->graph_oid = graph_oid;
+    entry->last_used = cache->clock;
+    entry->v = MemoryContextAlloc(fcinfo->flinfo->fn_mcxt, VARSIZE(v));
+    memcpy(entry->v, v, VARSIZE(v));
+
+    return VERTEX_GET_DATUM(v);
 }
 
+static vertex_cache *get_vertex_cache(FunctionCallInfo fcinfo) {
+    vertex_cache *cache = (vertex_cache *)fcinfo->flinfo->fn_extra;
+    Snapshot snap;
 
-static Datum get_vertex(const char *graph, const char *vertex_label, int64 graphid)
-{
+    if (cache == NULL) {
+        cache = MemoryContextAllocZero(fcinfo->flinfo->fn_mcxt, sizeof(vertex_cache));
+        cache->relation = InvalidOid;
+        cache->index = InvalidOid;
+
+        fcinfo->flinfo->fn_extra = cache;
+    }
+
+    snap = GetActiveSnapshot();
+
+    // a SET or DELETE since the vertices were read makes them stale
+    if (cache->xmin != snap->xmin || cache->xmax != snap->xmax || cache->curcid != snap->curcid) {
+        for (int i = 0; i < cache->nentries; i++)
+            pfree(cache->entries[i].v);
+
+        cache->nentries = 0;
+        cache->xmin = snap->xmin;
+        cache->xmax = snap->xmax;
+        cache->curcid = snap->curcid;
+    }
+
+    return cache;
+}
+
+/*
+ * Builds the vertex with the given id. When a valid global graph context
+ * has already been loaded for this graph (i.e. by the VLE) the vertex is
+ * taken from there, otherwise the vertex's label table is searched, using
+ * an index on the id column if the table has one.
+ */
+static vertex *fetch_vertex(vertex_cache *cache, Oid graph_oid, graphid id) {
+    graph_context *ggctx;
+    label_cache_data *label;
     ScanKeyData scan_keys[1];
-    Relation graph_vertex_label;
-    TableScanDesc scan_desc;
+    Relation rel;
+    SysScanDesc scan_desc;
     HeapTuple tuple;
-    TupleDesc tupdesc;
-    Datum id, properties, result;
+    Datum properties;
+    bool isnull;
+    vertex *v;
+
+    ggctx = find_graph_context(graph_oid);
+    if (ggctx != NULL && !is_ggctx_invalid(ggctx)) {
+        vertex_entry *ve = get_vertex_entry(ggctx, id);
+
+        if (ve != NULL)
+            return create_vertex(id, graph_oid, DATUM_GET_GTYPE_P(get_vertex_entry_properties(ve)));
+    }
+
+    label = search_label_graph_oid_cache(graph_oid, GET_LABEL_ID(id));
+    if (label == NULL)
+        ereport(ERROR, (errcode(ERRCODE_UNDEFINED_TABLE),
+                        errmsg("label for graphid %ld does not exist", id)));
+
+    rel = table_open(get_label_storage_relation(label->relation),
+                     AccessShareLock);
 
-    Oid graph_namespace_oid = get_namespace_oid(graph, false);
-    Oid vertex_label_table_oid = get_relname_relid(vertex_label, graph_namespace_oid);
-    Snapshot snapshot = GetActiveSnapshot();
+    if (cache->relation != label->relation) {
+        cache->relation = label->relation;
+        cache->index = find_vertex_id_index(rel);
+    }
 
-    ScanKeyInit(&scan_keys[0], 1, BTEqualStrategyNumber, F_OIDEQ, Int64GetDatum(graphid));
+    ScanKeyInit(&scan_keys[0], Anum_ag_label_vertex_table_id, BTEqualStrategyNumber,
+                F_GRAPHIDEQ, GRAPHID_GET_DATUM(id));
 
-    graph_vertex_label = table_open(vertex_label_table_oid, ShareLock);
-    scan_desc = table_beginscan(graph_vertex_label, snapshot, 1, scan_keys);
-    tuple = heap_getnext(scan_desc, ForwardScanDirection);
+    scan_desc = systable_beginscan(rel, cache->index, OidIsValid(cache->index),
+                                   GetActiveSnapshot(), 1, scan_keys);
 
+    tuple = systable_getnext(scan_desc);
     if (!HeapTupleIsValid(tuple))
         ereport(ERROR, (errcode(ERRCODE_UNDEFINED_TABLE),
-                 errmsg("graphid cde %lu does not exist", graphid)));
+                        errmsg("graphid %ld does not exist", id)));
 
-    tupdesc = RelationGetDescr(graph_vertex_label);
-    if (tupdesc->natts != 2)
-        ereport(ERROR, (errcode(ERRCODE_UNDEFINED_TABLE),
-                 errmsg("Invalid number of attributes for %s.%s", graph, vertex_label)));
+    properties = heap_getattr(tuple, Anum_ag_label_vertex_table_properties,
+                              RelationGetDescr(rel), &isnull);
+    Assert(!isnull);
+
+    // create_vertex copies the properties, so the tuple can be released
+    v = create_vertex(id, graph_oid, DATUM_GET_GTYPE_P(properties));
+
+    systable_endscan(scan_desc);
+    table_close(rel, AccessShareLock);
+
+    return v;
+}
 
-    id = column_get_datum(tupdesc, tuple, 0, "id", GRAPHIDOID, true);
-    properties = column_get_datum(tupdesc, tuple, 1, "properties", GTYPEOID, true);
+/*
+ * Returns the oid of a btree index whose leading column is the id column
+ * of the given label table, or InvalidOid if there is none.
+ */
+static Oid find_vertex_id_index(Relation rel) {
+    List *indexes = RelationGetIndexList(rel);
+    ListCell *lc;
+    Oid result = InvalidOid;
+
+    foreach (lc, indexes) {
+        Relation index = index_open(lfirst_oid(lc), AccessShareLock);
 
-    graph_cache_data *cache_data = search_graph_name_cache(graph);
-    result = VERTEX_GET_DATUM(create_vertex(DATUM_GET_GRAPHID(id), cache_data->oid, DATUM_GET_GTYPE_P(properties)));
+        if (index->rd_rel->relam == BTREE_AM_OID &&
+            index->rd_index->indisvalid &&
+            index->rd_index->indkey.values[0] == Anum_ag_label_vertex_table_id)
+            result = RelationGetRelid(index);
 
-    table_endscan(scan_desc);
-    table_close(graph_vertex_label, ShareLock);
+        index_close(index, AccessShareLock);
+
+        if (OidIsValid(result))
+            break;
+    }
+
+    list_free(indexes);
 
     return result;
 }
@@ -365,15 +554,13 @@ append_to_buffer(StringInfo buffer, const char *data, int len) {
 char *
 extract_edge_label(edge *e) {
     graphid id = EXTRACT_EDGE_ID(e);
-    int32 label_id = get_graphid_label_id(id);
-
     Oid graph_oid = EXTRACT_EDGE_GRAPH_OID(e);
 
-    label_cache_data *cache_data = search_label_graph_oid_cache(graph_oid, label_id);
-    char *label = NameStr(cache_data->name);
+    char *label = search_label_name_array_cache(graph_oid, GET_LABEL_ID(id));
 
-    if (IS_AG_DEFAULT_LABEL(label))
-        return "";
+    if (label == NULL)
+        ereport(ERROR, (errcode(ERRCODE_UNDEFINED_OBJECT),
+                        errmsg("label for graphid %ld does not exist", id)));
 
     return label;
 }
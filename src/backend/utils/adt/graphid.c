@@ -19,6 +19,7 @@
 
 #include "postgres.h"
 
+#include "common/hashfn.h"
 #include "fmgr.h"
 #include "utils/builtins.h"
 #include "libpq/pqformat.h"
@@ -142,6 +143,10 @@ Datum graphid_btree_cmp(PG_FUNCTION_ARGS) {
         PG_RETURN_INT32(-1);
 }
 
+/*
+ * graphid is passed by value, so the full key is as cheap to compare as an
+ * abbreviated one would be and no abbreviation is set up.
+ */
 PG_FUNCTION_INFO_V1(graphid_btree_sort);
 Datum graphid_btree_sort(PG_FUNCTION_ARGS) {
     SortSupport ssup = (SortSupport)PG_GETARG_POINTER(0);
@@ -213,13 +218,39 @@ Datum _graphid(PG_FUNCTION_ARGS)
     AG_RETURN_GRAPHID(gid);
 }
 
+/*
+ * Folds a graphid into 32 bits the same way hashint8() does, so graphids
+ * hash like the int8 they are stored as.
+ */
+static inline uint32 graphid_hash_fold(graphid id)
+{
+    uint32 lohalf = (uint32)id;
+    uint32 hihalf = (uint32)((uint64)id >> 32);
+
+    lohalf ^= (id >= 0) ? hihalf : ~hihalf;
+
+    return lohalf;
+}
+
 //Hashing Function for Hash Indexes
 PG_FUNCTION_INFO_V1(graphid_hash_cmp);
 
 Datum graphid_hash_cmp(PG_FUNCTION_ARGS)
 {
     graphid l = AG_GETARG_GRAPHID(0);
-    int hash = (int) ((l >> 32) ^ l);// ^ seed;
 
-    PG_RETURN_INT32(hash);
+    return hash_uint32(graphid_hash_fold(l));
+}
+
+/*
+ * Extended hash function, used by hash partitioning. With a seed of 0 the
+ * low 32 bits match graphid_hash_cmp().
+ */
+PG_FUNCTION_INFO_V1(graphid_hash_extended);
+
+Datum graphid_hash_extended(PG_FUNCTION_ARGS)
+{
+    graphid l = AG_GETARG_GRAPHID(0);
+
+    return hash_uint32_extended(graphid_hash_fold(l), PG_GETARG_INT64(1));
 }
@@ -44,13 +44,21 @@
 #include "catalog/pg_aggregate_d.h"
 #include "catalog/pg_collation_d.h"
 #include "catalog/pg_operator_d.h"
+#include "common/hashfn.h"
+#include "common/int.h"
 #include "executor/nodeAgg.h"
 #include "funcapi.h"
+#include "lib/hyperloglog.h"
 #include "libpq/pqformat.h"
+#include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "parser/parse_coerce.h"
 #include "portability/instr_time.h"
+#include "regex/regex.h"
+#include "nodes/nodeFuncs.h"
 #include "nodes/pg_list.h"
+#include "nodes/supportnodes.h"
+#include "optimizer/optimizer.h"
 #include "utils/builtins.h"
 #include "utils/float.h"
 #include "utils/fmgroids.h"
@@ -77,14 +85,43 @@ typedef struct PercentileGroupAggState
 {
     /* percentile value */
     float8 percentile;
-    /* Sort object we're accumulating data in: */
-    Tuplesortstate *sortstate;
-    /* Number of normal rows inserted into sortstate: */
+    /* Number of normal rows accumulated: */
     int64 number_of_rows;
-    /* Have we already done tuplesort_performsort? */
-    bool sort_done;
+    /* Allocated length of values: */
+    int64 max_rows;
+    /* The accumulated values, kept in the aggregate memory context: */
+    float8 *values;
+    /* Are the values already sorted? */
+    bool sorted;
+    /* Memory context the state lives in: */
+    MemoryContext mcxt;
+    /* Sort object the values move to when they outgrow work_mem: */
+    Tuplesortstate *sortstate;
+    /* Is the sort object ended by a shutdown callback of the aggregate? */
+    bool shutdown_registered;
 } PercentileGroupAggState;
 
+/*
+ * State structure for percentileApprox(). The values are kept in a sketch of
+ * levels, in the manner of a KLL sketch. A value in level h stands for 2^h
+ * input rows. When a level fills up, it is sorted and every other value of
+ * it moves up a level, so the sketch stays logarithmic in the number of
+ * rows.
+ */
+#define PERCENTILE_APPROX_LEVEL_SIZE 256
+#define PERCENTILE_APPROX_MAX_LEVELS 48
+
+typedef struct PercentileApproxAggState
+{
+    float8 percentile;
+    int64 number_of_rows;
+    int num_levels;
+    int level_counts[PERCENTILE_APPROX_MAX_LEVELS];
+    float8 *levels[PERCENTILE_APPROX_MAX_LEVELS];
+    /* alternates the values a compaction keeps */
+    bool compaction_offset;
+} PercentileApproxAggState;
+
 typedef enum /* type categories for datum_to_gtype */
 {
     AGT_TYPE_NULL, /* null, so we didn't bother to identify */
@@ -135,7 +172,6 @@ static float8 get_float_compatible_arg(Datum arg, Oid type, char *funcname, bool
 static Numeric get_numeric_compatible_arg(Datum arg, Oid type, char *funcname, bool *is_null, enum gtype_value_type *ag_type);
 gtype *get_one_gtype_from_variadic_args(FunctionCallInfo fcinfo, int variadic_offset, int expected_nargs);
 static int64 get_int64_from_int_datums(Datum d, Oid type, char *funcname, bool *is_agnull);
-static gtype_iterator *get_next_object_key(gtype_iterator *it, gtype_container *agtc, gtype_value *key);
 static gtype_iterator *get_next_list_element(gtype_iterator *it, gtype_container *agtc, gtype_value *elem);
 gtype_value *gtype_composite_to_gtype_value_binary(gtype *a);
 static Datum process_access_operator_result(FunctionCallInfo fcinfo, gtype_value *agtv, bool as_text);
@@ -1984,6 +2020,170 @@ Datum gtype_in_operator(PG_FUNCTION_ARGS)
     return result;
 }
 
+/*
+ * String kernels. These work on the bytes of gtype strings in place, and
+ * the functions that return a string build it with make_gtype_string(),
+ * rather than converting to and from text.
+ */
+
+/* returns the string of a gtype argument, or false if it is a gtype null */
+static bool get_gtype_string_arg(gtype *agt, const char *funcname, char **str,
+                                 int *len)
+{
+    gtype_value *agtv;
+
+    if (!AGT_ROOT_IS_SCALAR(agt))
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                        errmsg("%s() only supports scalar arguments", funcname)));
+
+    agtv = get_ith_gtype_value_from_container(&agt->root, 0);
+
+    if (agtv->type == AGTV_NULL)
+        return false;
+
+    if (agtv->type != AGTV_STRING)
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                        errmsg("%s() unsupported argument gtype %d", funcname,
+                               agtv->type)));
+
+    *str = agtv->val.string.val;
+    *len = agtv->val.string.len;
+
+    return true;
+}
+
+/* the same, for a variadic argument that may also be a text or a cstring */
+static bool get_variadic_string_arg(Datum arg, Oid type, const char *funcname,
+                                    char **str, int *len)
+{
+    if (type == GTYPEOID)
+        return get_gtype_string_arg(DATUM_GET_GTYPE_P(arg), funcname, str, len);
+
+    if (type == CSTRINGOID)
+    {
+        *str = DatumGetCString(arg);
+        *len = strlen(*str);
+    }
+    else if (type == TEXTOID)
+    {
+        text *t = DatumGetTextPP(arg);
+
+        *str = VARDATA_ANY(t);
+        *len = VARSIZE_ANY_EXHDR(t);
+    }
+    else
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                        errmsg("%s() unsupported argument type %d", funcname,
+                               type)));
+    }
+
+    return true;
+}
+
+static bool is_ascii_string(const char *str, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++)
+    {
+        if (IS_HIGHBIT_SET(str[i]))
+            return false;
+    }
+
+    return true;
+}
+
+/* returns the number of characters in str */
+static int64 string_num_chars(const char *str, int len, bool ascii)
+{
+    return ascii ? len : pg_mbstrlen_with_len(str, len);
+}
+
+/* returns the length in bytes of the first nchars characters of str */
+static int string_prefix_len(const char *str, int len, int64 nchars,
+                             bool ascii)
+{
+    if (nchars <= 0)
+        return 0;
+
+    /* there can't be more characters than bytes */
+    if (nchars >= len)
+        return len;
+
+    return ascii ? nchars : pg_mbcharcliplen(str, len, nchars);
+}
+
+/*
+ * Returns the first occurrence of needle in haystack, or NULL. memchr() is
+ * used to skip to the places the first byte of needle occurs.
+ */
+static const char *string_find(const char *haystack, int hlen,
+                               const char *needle, int nlen)
+{
+    const char *p = haystack;
+    const char *last;
+
+    if (nlen == 0)
+        return haystack;
+
+    if (nlen > hlen)
+        return NULL;
+
+    last = haystack + hlen - nlen;
+    while (p <= last)
+    {
+        p = memchr(p, needle[0], last - p + 1);
+        if (p == NULL)
+            return NULL;
+
+        if (memcmp(p + 1, needle + 1, nlen - 1) == 0)
+            return p;
+
+        p++;
+    }
+
+    return NULL;
+}
+
+/*
+ * Returns true if a byte-wise search of the database encoding can only match
+ * at character boundaries. That holds for UTF-8 and the single byte
+ * encodings. In encodings like SJIS or GBK, the trailing byte of a character
+ * can have an ASCII value, so split() and replace() use the PG text
+ * functions there.
+ */
+static bool string_byte_search_is_safe(void)
+{
+    return GetDatabaseEncoding() == PG_UTF8 ||
+           pg_database_encoding_max_length() == 1;
+}
+
+/* returns true if str has a character that is special in a regex */
+static bool has_regex_special_chars(const char *str, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++)
+    {
+        if (str[i] == '\0' || strchr(".[]()*+?{}|^$\\", str[i]) != NULL)
+            return true;
+    }
+
+    return false;
+}
+
+/* returns a new gtype string of the len bytes at str */
+static gtype *copy_gtype_string(const char *str, int len)
+{
+    char *data;
+    gtype *result = make_gtype_string(len, &data);
+
+    memcpy(data, str, len);
+
+    return result;
+}
+
 PG_FUNCTION_INFO_V1(gtype_string_match_starts_with);
 /*
  * Execution function for STARTS WITH
@@ -2006,11 +2206,9 @@ Datum gtype_string_match_starts_with(PG_FUNCTION_ARGS)
             if (lhs_value->val.string.len < rhs_value->val.string.len)
                 return boolean_to_gtype(false);
 
-            if (strncmp(lhs_value->val.string.val, rhs_value->val.string.val,
-                        rhs_value->val.string.len) == 0)
-                return boolean_to_gtype(true);
-            else
-                return boolean_to_gtype(false);
+            return boolean_to_gtype(memcmp(lhs_value->val.string.val,
+                                           rhs_value->val.string.val,
+                                           rhs_value->val.string.len) == 0);
         }
     }
     ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
@@ -2039,13 +2237,11 @@ Datum gtype_string_match_ends_with(PG_FUNCTION_ARGS)
             if (lhs_value->val.string.len < rhs_value->val.string.len)
                 return boolean_to_gtype(false);
 
-            if (strncmp(lhs_value->val.string.val + lhs_value->val.string.len -
-                            rhs_value->val.string.len,
-                        rhs_value->val.string.val,
-                        rhs_value->val.string.len) == 0)
-                return boolean_to_gtype(true);
-            else
-                return boolean_to_gtype(false);
+            return boolean_to_gtype(memcmp(lhs_value->val.string.val +
+                                           lhs_value->val.string.len -
+                                           rhs_value->val.string.len,
+                                           rhs_value->val.string.val,
+                                           rhs_value->val.string.len) == 0);
         }
     }
     ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
@@ -2071,19 +2267,10 @@ Datum gtype_string_match_contains(PG_FUNCTION_ARGS)
 
         if (lhs_value->type == AGTV_STRING && rhs_value->type == AGTV_STRING)
         {
-            char *l;
-            char *r;
-
-            if (lhs_value->val.string.len < rhs_value->val.string.len)
-                return boolean_to_gtype(false);
-
-            l = pnstrdup(lhs_value->val.string.val, lhs_value->val.string.len);
-            r = pnstrdup(rhs_value->val.string.val, rhs_value->val.string.len);
-
-            if (strstr(l, r) == NULL)
-                return boolean_to_gtype(false);
-            else
-                return boolean_to_gtype(true);
+            return boolean_to_gtype(string_find(lhs_value->val.string.val,
+                                                lhs_value->val.string.len,
+                                                rhs_value->val.string.val,
+                                                rhs_value->val.string.len) != NULL);
         }
     }
     ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
@@ -2497,239 +2684,172 @@ PG_FUNCTION_INFO_V1(gtype_toupper);
 
 Datum gtype_toupper(PG_FUNCTION_ARGS)
 {
-    gtype *agt = AG_GET_ARG_GTYPE_P(0);
-
-    if (!AGT_ROOT_IS_SCALAR(agt))
-        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                        errmsg("toUpper() only supports scalar arguments")));
-
-    gtype_value *agtv_value = get_ith_gtype_value_from_container(&agt->root, 0);
-
     char *string;
     int string_len;
-    if (agtv_value->type == AGTV_NULL) {
-        PG_RETURN_NULL();
-    } else if (agtv_value->type == AGTV_STRING) {
-        string = agtv_value->val.string.val;
-        string_len = agtv_value->val.string.len;
-    } else {
-        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                        errmsg("toUpper() unsupported argument gtype %d", agtv_value->type)));
-    }
+    char *result;
+    gtype *agt_result;
+    int i;
 
-    char *result = palloc(string_len);
+    if (!get_gtype_string_arg(AG_GET_ARG_GTYPE_P(0), "toUpper", &string, &string_len))
+        PG_RETURN_NULL();
 
-    for (int i = 0; i < string_len; i++)
-        result[i] = pg_toupper(string[i]);
+    agt_result = make_gtype_string(string_len, &result);
 
-    gtype_value agtv_result = { .type = AGTV_STRING, .val.string = {string_len, result}};
+    /* ASCII bytes are folded inline, pg_toupper() handles the others */
+    for (i = 0; i < string_len; i++)
+        result[i] = IS_HIGHBIT_SET(string[i]) ? pg_toupper((unsigned char) string[i]) :
+                                                pg_ascii_toupper((unsigned char) string[i]);
 
-    AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv_result));
+    AG_RETURN_GTYPE_P(agt_result);
 }
 
 PG_FUNCTION_INFO_V1(gtype_tolower);
 
 Datum gtype_tolower(PG_FUNCTION_ARGS)
 {
-    gtype *agt = AG_GET_ARG_GTYPE_P(0);
-
-    if (!AGT_ROOT_IS_SCALAR(agt))
-        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                        errmsg("toLower() only supports scalar arguments")));
-
-    gtype_value *agtv_value = get_ith_gtype_value_from_container(&agt->root, 0);
-
     char *string;
     int string_len;
-    if (agtv_value->type == AGTV_NULL) {
-        PG_RETURN_NULL();
-    } else if (agtv_value->type == AGTV_STRING) {
-        string = agtv_value->val.string.val;
-        string_len = agtv_value->val.string.len;
-    } else {
-        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                        errmsg("toLower() unsupported argument gtype %d", agtv_value->type)));
-    }
+    char *result;
+    gtype *agt_result;
+    int i;
 
-    char *result = palloc(string_len);
+    if (!get_gtype_string_arg(AG_GET_ARG_GTYPE_P(0), "toLower", &string, &string_len))
+        PG_RETURN_NULL();
 
-    for (int i = 0; i < string_len; i++)
-        result[i] = pg_tolower(string[i]);
+    agt_result = make_gtype_string(string_len, &result);
 
-    gtype_value agtv_result = { .type = AGTV_STRING, .val.string = {string_len, result}};
+    /* ASCII bytes are folded inline, pg_tolower() handles the others */
+    for (i = 0; i < string_len; i++)
+        result[i] = IS_HIGHBIT_SET(string[i]) ? pg_tolower((unsigned char) string[i]) :
+                                                pg_ascii_tolower((unsigned char) string[i]);
 
-    AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv_result));
+    AG_RETURN_GTYPE_P(agt_result);
 }
 
-PG_FUNCTION_INFO_V1(gtype_rtrim);
-
-Datum gtype_rtrim(PG_FUNCTION_ARGS)
+/* trims the spaces from either or both ends, like PG's btrim1() */
+static Datum trim_gtype_string(FunctionCallInfo fcinfo, const char *funcname,
+                               bool trim_left, bool trim_right)
 {
-    gtype *agt = AG_GET_ARG_GTYPE_P(0);
+    char *string;
+    int string_len;
+    int start = 0;
 
-    if (!AGT_ROOT_IS_SCALAR(agt))
-        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                        errmsg("rTrim() only supports scalar arguments")));
+    if (!get_gtype_string_arg(AG_GET_ARG_GTYPE_P(0), funcname, &string, &string_len))
+        PG_RETURN_NULL();
 
-    gtype_value *agtv_value = get_ith_gtype_value_from_container(&agt->root, 0);
+    if (trim_left)
+    {
+        while (start < string_len && string[start] == ' ')
+            start++;
+    }
 
-    text *text_string;
-    if (agtv_value->type == AGTV_NULL)
-        PG_RETURN_NULL();
-    else if (agtv_value->type == AGTV_STRING)
-        text_string = cstring_to_text_with_len(agtv_value->val.string.val, agtv_value->val.string.len);
-    else
-        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                        errmsg("rTrim() unsupported argument gtype %d", agtv_value->type)));
+    if (trim_right)
+    {
+        while (string_len > start && string[string_len - 1] == ' ')
+            string_len--;
+    }
 
-    text_string = DatumGetTextPP(DirectFunctionCall1(rtrim1, PointerGetDatum(text_string)));
+    AG_RETURN_GTYPE_P(copy_gtype_string(string + start, string_len - start));
+}
 
-    gtype_value agtv_result = { .type = AGTV_STRING, 
-                                 .val.string = { VARSIZE(text_string), text_to_cstring(text_string) }};
+PG_FUNCTION_INFO_V1(gtype_rtrim);
 
-    AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv_result));
+Datum gtype_rtrim(PG_FUNCTION_ARGS)
+{
+    return trim_gtype_string(fcinfo, "rTrim", false, true);
 }
 
 PG_FUNCTION_INFO_V1(gtype_ltrim);
 
 Datum gtype_ltrim(PG_FUNCTION_ARGS)
 {
-    gtype *agt = AG_GET_ARG_GTYPE_P(0);
-
-    if (!AGT_ROOT_IS_SCALAR(agt))
-        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                        errmsg("lTrim() only supports scalar arguments")));
-
-    gtype_value *agtv_value = get_ith_gtype_value_from_container(&agt->root, 0);
-
-    text *text_string;
-    if (agtv_value->type == AGTV_NULL)
-        PG_RETURN_NULL();
-    else if (agtv_value->type == AGTV_STRING)
-        text_string = cstring_to_text_with_len(agtv_value->val.string.val, agtv_value->val.string.len);
-    else
-        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                        errmsg("lTrim() unsupported argument gtype %d", agtv_value->type)));
-
-    text_string = DatumGetTextPP(DirectFunctionCall1(ltrim1, PointerGetDatum(text_string)));
-
-    gtype_value agtv_result = { .type = AGTV_STRING, 
-                                 .val.string = { VARSIZE(text_string), text_to_cstring(text_string) }};
-
-    AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv_result));
+    return trim_gtype_string(fcinfo, "lTrim", true, false);
 }
 
 PG_FUNCTION_INFO_V1(gtype_trim);
 
 Datum gtype_trim(PG_FUNCTION_ARGS)
 {
-    gtype *agt = AG_GET_ARG_GTYPE_P(0);
+    return trim_gtype_string(fcinfo, "Trim", true, true);
+}
+
+/* returns the integer second argument of left() and right() */
+static int64 get_left_right_count_arg(FunctionCallInfo fcinfo,
+                                      const char *funcname)
+{
+    gtype *agt = AG_GET_ARG_GTYPE_P(1);
+    gtype_value *agtv_value;
 
     if (!AGT_ROOT_IS_SCALAR(agt))
         ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                        errmsg("Trim() only supports scalar arguments")));
+                        errmsg("%s() only supports scalar arguments", funcname)));
 
-    gtype_value *agtv_value = get_ith_gtype_value_from_container(&agt->root, 0);
+    agtv_value = get_ith_gtype_value_from_container(&agt->root, 0);
 
-    text *text_string;
-    if (agtv_value->type == AGTV_NULL)
-        PG_RETURN_NULL();
-    else if (agtv_value->type == AGTV_STRING)
-        text_string = cstring_to_text_with_len(agtv_value->val.string.val, agtv_value->val.string.len);
-    else
+    if (agtv_value->type != AGTV_INTEGER)
         ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                        errmsg("Trim() unsupported argument gtype %d", agtv_value->type)));
-
-    text_string = DatumGetTextPP(DirectFunctionCall1(btrim1, PointerGetDatum(text_string)));
-
-    gtype_value agtv_result = { .type = AGTV_STRING,
-                                 .val.string = { VARSIZE(text_string), text_to_cstring(text_string) }};
+                        errmsg("%s() unsupported argument gtype %d", funcname,
+                               agtv_value->type)));
 
-    AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv_result));
+    return agtv_value->val.int_value;
 }
 
 PG_FUNCTION_INFO_V1(gtype_right);
 
+/*
+ * Returns the last n characters, or all but the first -n characters if n is
+ * negative, like PG's text_right().
+ */
 Datum gtype_right(PG_FUNCTION_ARGS)
 {
-    gtype *agt = AG_GET_ARG_GTYPE_P(0);
-
-    if (!AGT_ROOT_IS_SCALAR(agt))
-            ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                            errmsg("right() only supports scalar arguments")));
-
-    gtype_value *agtv_value = get_ith_gtype_value_from_container(&agt->root, 0);
+    char *string;
+    int string_len;
+    int64 n;
+    int64 skip;
+    bool ascii;
+    int start;
 
-    text *text_string;
-    if (agtv_value->type == AGTV_NULL)
+    if (!get_gtype_string_arg(AG_GET_ARG_GTYPE_P(0), "right", &string, &string_len))
         PG_RETURN_NULL();
-    else if (agtv_value->type == AGTV_STRING)
-        text_string = cstring_to_text_with_len(agtv_value->val.string.val, agtv_value->val.string.len);
-    else
-        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                        errmsg("right() unsupported argument gtype %d", agtv_value->type)));
-
-    agt = AG_GET_ARG_GTYPE_P(1);
-    if (!AGT_ROOT_IS_SCALAR(agt))
-        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                        errmsg("right() only supports scalar arguments")));
-
-    agtv_value = get_ith_gtype_value_from_container(&agt->root, 0);
 
-    if (agtv_value->type != AGTV_INTEGER)
-        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                        errmsg("right() unsupported argument gtype %d", agtv_value->type)));
+    n = get_left_right_count_arg(fcinfo, "right");
 
-    text_string = DatumGetTextPP(DirectFunctionCall2(text_right,
-                                                     PointerGetDatum(text_string),
-                                                     Int64GetDatum(agtv_value->val.int_value)));
+    ascii = is_ascii_string(string, string_len);
+    if (n < 0)
+        skip = -n;
+    else
+        skip = string_num_chars(string, string_len, ascii) - n;
 
-    gtype_value agtv_result = { .type = AGTV_STRING,
-                                 .val.string = { VARSIZE(text_string), text_to_cstring(text_string) }};
+    start = string_prefix_len(string, string_len, skip, ascii);
 
-    AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv_result));
+    AG_RETURN_GTYPE_P(copy_gtype_string(string + start, string_len - start));
 }
 
 PG_FUNCTION_INFO_V1(gtype_left);
 
+/*
+ * Returns the first n characters, or all but the last -n characters if n is
+ * negative, like PG's text_left().
+ */
 Datum gtype_left(PG_FUNCTION_ARGS)
 {
-    gtype *agt = AG_GET_ARG_GTYPE_P(0);
-
-    if (!AGT_ROOT_IS_SCALAR(agt))
-            ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                            errmsg("left() only supports scalar arguments")));
-
-    gtype_value *agtv_value = get_ith_gtype_value_from_container(&agt->root, 0);
+    char *string;
+    int string_len;
+    int64 n;
+    bool ascii;
 
-    text *text_string;
-    if (agtv_value->type == AGTV_NULL)
+    if (!get_gtype_string_arg(AG_GET_ARG_GTYPE_P(0), "left", &string, &string_len))
         PG_RETURN_NULL();
-    else if (agtv_value->type == AGTV_STRING)
-        text_string = cstring_to_text_with_len(agtv_value->val.string.val, agtv_value->val.string.len);
-    else
-        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                        errmsg("left() unsupported argument gtype %d", agtv_value->type)));
-
-    agt = AG_GET_ARG_GTYPE_P(1);
-    if (!AGT_ROOT_IS_SCALAR(agt))
-        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                        errmsg("left() only supports scalar arguments")));
-
-    agtv_value = get_ith_gtype_value_from_container(&agt->root, 0); 
-
-    if (agtv_value->type != AGTV_INTEGER)
-        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                        errmsg("left() unsupported argument gtype %d", agtv_value->type)));
 
-    text_string = DatumGetTextPP(DirectFunctionCall2(text_left,
-                                                     PointerGetDatum(text_string),
-                                                     Int64GetDatum(agtv_value->val.int_value)));
+    n = get_left_right_count_arg(fcinfo, "left");
 
-    gtype_value agtv_result = { .type = AGTV_STRING,
-                                 .val.string = { VARSIZE(text_string), text_to_cstring(text_string) }};
+    ascii = is_ascii_string(string, string_len);
+    if (n < 0)
+        n = string_num_chars(string, string_len, ascii) + n;
 
-    AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv_result));
+    AG_RETURN_GTYPE_P(copy_gtype_string(string,
+                                        string_prefix_len(string, string_len,
+                                                          n, ascii)));
 }
 
 PG_FUNCTION_INFO_V1(gtype_substring);
@@ -2741,12 +2861,14 @@ Datum gtype_substring(PG_FUNCTION_ARGS)
     Datum arg;
     bool *nulls;
     Oid *types;
-    gtype_value agtv_result;
-    text *text_string = NULL;
     char *string = NULL;
-    int param;
-    int string_start = 0;
-    int string_len = 0;
+    int string_bytes = 0;
+    int64 param;
+    int64 string_start = 0;
+    int64 string_len = 0;
+    int start;
+    int end;
+    bool ascii;
     int i;
     Oid type;
 
@@ -2769,54 +2891,18 @@ Datum gtype_substring(PG_FUNCTION_ARGS)
                             errmsg("substring() offset or length cannot be null")));
 
     /* substring() supports text, cstring, or the gtype string input */
-    arg = args[0];
-    type = types[0];
+    if (!get_variadic_string_arg(args[0], types[0], "substring", &string,
+                                 &string_bytes))
+        PG_RETURN_NULL();
 
-    if (type != GTYPEOID)
-    {
-        if (type == CSTRINGOID)
-            text_string = cstring_to_text(DatumGetCString(arg));
-        else if (type == TEXTOID)
-            text_string = DatumGetTextPP(arg);
-        else
-            ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                            errmsg("substring() unsupported argument type %d",
-                                   type)));
-    }
-    else
+    /*
+     * substring() only supports integer and gtype integer for the second and
+     * third parameters values.
+     */
+    for (i = 1; i < nargs; i++)
     {
-        gtype *agt_arg;
-        gtype_value *agtv_value;
-
-        /* get the gtype argument */
-        agt_arg = DATUM_GET_GTYPE_P(arg);
-
-        if (!AGT_ROOT_IS_SCALAR(agt_arg))
-            ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                            errmsg("substring() only supports scalar arguments")));
-
-        agtv_value = get_ith_gtype_value_from_container(&agt_arg->root, 0);
-
-        /* check for gtype null */
-        if (agtv_value->type == AGTV_NULL)
-            PG_RETURN_NULL();
-        if (agtv_value->type == AGTV_STRING)
-            text_string = cstring_to_text_with_len(agtv_value->val.string.val,
-                                                   agtv_value->val.string.len);
-        else
-            ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                            errmsg("substring() unsupported argument gtype %d",
-                                   agtv_value->type)));
-    }
-
-    /*
-     * substring() only supports integer and gtype integer for the second and
-     * third parameters values.
-     */
-    for (i = 1; i < nargs; i++)
-    {
-        arg = args[i];
-        type = types[i];
+        arg = args[i];
+        type = types[i];
 
         if (type != GTYPEOID)
         {
@@ -2865,86 +2951,85 @@ Datum gtype_substring(PG_FUNCTION_ARGS)
         ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
                         errmsg("substring() negative values are not supported for offset or length")));
 
-    /* cypher substring is 0 based while PG's is 1 based */
-    string_start += 1;
-
     /*
-     * We need the string as a text string so that we can let PG deal with
-     * multibyte characters in the string.
+     * Cypher's substring is 0 based. The offsets are in characters, so only a
+     * multibyte string needs to be walked to find them.
      */
+    ascii = is_ascii_string(string, string_bytes);
+    start = string_prefix_len(string, string_bytes, string_start, ascii);
 
     /* if optional length is left out */
     if (nargs == 2)
-         text_string = DatumGetTextPP(DirectFunctionCall2(text_substr_no_len,
-                                                          PointerGetDatum(text_string),
-                                                          Int64GetDatum(string_start)));
-    /* if length is given */
+        end = string_bytes;
     else
-        text_string = DatumGetTextPP(DirectFunctionCall3(text_substr,
-                                                         PointerGetDatum(text_string),
-                                                         Int64GetDatum(string_start),
-                                                         Int64GetDatum(string_len)));
-
-    /* convert it back to a cstring */
-    string = text_to_cstring(text_string);
-    string_len = strlen(string);
+        end = start + string_prefix_len(string + start, string_bytes - start,
+                                        string_len, ascii);
 
     /* if we have an empty string, return null */
-    if (string_len == 0)
+    if (end == start)
         PG_RETURN_NULL();
 
-    /* build the result */
-    agtv_result.type = AGTV_STRING;
-    agtv_result.val.string.val = string;
-    agtv_result.val.string.len = string_len;
-
-    PG_RETURN_POINTER(gtype_value_to_gtype(&agtv_result));
+    AG_RETURN_GTYPE_P(copy_gtype_string(string + start, end - start));
 }
 
 PG_FUNCTION_INFO_V1(gtype_split);
 
 Datum gtype_split(PG_FUNCTION_ARGS)
 {
-    text *text_string;
-    text *text_delimiter;
+    char *string;
+    int string_len;
+    char *delimiter;
+    int delimiter_len;
+    gtype_in_state result;
 
-    for (int i = 0; i < 2; i++) {
-        gtype *agt = AG_GET_ARG_GTYPE_P(i);
-        gtype_value *agtv_value;
+    if (!get_gtype_string_arg(AG_GET_ARG_GTYPE_P(0), "split", &string, &string_len) ||
+        !get_gtype_string_arg(AG_GET_ARG_GTYPE_P(1), "split", &delimiter, &delimiter_len))
+        PG_RETURN_NULL();
 
-        if (!AGT_ROOT_IS_SCALAR(agt))
-            ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                            errmsg("split() only supports scalar arguments")));
+    memset(&result, 0, sizeof(gtype_in_state));
 
-        agtv_value = get_ith_gtype_value_from_container(&agt->root, 0);
+    /*
+     * The delimiter is a regular expression, but when it has no special
+     * characters it can only match itself, so split on the bytes directly
+     * where the encoding allows it.
+     */
+    if (delimiter_len > 0 && !has_regex_special_chars(delimiter, delimiter_len) &&
+        string_byte_search_is_safe())
+    {
+        const char *p = string;
+        const char *end = string + string_len;
+        const char *match;
+        gtype_value agtv;
 
-        /* check for gtype null */
-        if (agtv_value->type == AGTV_NULL) {
-            PG_RETURN_NULL();
-        } else if (agtv_value->type == AGTV_STRING) {
-            text *param = cstring_to_text_with_len(agtv_value->val.string.val,
-                                                   agtv_value->val.string.len);
+        agtv.type = AGTV_STRING;
 
-            if (i == 0)
-                text_string = param;
-            else
-                text_delimiter = param;
-        } else {
-            ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                            errmsg("split() unsupported argument gtype %d",
-                                       agtv_value->type)));
+        result.res = push_gtype_value(&result.parse_state, WAGT_BEGIN_ARRAY, NULL);
+
+        while ((match = string_find(p, end - p, delimiter, delimiter_len)) != NULL)
+        {
+            agtv.val.string.val = (char *) p;
+            agtv.val.string.len = match - p;
+            result.res = push_gtype_value(&result.parse_state, WAGT_ELEM, &agtv);
+
+            p = match + delimiter_len;
         }
+
+        agtv.val.string.val = (char *) p;
+        agtv.val.string.len = end - p;
+        result.res = push_gtype_value(&result.parse_state, WAGT_ELEM, &agtv);
+
+        result.res = push_gtype_value(&result.parse_state, WAGT_END_ARRAY, NULL);
     }
+    else
+    {
+        Datum text_array = DirectFunctionCall2Coll(regexp_split_to_array,
+                                                   DEFAULT_COLLATION_OID,
+                                                   PointerGetDatum(cstring_to_text_with_len(string, string_len)),
+                                                   PointerGetDatum(cstring_to_text_with_len(delimiter, delimiter_len)));
 
-    Datum text_array = DirectFunctionCall2Coll(regexp_split_to_array,
-                                               DEFAULT_COLLATION_OID,
-                                               PointerGetDatum(text_string),
-                                               PointerGetDatum(text_delimiter));
+        array_to_gtype_internal(text_array, &result);
+    }
 
-    gtype_in_state result;
-    memset(&result, 0, sizeof(gtype_in_state));
-    array_to_gtype_internal(text_array, &result);
-    
     AG_RETURN_GTYPE_P(gtype_value_to_gtype(result.res));
 }
 
@@ -2954,18 +3039,21 @@ Datum gtype_replace(PG_FUNCTION_ARGS)
 {
     int nargs;
     Datum *args;
-    Datum arg;
     bool *nulls;
     Oid *types;
-    gtype_value agtv_result;
-    text *param = NULL;
-    text *text_string = NULL;
-    text *text_search = NULL;
-    text *text_replace = NULL;
-    text *text_result = NULL;
-    char *string = NULL;
+    char *strings[3];
+    int lens[3];
+    char *string;
     int string_len;
-    Oid type;
+    char *search;
+    int search_len;
+    const char *p;
+    const char *end;
+    const char *match;
+    char *result;
+    gtype *agt_result;
+    int64 count = 0;
+    int64 result_len;
     int i;
 
     /* extract argument values */
@@ -2984,78 +3072,74 @@ Datum gtype_replace(PG_FUNCTION_ARGS)
      * replace() supports text, cstring, or the gtype string input for the
      * string and delimiter values
      */
-
     for (i = 0; i < 3; i++)
     {
-        arg = args[i];
-        type = types[i];
+        if (!get_variadic_string_arg(args[i], types[i], "replace", &strings[i],
+                                     &lens[i]))
+            PG_RETURN_NULL();
+    }
 
-        if (type != GTYPEOID)
-        {
-            if (type == CSTRINGOID)
-                param = cstring_to_text(DatumGetCString(arg));
-            else if (type == TEXTOID)
-                param = DatumGetTextPP(arg);
-            else
-                ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                                errmsg("replace() unsupported argument type %d",
-                                       type)));
-        }
-        else
-        {
-            gtype *agt_arg;
-            gtype_value *agtv_value;
+    string = strings[0];
+    string_len = lens[0];
+    search = strings[1];
+    search_len = lens[1];
+    end = string + string_len;
 
-            /* get the gtype argument */
-            agt_arg = DATUM_GET_GTYPE_P(arg);
+    if (!string_byte_search_is_safe())
+    {
+        text *text_result;
 
-            if (!AGT_ROOT_IS_SCALAR(agt_arg))
-                ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                                errmsg("replace() only supports scalar arguments")));
+        text_result = DatumGetTextPP(DirectFunctionCall3Coll(
+            replace_text, C_COLLATION_OID,
+            PointerGetDatum(cstring_to_text_with_len(string, string_len)),
+            PointerGetDatum(cstring_to_text_with_len(search, search_len)),
+            PointerGetDatum(cstring_to_text_with_len(strings[2], lens[2]))));
 
-            agtv_value = get_ith_gtype_value_from_container(&agt_arg->root, 0);
+        /* if we have an empty string, return null */
+        if (VARSIZE_ANY_EXHDR(text_result) == 0)
+            PG_RETURN_NULL();
 
-            /* check for gtype null */
-            if (agtv_value->type == AGTV_NULL)
-                PG_RETURN_NULL();
-            if (agtv_value->type == AGTV_STRING)
-                param = cstring_to_text_with_len(agtv_value->val.string.val,
-                                                 agtv_value->val.string.len);
-            else
-                ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                                errmsg("replace() unsupported argument gtype %d",
-                                       agtv_value->type)));
-        }
-        if (i == 0)
-            text_string = param;
-        if (i == 1)
-            text_search = param;
-        if (i == 2)
-            text_replace = param;
+        AG_RETURN_GTYPE_P(copy_gtype_string(VARDATA_ANY(text_result),
+                                            VARSIZE_ANY_EXHDR(text_result)));
     }
 
-    /*
-     * We need the strings as a text strings so that we can let PG deal with
-     * multibyte characters in the string.
-     */
-    text_result = DatumGetTextPP(DirectFunctionCall3Coll(
-        replace_text, C_COLLATION_OID, PointerGetDatum(text_string),
-        PointerGetDatum(text_search), PointerGetDatum(text_replace)));
+    /* like PG's replace_text(), an empty search leaves the string as is */
+    if (search_len == 0)
+    {
+        if (string_len == 0)
+            PG_RETURN_NULL();
 
-    /* convert it back to a cstring */
-    string = text_to_cstring(text_result);
-    string_len = strlen(string);
+        AG_RETURN_GTYPE_P(copy_gtype_string(string, string_len));
+    }
+
+    /* count the matches first so the result is only allocated once */
+    for (p = string; (match = string_find(p, end - p, search, search_len)) != NULL;
+         p = match + search_len)
+        count++;
+
+    result_len = string_len + count * ((int64) lens[2] - search_len);
 
     /* if we have an empty string, return null */
-    if (string_len == 0)
+    if (result_len == 0)
         PG_RETURN_NULL();
 
-    /* build the result */
-    agtv_result.type = AGTV_STRING;
-    agtv_result.val.string.val = string;
-    agtv_result.val.string.len = string_len;
+    if (result_len > AGTENTRY_OFFLENMASK)
+        ereport(ERROR, (errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+                        errmsg("replace() result exceeds the maximum string length")));
 
-    PG_RETURN_POINTER(gtype_value_to_gtype(&agtv_result));
+    agt_result = make_gtype_string(result_len, &result);
+
+    for (p = string; (match = string_find(p, end - p, search, search_len)) != NULL;
+         p = match + search_len)
+    {
+        memcpy(result, p, match - p);
+        result += match - p;
+        memcpy(result, strings[2], lens[2]);
+        result += lens[2];
+    }
+    memcpy(result, p, end - p);
+
+    AG_RETURN_GTYPE_P(agt_result);
 }
 
 /*
@@ -3222,224 +3306,146 @@ static Numeric get_numeric_compatible_arg(Datum arg, Oid type, char *funcname,
     return result;
 }
 
-PG_FUNCTION_INFO_V1(gtype_sin);
-
-Datum gtype_sin(PG_FUNCTION_ARGS)
+/*
+ * Fast path for the math functions: reads an integer or float scalar
+ * straight out of the container, without building a gtype_value. Returns
+ * false for anything else, which the callers hand to the general argument
+ * functions above.
+ */
+static bool get_inline_float8_arg(gtype *agt, float8 *result)
 {
-    gtype *agt = AG_GET_ARG_GTYPE_P(0);
-    gtype_value agtv_result;
-    float8 angle;
-    bool is_null;
+    char *data;
 
-    angle = get_float_compatible_arg(GTYPE_P_GET_DATUM(agt), GTYPEOID, "sin", &is_null);
+    if (!AGT_ROOT_IS_SCALAR(agt) || !AGTE_IS_GTYPE(agt->root.children[0]))
+        return false;
 
-    if (is_null)
-        PG_RETURN_NULL();
+    data = (char *)&agt->root.children[1] + sizeof(uint32);
 
-    agtv_result.type = AGTV_FLOAT;
-    agtv_result.val.float_value =
-        DatumGetFloat8(DirectFunctionCall1(dsin, Float8GetDatum(angle)));
+    if (AGT_IS_FLOAT(agt->root.children[1]))
+    {
+        memcpy(result, data, sizeof(float8));
+        return true;
+    }
+    else if (AGT_IS_INTEGER(agt->root.children[1]))
+    {
+        int64 i;
 
-    AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv_result));
-}
+        memcpy(&i, data, sizeof(int64));
+        *result = (float8) i;
+        return true;
+    }
 
-PG_FUNCTION_INFO_V1(gtype_cos);
+    return false;
+}
 
-Datum gtype_cos(PG_FUNCTION_ARGS)
+/* the float8 of argument argno, or false if it is a gtype null */
+static bool get_float8_arg(FunctionCallInfo fcinfo, int argno, char *funcname,
+                           float8 *result)
 {
-    gtype *agt = AG_GET_ARG_GTYPE_P(0);
-    gtype_value agtv_result;
-    float8 angle;
+    gtype *agt = AG_GET_ARG_GTYPE_P(argno);
     bool is_null;
 
-    angle = get_float_compatible_arg(GTYPE_P_GET_DATUM(agt), GTYPEOID, "cos", &is_null);
+    if (get_inline_float8_arg(agt, result))
+        return true;
 
-    if (is_null)
-        PG_RETURN_NULL();
+    *result = get_float_compatible_arg(GTYPE_P_GET_DATUM(agt), GTYPEOID,
+                                       funcname, &is_null);
 
-    agtv_result.type = AGTV_FLOAT;
-    agtv_result.val.float_value =
-        DatumGetFloat8(DirectFunctionCall1(dcos, Float8GetDatum(angle)));
+    return !is_null;
+}
 
-    AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv_result));
+/*
+ * Applies the PG float8 function fn to the argument. PG's functions are
+ * still used for their range checks and error messages.
+ */
+static Datum gtype_float8_math(FunctionCallInfo fcinfo, char *funcname,
+                               PGFunction fn)
+{
+    float8 arg;
+
+    if (!get_float8_arg(fcinfo, 0, funcname, &arg))
+        PG_RETURN_NULL();
+
+    AG_RETURN_GTYPE_P(make_gtype_float(
+        DatumGetFloat8(DirectFunctionCall1(fn, Float8GetDatum(arg)))));
 }
 
-PG_FUNCTION_INFO_V1(gtype_tan);
+PG_FUNCTION_INFO_V1(gtype_sin);
 
-Datum gtype_tan(PG_FUNCTION_ARGS)
+Datum gtype_sin(PG_FUNCTION_ARGS)
 {
-    gtype *agt = AG_GET_ARG_GTYPE_P(0);
-    gtype_value agtv_result;
-    float8 angle;
-    bool is_null;
+    return gtype_float8_math(fcinfo, "sin", dsin);
+}
 
-    angle = get_float_compatible_arg(GTYPE_P_GET_DATUM(agt), GTYPEOID, "tan", &is_null);
+PG_FUNCTION_INFO_V1(gtype_cos);
 
-    if (is_null)
-        PG_RETURN_NULL();
+Datum gtype_cos(PG_FUNCTION_ARGS)
+{
+    return gtype_float8_math(fcinfo, "cos", dcos);
+}
 
-    agtv_result.type = AGTV_FLOAT;
-    agtv_result.val.float_value =
-        DatumGetFloat8(DirectFunctionCall1(dtan, Float8GetDatum(angle)));
+PG_FUNCTION_INFO_V1(gtype_tan);
 
-    AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv_result));
+Datum gtype_tan(PG_FUNCTION_ARGS)
+{
+    return gtype_float8_math(fcinfo, "tan", dtan);
 }
 
 PG_FUNCTION_INFO_V1(gtype_cot);
 
 Datum gtype_cot(PG_FUNCTION_ARGS)
 {
-    gtype *agt = AG_GET_ARG_GTYPE_P(0);
-    gtype_value agtv_result;
-    float8 angle;
-    bool is_null;
-    
-    angle = get_float_compatible_arg(GTYPE_P_GET_DATUM(agt), GTYPEOID, "cot", &is_null);
-    
-    if (is_null)
-        PG_RETURN_NULL();
-    
-    agtv_result.type = AGTV_FLOAT;
-    agtv_result.val.float_value =
-        DatumGetFloat8(DirectFunctionCall1(dcot, Float8GetDatum(angle)));
-    
-    AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv_result));
+    return gtype_float8_math(fcinfo, "cot", dcot);
 }
 
 PG_FUNCTION_INFO_V1(gtype_asin);
 
 Datum gtype_asin(PG_FUNCTION_ARGS)
 {
-    gtype *agt = AG_GET_ARG_GTYPE_P(0);
-    gtype_value agtv_result;
-    float8 angle;
-    bool is_null;
-
-    angle = get_float_compatible_arg(GTYPE_P_GET_DATUM(agt), GTYPEOID, "asin", &is_null);
-
-    if (is_null)
-        PG_RETURN_NULL();
-
-    agtv_result.type = AGTV_FLOAT;
-    agtv_result.val.float_value =
-        DatumGetFloat8(DirectFunctionCall1(dasin, Float8GetDatum(angle)));
-
-    AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv_result));
+    return gtype_float8_math(fcinfo, "asin", dasin);
 }
 
 PG_FUNCTION_INFO_V1(gtype_acos);
 
 Datum gtype_acos(PG_FUNCTION_ARGS)
 {
-    gtype *agt = AG_GET_ARG_GTYPE_P(0);
-    gtype_value agtv_result;
-    float8 angle;
-    bool is_null;
-    
-    angle = get_float_compatible_arg(GTYPE_P_GET_DATUM(agt), GTYPEOID, "acos", &is_null);
-
-    if (is_null)
-        PG_RETURN_NULL();
-    
-    agtv_result.type = AGTV_FLOAT;
-    agtv_result.val.float_value =
-        DatumGetFloat8(DirectFunctionCall1(dacos, Float8GetDatum(angle)));
-    
-    AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv_result));
+    return gtype_float8_math(fcinfo, "acos", dacos);
 }
 
 PG_FUNCTION_INFO_V1(gtype_atan);
 
 Datum gtype_atan(PG_FUNCTION_ARGS)
 {
-    gtype *agt = AG_GET_ARG_GTYPE_P(0);
-    gtype_value agtv_result;
-    float8 angle;
-    bool is_null;
-    
-    angle = get_float_compatible_arg(GTYPE_P_GET_DATUM(agt), GTYPEOID, "atan", &is_null);
-    
-    if (is_null)
-        PG_RETURN_NULL();
-    
-    agtv_result.type = AGTV_FLOAT;
-    agtv_result.val.float_value =
-        DatumGetFloat8(DirectFunctionCall1(datan, Float8GetDatum(angle)));
-    
-    AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv_result));
+    return gtype_float8_math(fcinfo, "atan", datan);
 }
 
 PG_FUNCTION_INFO_V1(gtype_atan2);
 
 Datum gtype_atan2(PG_FUNCTION_ARGS)
 {
-    gtype *x_agt = AG_GET_ARG_GTYPE_P(0);
-    gtype *y_agt = AG_GET_ARG_GTYPE_P(1);
-    gtype_value agtv_result;
-    bool is_null;
     float8 x, y;
-    float8 angle;
-
-    y = get_float_compatible_arg(GTYPE_P_GET_DATUM(y_agt), GTYPEOID, "atan2", &is_null);
-
-    if (is_null)
-        PG_RETURN_NULL();
-
-    x = get_float_compatible_arg(GTYPE_P_GET_DATUM(x_agt), GTYPEOID, "atan2", &is_null);
 
-    if (is_null)
+    if (!get_float8_arg(fcinfo, 1, "atan2", &y) ||
+        !get_float8_arg(fcinfo, 0, "atan2", &x))
         PG_RETURN_NULL();
 
-    angle = DatumGetFloat8(DirectFunctionCall2(datan2,
-                                               Float8GetDatum(y),
-                                               Float8GetDatum(x)));
-
-    agtv_result.type = AGTV_FLOAT;
-    agtv_result.val.float_value = angle;
-
-    PG_RETURN_POINTER(gtype_value_to_gtype(&agtv_result));
+    AG_RETURN_GTYPE_P(make_gtype_float(
+        DatumGetFloat8(DirectFunctionCall2(datan2, Float8GetDatum(y),
+                                           Float8GetDatum(x)))));
 }
 
 PG_FUNCTION_INFO_V1(gtype_degrees);
 
 Datum gtype_degrees(PG_FUNCTION_ARGS)
 {
-    gtype *agt = AG_GET_ARG_GTYPE_P(0);
-    gtype_value agtv_result;
-    float8 angle;
-    bool is_null;
-
-    angle = get_float_compatible_arg(GTYPE_P_GET_DATUM(agt), GTYPEOID, "degrees", &is_null);
-
-    if (is_null)
-        PG_RETURN_NULL();
-
-    agtv_result.type = AGTV_FLOAT;
-    agtv_result.val.float_value =
-        DatumGetFloat8(DirectFunctionCall1(degrees, Float8GetDatum(angle)));
-
-    AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv_result));
+    return gtype_float8_math(fcinfo, "degrees", degrees);
 }
 
 PG_FUNCTION_INFO_V1(gtype_radians);
 
 Datum gtype_radians(PG_FUNCTION_ARGS)
 {
-    gtype *agt = AG_GET_ARG_GTYPE_P(0);
-    gtype_value agtv_result;
-    float8 angle;
-    bool is_null;
-    
-    angle = get_float_compatible_arg(GTYPE_P_GET_DATUM(agt), GTYPEOID, "radians", &is_null);
-    
-    if (is_null)
-        PG_RETURN_NULL();
-    
-    agtv_result.type = AGTV_FLOAT;
-    agtv_result.val.float_value =
-        DatumGetFloat8(DirectFunctionCall1(radians, Float8GetDatum(angle)));
-    
-    AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv_result));
+    return gtype_float8_math(fcinfo, "radians", radians);
 }
 
 PG_FUNCTION_INFO_V1(gtype_round);
@@ -3535,16 +3541,10 @@ Datum gtype_ceil(PG_FUNCTION_ARGS)
 
         gtype_value agtv = { .type = AGTV_NUMERIC, .val.numeric = result };
 
-        AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv));
-    } else {
-        float8 arg = get_float_compatible_arg(GTYPE_P_GET_DATUM(agt), GTYPEOID, "ceil", &is_null);
-    
-        float8 result = DatumGetFloat8(DirectFunctionCall1(dceil, Float8GetDatum(arg)));
-    
-        gtype_value agtv = { .type = AGTV_FLOAT, .val.float_value = result };
-
         AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv));
     }
+
+    return gtype_float8_math(fcinfo, "ceil", dceil);
 }
 
 PG_FUNCTION_INFO_V1(gtype_floor);
@@ -3561,30 +3561,44 @@ Datum gtype_floor(PG_FUNCTION_ARGS)
         Numeric arg = get_numeric_compatible_arg(GTYPE_P_GET_DATUM(agt), GTYPEOID, "floor", &is_null, NULL);
 
         Numeric result = DatumGetNumeric(DirectFunctionCall1(numeric_floor, NumericGetDatum(arg)));
-                                          
-        gtype_value agtv = { .type = AGTV_NUMERIC, .val.numeric = result };
 
-        AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv));
-    } else {
-        float8 arg = get_float_compatible_arg(GTYPE_P_GET_DATUM(agt), GTYPEOID, "floor", &is_null);
-    
-        float8 result = DatumGetFloat8(DirectFunctionCall1(dfloor, Float8GetDatum(arg)));
-    
-        gtype_value agtv = { .type = AGTV_FLOAT, .val.float_value = result };
+        gtype_value agtv = { .type = AGTV_NUMERIC, .val.numeric = result };
 
         AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv));
     }
+
+    return gtype_float8_math(fcinfo, "floor", dfloor);
 }
 
 PG_FUNCTION_INFO_V1(gtype_abs);
 
 Datum gtype_abs(PG_FUNCTION_ARGS)
 {
+    gtype *agt = AG_GET_ARG_GTYPE_P(0);
     gtype_value agtv_result;
     bool is_null;
     enum gtype_value_type type;
 
-    Numeric arg = get_numeric_compatible_arg(AG_GET_ARG_GTYPE_P(0), GTYPEOID, "abs", &is_null, &type);
+    /* integers and floats don't need to go through a numeric */
+    if (is_gtype_integer(agt)) {
+        int64 i;
+
+        memcpy(&i, (char *)&agt->root.children[1] + sizeof(uint32), sizeof(int64));
+
+        if (i == PG_INT64_MIN)
+            ereport(ERROR, (errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+                            errmsg("bigint out of range")));
+
+        AG_RETURN_GTYPE_P(make_gtype_integer(i < 0 ? -i : i));
+    } else if (is_gtype_float(agt)) {
+        float8 f;
+
+        get_inline_float8_arg(agt, &f);
+
+        AG_RETURN_GTYPE_P(make_gtype_float(fabs(f)));
+    }
+
+    Numeric arg = get_numeric_compatible_arg(GTYPE_P_GET_DATUM(agt), GTYPEOID, "abs", &is_null, &type);
 
     if (is_null)
         PG_RETURN_NULL();
@@ -3642,6 +3656,14 @@ Datum gtype_sign(PG_FUNCTION_ARGS) {
     if (nargs < 0 || nulls[0])
         PG_RETURN_NULL();
 
+    /* integers and floats don't need to go through a numeric */
+    if (types[0] == GTYPEOID) {
+        float8 f;
+
+        if (get_inline_float8_arg(DATUM_GET_GTYPE_P(args[0]), &f) && !isnan(f))
+            AG_RETURN_GTYPE_P(make_gtype_integer((f > 0) - (f < 0)));
+    }
+
     /*
      * sign() supports integer, float, and numeric or the gtype integer,
      * float, and numeric for the input expression.
@@ -3676,19 +3698,13 @@ Datum gtype_log(PG_FUNCTION_ARGS) {
         Numeric arg = get_numeric_compatible_arg(GTYPE_P_GET_DATUM(agt), GTYPEOID, "log", &is_null, NULL);
 
         Numeric result = DatumGetNumeric(DirectFunctionCall1(numeric_ln, NumericGetDatum(arg)));
-        
-        gtype_value agtv = { .type = AGTV_NUMERIC, .val.numeric = result };
-
-        AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv));
-    } else {
-        float8 arg = get_float_compatible_arg(GTYPE_P_GET_DATUM(agt), GTYPEOID, "log", &is_null);
-
-        float8 result = DatumGetFloat8(DirectFunctionCall1(dlog1, Float8GetDatum(arg)));
 
-        gtype_value agtv = { .type = AGTV_FLOAT, .val.float_value = result };
+        gtype_value agtv = { .type = AGTV_NUMERIC, .val.numeric = result };
 
         AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv));
     }
+
+    return gtype_float8_math(fcinfo, "log", dlog1);
 }
 
 PG_FUNCTION_INFO_V1(gtype_log10);
@@ -3706,52 +3722,33 @@ Datum gtype_log10(PG_FUNCTION_ARGS) {
 
         gtype_value agtv = { .type = AGTV_NUMERIC, .val.numeric = result };
 
-        AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv));
-    } else {
-        float8 arg = get_float_compatible_arg(GTYPE_P_GET_DATUM(agt), GTYPEOID, "log10", &is_null);
-
-        float8 result = DatumGetFloat8(DirectFunctionCall1(dlog10, Float8GetDatum(arg)));
-
-        gtype_value agtv = { .type = AGTV_FLOAT, .val.float_value = result };
-
         AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv));
     }
+
+    return gtype_float8_math(fcinfo, "log10", dlog10);
 }
 
 PG_FUNCTION_INFO_V1(gtype_e);
 
 Datum gtype_e(PG_FUNCTION_ARGS)
 {
-    gtype_value agtv_result = {
-        .type = AGTV_FLOAT,
-        .val.float_value = DatumGetFloat8(DirectFunctionCall1(dexp, Float8GetDatum(1)))
-    };
-
-    PG_RETURN_POINTER(gtype_value_to_gtype(&agtv_result));
+    AG_RETURN_GTYPE_P(make_gtype_float(
+        DatumGetFloat8(DirectFunctionCall1(dexp, Float8GetDatum(1)))));
 }
 
 PG_FUNCTION_INFO_V1(gtype_pi);
     
 Datum gtype_pi(PG_FUNCTION_ARGS)
-{   
-    gtype_value agtv_result = {
-        .type = AGTV_FLOAT,
-        .val.float_value = M_PI
-    };
-
-    PG_RETURN_POINTER(gtype_value_to_gtype(&agtv_result));
+{
+    AG_RETURN_GTYPE_P(make_gtype_float(M_PI));
 }   
 
 PG_FUNCTION_INFO_V1(gtype_rand);
 
 Datum gtype_rand(PG_FUNCTION_ARGS)
 {
-    gtype_value agtv_result = {
-        .type = AGTV_FLOAT,
-        .val.float_value = DatumGetFloat8(DirectFunctionCall1(random, Float8GetDatum(1)))
-    };
-
-    PG_RETURN_POINTER(gtype_value_to_gtype(&agtv_result));
+    AG_RETURN_GTYPE_P(make_gtype_float(
+        DatumGetFloat8(DirectFunctionCall1(random, Float8GetDatum(1)))));
 }
 
 PG_FUNCTION_INFO_V1(gtype_exp);
@@ -3771,16 +3768,10 @@ Datum gtype_exp(PG_FUNCTION_ARGS)
 
         gtype_value agtv = { .type = AGTV_NUMERIC, .val.numeric = result };
 
-        AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv));
-    } else {
-        float8 arg = get_float_compatible_arg(GTYPE_P_GET_DATUM(agt), GTYPEOID, "exp", &is_null);
-
-        float8 result = DatumGetFloat8(DirectFunctionCall1(dexp, Float8GetDatum(arg)));
-
-        gtype_value agtv = { .type = AGTV_FLOAT, .val.float_value = result };
-
         AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv));
     }
+
+    return gtype_float8_math(fcinfo, "exp", dexp);
 }
 
 PG_FUNCTION_INFO_V1(gtype_sqrt);
@@ -3801,16 +3792,9 @@ Datum gtype_sqrt(PG_FUNCTION_ARGS)
         gtype_value agtv = { .type = AGTV_NUMERIC, .val.numeric = result };
 
         AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv));
-    } else {
-        float8 arg = get_float_compatible_arg(GTYPE_P_GET_DATUM(agt), GTYPEOID, "sqrt", &is_null);
-
-        float8 result = DatumGetFloat8(DirectFunctionCall1(dsqrt, Float8GetDatum(arg)));                                                       
-
-        gtype_value agtv = { .type = AGTV_FLOAT, .val.float_value = result };
-
-        AG_RETURN_GTYPE_P(gtype_value_to_gtype(&agtv));
-
     }
+
+    return gtype_float8_math(fcinfo, "sqrt", dsqrt);
 }
 
 /*
@@ -4221,467 +4205,1691 @@ Datum gtype_gtype_sum(PG_FUNCTION_ARGS)
 }
 
 /*
- * Wrapper function for float8_accum to take an gtype input.
- * This function is defined as STRICT so it does not need to check
- * for NULL input parameters
+ * State of sum(gtype). The running sum is kept unboxed and is widened from
+ * integer to float to numeric only when an input of that type shows up, the
+ * way gtype_gtype_sum() does. A single gtype is built by the final function.
  */
-PG_FUNCTION_INFO_V1(gtype_accum);
+typedef struct gtype_sum_agg_state
+{
+    /* AGTV_NULL until a number has been added */
+    enum gtype_value_type type;
+    int64 int_sum;
+    float8 float_sum;
+    /* kept in the aggregate memory context */
+    Numeric numeric_sum;
+} gtype_sum_agg_state;
 
-Datum gtype_accum(PG_FUNCTION_ARGS)
+static gtype_sum_agg_state *make_sum_agg_state(MemoryContext aggcontext)
 {
-    Datum dfloat;
-    Datum result;
+    gtype_sum_agg_state *state;
 
-    /* convert to a float8 datum, if possible */
-    dfloat = DirectFunctionCall1(gtype_to_float8, PG_GETARG_DATUM(1));
-    /* pass the arguments off to float8_accum */
-    result = DirectFunctionCall2(float8_accum, PG_GETARG_DATUM(0), dfloat);
+    state = MemoryContextAllocZero(aggcontext, sizeof(gtype_sum_agg_state));
+    state->type = AGTV_NULL;
 
-    PG_RETURN_DATUM(result);
+    return state;
 }
 
-/* Wrapper for stdDev function. */
-PG_FUNCTION_INFO_V1(gtype_stddev_samp_final);
-
-Datum gtype_stddev_samp_final(PG_FUNCTION_ARGS)
+/* converts the running sum to a numeric in the aggregate memory context */
+static void sum_agg_state_to_numeric(gtype_sum_agg_state *state,
+                                     MemoryContext aggcontext)
 {
-    Datum result;
-    PGFunction func;
-    gtype_value agtv_float;
+    MemoryContext old_mcxt = MemoryContextSwitchTo(aggcontext);
+
+    if (state->type == AGTV_INTEGER)
+        state->numeric_sum = DatumGetNumeric(DirectFunctionCall1(int8_numeric,
+                                 Int64GetDatum(state->int_sum)));
+    else if (state->type == AGTV_FLOAT)
+        state->numeric_sum = DatumGetNumeric(DirectFunctionCall1(float8_numeric,
+                                 Float8GetDatum(state->float_sum)));
+    else
+        state->numeric_sum = int64_to_numeric(0);
 
-    /* we can't use DirectFunctionCall1 as it errors for NULL values */
-    func = float8_stddev_samp;
-    result = (*func) (fcinfo);
+    state->type = AGTV_NUMERIC;
 
-    agtv_float.type = AGTV_FLOAT;
+    MemoryContextSwitchTo(old_mcxt);
+}
 
-    /*
-     * Check to see if float8_stddev_samp returned null. If so, we need to
-     * return a gtype float 0.
-     */
-    if (fcinfo->isnull)
+static void sum_agg_state_add(gtype_sum_agg_state *state,
+                              MemoryContext aggcontext, gtype_value *agtv)
+{
+    /* widen the running sum first, if the new value needs it */
+    if (agtv->type == AGTV_NUMERIC && state->type != AGTV_NUMERIC)
     {
-        /* we need to clear the flag */
-        fcinfo->isnull = false;
-        agtv_float.val.float_value = 0.0;
+        sum_agg_state_to_numeric(state, aggcontext);
     }
-    else
+    else if (agtv->type == AGTV_FLOAT && state->type != AGTV_FLOAT &&
+             state->type != AGTV_NUMERIC)
+    {
+        state->float_sum = (state->type == AGTV_INTEGER) ?
+                           (float8) state->int_sum : 0.0;
+        state->type = AGTV_FLOAT;
+    }
+    else if (state->type == AGTV_NULL)
     {
-        agtv_float.val.float_value = DatumGetFloat8(result);
+        state->int_sum = 0;
+        state->type = AGTV_INTEGER;
     }
 
-    PG_RETURN_POINTER(gtype_value_to_gtype(&agtv_float));
+    switch (state->type)
+    {
+        case AGTV_INTEGER:
+            if (pg_add_s64_overflow(state->int_sum, agtv->val.int_value,
+                                    &state->int_sum))
+                ereport(ERROR,
+                        (errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+                         errmsg("bigint out of range")));
+            break;
+        case AGTV_FLOAT:
+            state->float_sum = float8_pl(state->float_sum,
+                                         (agtv->type == AGTV_FLOAT) ?
+                                         agtv->val.float_value :
+                                         (float8) agtv->val.int_value);
+            break;
+        case AGTV_NUMERIC:
+        {
+            MemoryContext old_mcxt;
+            Numeric old_sum = state->numeric_sum;
+            Datum dnum;
+
+            if (agtv->type == AGTV_NUMERIC)
+                dnum = NumericGetDatum(agtv->val.numeric);
+            else if (agtv->type == AGTV_FLOAT)
+                dnum = DirectFunctionCall1(float8_numeric,
+                                           Float8GetDatum(agtv->val.float_value));
+            else
+                dnum = DirectFunctionCall1(int8_numeric,
+                                           Int64GetDatum(agtv->val.int_value));
+
+            old_mcxt = MemoryContextSwitchTo(aggcontext);
+            state->numeric_sum = DatumGetNumeric(DirectFunctionCall2(numeric_add,
+                                     NumericGetDatum(old_sum), dnum));
+            MemoryContextSwitchTo(old_mcxt);
+
+            pfree(old_sum);
+        }
+            break;
+        default:
+            elog(ERROR, "unexpected gtype");
+            break;
+    }
 }
 
-PG_FUNCTION_INFO_V1(gtype_stddev_pop_final);
+PG_FUNCTION_INFO_V1(gtype_sum_aggtransfn);
 
-Datum gtype_stddev_pop_final(PG_FUNCTION_ARGS)
+Datum gtype_sum_aggtransfn(PG_FUNCTION_ARGS)
 {
-    Datum result;
-    PGFunction func;
-    gtype_value agtv_float;
+    gtype_sum_agg_state *state;
+    MemoryContext aggcontext;
+    gtype *agt_arg;
+    gtype_value *agtv;
 
-    /* we can't use DirectFunctionCall1 as it errors for NULL values */
-    func = float8_stddev_pop;
-    result = (*func) (fcinfo);
+    if (!AggCheckCallContext(fcinfo, &aggcontext))
+        elog(ERROR, "sum_aggtransfn called in non-aggregate context");
 
-    agtv_float.type = AGTV_FLOAT;
-
-    /*
-     * Check to see if float8_stddev_pop returned null. If so, we need to
-     * return a gtype float 0.
-     */
-    if (fcinfo->isnull)
-    {
-        /* we need to clear the flag */
-        fcinfo->isnull = false;
-        agtv_float.val.float_value = 0.0;
-    }
+    if (PG_ARGISNULL(0))
+        state = make_sum_agg_state(aggcontext);
     else
-    {
-        agtv_float.val.float_value = DatumGetFloat8(result);
-    }
+        state = (gtype_sum_agg_state *) PG_GETARG_POINTER(0);
 
-    PG_RETURN_POINTER(gtype_value_to_gtype(&agtv_float));
-}
+    if (PG_ARGISNULL(1))
+        PG_RETURN_POINTER(state);
 
-PG_FUNCTION_INFO_V1(gtype_max_trans);
+    agt_arg = AG_GET_ARG_GTYPE_P(1);
 
-Datum gtype_max_trans(PG_FUNCTION_ARGS)
-{
-    gtype *gtype_arg1;
-    gtype *gtype_arg2;
-    gtype *gtype_larger;
-    int test;
+    /* only scalars are allowed */
+    if (!AGT_ROOT_IS_SCALAR(agt_arg))
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("arguments must resolve to a scalar")));
 
-    /* for max we need to ignore NULL values */
-    /* extract the args as gtype */
-    gtype_arg1 = get_one_gtype_from_variadic_args(fcinfo, 0, 2);
-    gtype_arg2 = get_one_gtype_from_variadic_args(fcinfo, 1, 1);
+    agtv = get_ith_gtype_value_from_container(&agt_arg->root, 0);
 
-    if (gtype_arg1 == NULL && gtype_arg2 == NULL)
-        PG_RETURN_NULL();
-    else if (gtype_arg2 == NULL)
-        PG_RETURN_POINTER(gtype_arg1);
-    else if (gtype_arg1 == NULL)
-        PG_RETURN_POINTER(gtype_arg2);
+    /* gtype nulls are skipped, like SQL NULLs */
+    if (agtv->type == AGTV_NULL)
+        PG_RETURN_POINTER(state);
 
-    /* test for max value */
-    test = compare_gtype_containers_orderability(&gtype_arg1->root, &gtype_arg2->root);
+    /* only numbers are allowed */
+    if (agtv->type != AGTV_INTEGER && agtv->type != AGTV_FLOAT &&
+        agtv->type != AGTV_NUMERIC)
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("arguments must resolve to a number")));
 
-    gtype_larger = (test >= 0) ? gtype_arg1 : gtype_arg2;
+    sum_agg_state_add(state, aggcontext, agtv);
 
-    PG_RETURN_POINTER(gtype_larger);
+    PG_RETURN_POINTER(state);
 }
 
-PG_FUNCTION_INFO_V1(gtype_min_trans);
+PG_FUNCTION_INFO_V1(gtype_sum_aggcombinefn);
 
-Datum gtype_min_trans(PG_FUNCTION_ARGS)
+Datum gtype_sum_aggcombinefn(PG_FUNCTION_ARGS)
 {
-    gtype *gtype_arg1 = NULL;
-    gtype *gtype_arg2 = NULL;
-    gtype *gtype_smaller;
-    int test;
+    gtype_sum_agg_state *state1;
+    gtype_sum_agg_state *state2;
+    MemoryContext aggcontext;
+    gtype_value agtv;
 
-    /* for min we need to ignore NULL values */
-    /* extract the args as gtype */
-    gtype_arg1 = get_one_gtype_from_variadic_args(fcinfo, 0, 2);
-    gtype_arg2 = get_one_gtype_from_variadic_args(fcinfo, 1, 1);
+    if (!AggCheckCallContext(fcinfo, &aggcontext))
+        elog(ERROR, "sum_aggcombinefn called in non-aggregate context");
 
-    /* return NULL if both are NULL */
-    if (gtype_arg1 == NULL && gtype_arg2 == NULL)
-        PG_RETURN_NULL();
-    /* if one is NULL, return the other */
-    if (gtype_arg1 != NULL && gtype_arg2 == NULL)
-        PG_RETURN_POINTER(gtype_arg1);
-    if (gtype_arg1 == NULL && gtype_arg2 != NULL)
-        PG_RETURN_POINTER(gtype_arg2);
+    if (PG_ARGISNULL(0))
+        state1 = make_sum_agg_state(aggcontext);
+    else
+        state1 = (gtype_sum_agg_state *) PG_GETARG_POINTER(0);
 
-    /* test for min value */
-    test = compare_gtype_containers_orderability(&gtype_arg1->root,
-                                                  &gtype_arg2->root);
+    if (PG_ARGISNULL(1))
+        PG_RETURN_POINTER(state1);
+
+    state2 = (gtype_sum_agg_state *) PG_GETARG_POINTER(1);
+
+    /* add the running sum of the other state as a single value */
+    agtv.type = state2->type;
+    if (state2->type == AGTV_INTEGER)
+        agtv.val.int_value = state2->int_sum;
+    else if (state2->type == AGTV_FLOAT)
+        agtv.val.float_value = state2->float_sum;
+    else if (state2->type == AGTV_NUMERIC)
+        agtv.val.numeric = state2->numeric_sum;
+    else
+        PG_RETURN_POINTER(state1);
 
-    gtype_smaller = (test <= 0) ? gtype_arg1 : gtype_arg2;
+    sum_agg_state_add(state1, aggcontext, &agtv);
 
-    PG_RETURN_POINTER(gtype_smaller);
+    PG_RETURN_POINTER(state1);
 }
 
-/* borrowed from PGs float8 routines for percentile_cont */
-static Datum float8_lerp(Datum lo, Datum hi, double pct)
-{
-    double loval = DatumGetFloat8(lo);
-    double hival = DatumGetFloat8(hi);
+PG_FUNCTION_INFO_V1(gtype_sum_aggserialfn);
 
-    return Float8GetDatum(loval + (pct * (hival - loval)));
-}
+Datum gtype_sum_aggserialfn(PG_FUNCTION_ARGS)
+{
+    gtype_sum_agg_state *state;
+    StringInfoData buf;
 
-/* Code borrowed and adjusted from PG's ordered_set_transition function */
-PG_FUNCTION_INFO_V1(gtype_percentile_aggtransfn);
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "sum_aggserialfn called in non-aggregate context");
 
-Datum gtype_percentile_aggtransfn(PG_FUNCTION_ARGS)
-{
-    PercentileGroupAggState *pgastate;
+    state = (gtype_sum_agg_state *) PG_GETARG_POINTER(0);
 
-    /* verify we are in an aggregate context */
-    Assert(AggCheckCallContext(fcinfo, NULL) == AGG_CONTEXT_AGGREGATE);
+    pq_begintypsend(&buf);
 
-    /* if this is the first invocation, create the state */
-    if (PG_ARGISNULL(0))
+    pq_sendint32(&buf, state->type);
+    if (state->type == AGTV_INTEGER)
+    {
+        pq_sendint64(&buf, state->int_sum);
+    }
+    else if (state->type == AGTV_FLOAT)
+    {
+        pq_sendfloat8(&buf, state->float_sum);
+    }
+    else if (state->type == AGTV_NUMERIC)
     {
-        MemoryContext old_mcxt;
-        float8 percentile;
+        pq_sendint32(&buf, VARSIZE(state->numeric_sum));
+        pq_sendbytes(&buf, (char *) state->numeric_sum,
+                     VARSIZE(state->numeric_sum));
+    }
 
-        /* validate the percentile */
-        if (PG_ARGISNULL(2))
-            ereport(ERROR, (errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
-                errmsg("percentile value NULL is not a valid numeric value")));
+    PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
 
-        percentile = DatumGetFloat8(DirectFunctionCall1(gtype_to_float8,
-                         PG_GETARG_DATUM(2)));
+PG_FUNCTION_INFO_V1(gtype_sum_aggdeserialfn);
 
-        if (percentile < 0 || percentile > 1 || isnan(percentile))
-        ereport(ERROR, (errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
-                        errmsg("percentile value %g is not between 0 and 1",
-                               percentile)));
+Datum gtype_sum_aggdeserialfn(PG_FUNCTION_ARGS)
+{
+    bytea *sstate;
+    gtype_sum_agg_state *state;
+    StringInfoData buf;
 
-        /* switch to the correct aggregate context */
-        old_mcxt = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
-        /* create and initialize the state */
-        pgastate = palloc0(sizeof(PercentileGroupAggState));
-        pgastate->percentile = percentile;
-        /*
-         * Percentiles need to be calculated from a sorted set. We are only
-         * using float8 values, using the less than operator, and flagging
-         * randomAccess to true - as we can potentially be reusing this
-         * sort multiple times in the same query.
-         */
-        pgastate->sortstate = tuplesort_begin_datum(FLOAT8OID,
-                                                    Float8LessOperator,
-                                                    InvalidOid, false, work_mem,
-                                                    NULL, true);
-        pgastate->number_of_rows = 0;
-        pgastate->sort_done = false;
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "sum_aggdeserialfn called in non-aggregate context");
 
-        /* restore the old context */
-        MemoryContextSwitchTo(old_mcxt);
-    }
-    /* otherwise, retrieve the state */
-    else
-        pgastate = (PercentileGroupAggState *) PG_GETARG_POINTER(0);
+    sstate = PG_GETARG_BYTEA_PP(0);
 
-    /* Load the datum into the tuplesort object, but only if it's not null */
-    if (!PG_ARGISNULL(1))
+    initStringInfo(&buf);
+    appendBinaryStringInfo(&buf, VARDATA_ANY(sstate),
+                           VARSIZE_ANY_EXHDR(sstate));
+
+    state = make_sum_agg_state(CurrentMemoryContext);
+    state->type = pq_getmsgint(&buf, 4);
+    if (state->type == AGTV_INTEGER)
     {
-        Datum dfloat = DirectFunctionCall1(gtype_to_float8, PG_GETARG_DATUM(1));
+        state->int_sum = pq_getmsgint64(&buf);
+    }
+    else if (state->type == AGTV_FLOAT)
+    {
+        state->float_sum = pq_getmsgfloat8(&buf);
+    }
+    else if (state->type == AGTV_NUMERIC)
+    {
+        int len = pq_getmsgint(&buf, 4);
 
-        tuplesort_putdatum(pgastate->sortstate, dfloat, false);
-        pgastate->number_of_rows++;
+        /* copy it out, the message buffer is not aligned for a numeric */
+        state->numeric_sum = palloc(len);
+        memcpy(state->numeric_sum, pq_getmsgbytes(&buf, len), len);
     }
-    /* return the state */
-    PG_RETURN_POINTER(pgastate);
+    else if (state->type != AGTV_NULL)
+    {
+        elog(ERROR, "invalid sum() state");
+    }
+
+    pq_getmsgend(&buf);
+
+    PG_RETURN_POINTER(state);
 }
 
-/* Code borrowed and adjusted from PG's percentile_cont_final function */
-PG_FUNCTION_INFO_V1(gtype_percentile_cont_aggfinalfn);
+PG_FUNCTION_INFO_V1(gtype_sum_aggfinalfn);
 
-Datum gtype_percentile_cont_aggfinalfn(PG_FUNCTION_ARGS)
+Datum gtype_sum_aggfinalfn(PG_FUNCTION_ARGS)
 {
-    PercentileGroupAggState *pgastate;
-    float8 percentile;
-    int64 first_row = 0;
-    int64 second_row = 0;
-    Datum val;
-    Datum first_val;
-    Datum second_val;
-    double proportion;
-    bool isnull;
-    gtype_value agtv_float;
+    gtype_sum_agg_state *state;
+    gtype_value agtv_result;
 
-    /* verify we are in an aggregate context */
     Assert(AggCheckCallContext(fcinfo, NULL) == AGG_CONTEXT_AGGREGATE);
 
-    /* If there were no regular rows, the result is NULL */
     if (PG_ARGISNULL(0))
         PG_RETURN_NULL();
 
-    /* retrieve the state and percentile */
-    pgastate = (PercentileGroupAggState *) PG_GETARG_POINTER(0);
-    percentile = pgastate->percentile;
-
-    /* number_of_rows could be zero if we only saw NULL input values */
-    if (pgastate->number_of_rows == 0)
-        PG_RETURN_NULL();
+    state = (gtype_sum_agg_state *) PG_GETARG_POINTER(0);
 
-    /* Finish the sort, or rescan if we already did */
-    if (!pgastate->sort_done)
+    agtv_result.type = state->type;
+    switch (state->type)
     {
-        tuplesort_performsort(pgastate->sortstate);
-        pgastate->sort_done = true;
+        case AGTV_INTEGER:
+            agtv_result.val.int_value = state->int_sum;
+            break;
+        case AGTV_FLOAT:
+            agtv_result.val.float_value = state->float_sum;
+            break;
+        case AGTV_NUMERIC:
+            agtv_result.val.numeric = state->numeric_sum;
+            break;
+        default:
+            /* only NULL values were seen */
+            PG_RETURN_NULL();
     }
-    else
-        tuplesort_rescan(pgastate->sortstate);
 
-    /* calculate the percentile cont*/
-    first_row = floor(percentile * (pgastate->number_of_rows - 1));
-    second_row = ceil(percentile * (pgastate->number_of_rows - 1));
+    PG_RETURN_POINTER(gtype_value_to_gtype(&agtv_result));
+}
 
-    Assert(first_row < pgastate->number_of_rows);
+/*
+ * State of avg(), stDev() and stDevP(). These are the N, Sx and Sxx
+ * accumulators of PG's float8_accum, kept unboxed rather than in a float8
+ * array that is rebuilt for every row.
+ */
+typedef struct gtype_float_agg_state
+{
+    float8 N;
+    float8 Sx;
+    float8 Sxx;
+} gtype_float_agg_state;
 
-    if (!tuplesort_skiptuples(pgastate->sortstate, first_row, true))
-        elog(ERROR, "missing row in percentile_cont");
+/* Code borrowed and adjusted from PG's float8_accum function */
+PG_FUNCTION_INFO_V1(gtype_float_aggtransfn);
 
-    if (!tuplesort_getdatum(pgastate->sortstate, true, &first_val, &isnull, NULL))
-        elog(ERROR, "missing row in percentile_cont");
-    if (isnull)
-        PG_RETURN_NULL();
+Datum gtype_float_aggtransfn(PG_FUNCTION_ARGS)
+{
+    gtype_float_agg_state *state;
+    MemoryContext aggcontext;
+    float8 newval;
+    float8 tmp;
 
-    if (first_row == second_row)
-    {
-        val = first_val;
-    }
+    if (!AggCheckCallContext(fcinfo, &aggcontext))
+        elog(ERROR, "float_aggtransfn called in non-aggregate context");
+
+    if (PG_ARGISNULL(0))
+        state = MemoryContextAllocZero(aggcontext,
+                                       sizeof(gtype_float_agg_state));
     else
-    {
-        if (!tuplesort_getdatum(pgastate->sortstate, true, &second_val, &isnull, NULL))
-            elog(ERROR, "missing row in percentile_cont");
+        state = (gtype_float_agg_state *) PG_GETARG_POINTER(0);
 
-        if (isnull)
+    /* gtype nulls are skipped, like SQL NULLs */
+    if (PG_ARGISNULL(1) || is_gtype_null(AG_GET_ARG_GTYPE_P(1)))
+        PG_RETURN_POINTER(state);
+
+    /* convert to a float8, if possible */
+    newval = DatumGetFloat8(DirectFunctionCall1(gtype_to_float8,
+                                                PG_GETARG_DATUM(1)));
+
+    /* use the Youngs-Cramer algorithm to incorporate the new value */
+    state->N += 1.0;
+    state->Sx += newval;
+    if (state->N > 1.0)
+    {
+        tmp = newval * state->N - state->Sx;
+        state->Sxx += tmp * tmp / (state->N * (state->N - 1.0));
+
+        /* overflow check, see float8_accum */
+        if (isinf(state->Sx) || isinf(state->Sxx))
+        {
+            if (!isinf(state->Sx - newval) && !isinf(newval))
+                float_overflow_error();
+
+            state->Sxx = get_float8_nan();
+        }
+    }
+    else if (isnan(newval) || isinf(newval))
+    {
+        state->Sxx = get_float8_nan();
+    }
+
+    PG_RETURN_POINTER(state);
+}
+
+/* Code borrowed and adjusted from PG's float8_combine function */
+PG_FUNCTION_INFO_V1(gtype_float_aggcombinefn);
+
+Datum gtype_float_aggcombinefn(PG_FUNCTION_ARGS)
+{
+    gtype_float_agg_state *state1;
+    gtype_float_agg_state *state2;
+    MemoryContext aggcontext;
+    float8 N;
+    float8 tmp;
+
+    if (!AggCheckCallContext(fcinfo, &aggcontext))
+        elog(ERROR, "float_aggcombinefn called in non-aggregate context");
+
+    if (PG_ARGISNULL(0))
+        state1 = MemoryContextAllocZero(aggcontext,
+                                        sizeof(gtype_float_agg_state));
+    else
+        state1 = (gtype_float_agg_state *) PG_GETARG_POINTER(0);
+
+    if (PG_ARGISNULL(1))
+        PG_RETURN_POINTER(state1);
+
+    state2 = (gtype_float_agg_state *) PG_GETARG_POINTER(1);
+
+    if (state2->N == 0.0)
+        PG_RETURN_POINTER(state1);
+
+    if (state1->N == 0.0)
+    {
+        *state1 = *state2;
+        PG_RETURN_POINTER(state1);
+    }
+
+    N = state1->N + state2->N;
+    tmp = state1->Sx / state1->N - state2->Sx / state2->N;
+    state1->Sxx = state1->Sxx + state2->Sxx +
+                  state1->N * state2->N * tmp * tmp / N;
+    state1->Sx = float8_pl(state1->Sx, state2->Sx);
+    state1->N = N;
+
+    PG_RETURN_POINTER(state1);
+}
+
+PG_FUNCTION_INFO_V1(gtype_float_aggserialfn);
+
+Datum gtype_float_aggserialfn(PG_FUNCTION_ARGS)
+{
+    gtype_float_agg_state *state;
+    StringInfoData buf;
+
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "float_aggserialfn called in non-aggregate context");
+
+    state = (gtype_float_agg_state *) PG_GETARG_POINTER(0);
+
+    pq_begintypsend(&buf);
+    pq_sendfloat8(&buf, state->N);
+    pq_sendfloat8(&buf, state->Sx);
+    pq_sendfloat8(&buf, state->Sxx);
+
+    PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+PG_FUNCTION_INFO_V1(gtype_float_aggdeserialfn);
+
+Datum gtype_float_aggdeserialfn(PG_FUNCTION_ARGS)
+{
+    bytea *sstate;
+    gtype_float_agg_state *state;
+    StringInfoData buf;
+
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "float_aggdeserialfn called in non-aggregate context");
+
+    sstate = PG_GETARG_BYTEA_PP(0);
+
+    initStringInfo(&buf);
+    appendBinaryStringInfo(&buf, VARDATA_ANY(sstate),
+                           VARSIZE_ANY_EXHDR(sstate));
+
+    state = palloc(sizeof(gtype_float_agg_state));
+    state->N = pq_getmsgfloat8(&buf);
+    state->Sx = pq_getmsgfloat8(&buf);
+    state->Sxx = pq_getmsgfloat8(&buf);
+
+    pq_getmsgend(&buf);
+
+    PG_RETURN_POINTER(state);
+}
+
+PG_FUNCTION_INFO_V1(gtype_avg_aggfinalfn);
+
+Datum gtype_avg_aggfinalfn(PG_FUNCTION_ARGS)
+{
+    gtype_float_agg_state *state;
+    gtype_value agtv_float;
+
+    /* SQL defines AVG of no values to be NULL */
+    if (PG_ARGISNULL(0))
+        PG_RETURN_NULL();
+
+    state = (gtype_float_agg_state *) PG_GETARG_POINTER(0);
+
+    if (state->N == 0.0)
+        PG_RETURN_NULL();
+
+    agtv_float.type = AGTV_FLOAT;
+    agtv_float.val.float_value = state->Sx / state->N;
+
+    PG_RETURN_POINTER(gtype_value_to_gtype(&agtv_float));
+}
+
+/*
+ * Returns the standard deviation of the state, or a gtype float 0 if there
+ * are too few values for one, like the stddev finals did before.
+ */
+static Datum float_agg_stddev(FunctionCallInfo fcinfo, bool sample)
+{
+    gtype_float_agg_state *state;
+    gtype_value agtv_float;
+    float8 min_n = sample ? 1.0 : 0.0;
+
+    agtv_float.type = AGTV_FLOAT;
+    agtv_float.val.float_value = 0.0;
+
+    if (!PG_ARGISNULL(0))
+    {
+        state = (gtype_float_agg_state *) PG_GETARG_POINTER(0);
+
+        /* watch out for roundoff error producing a negative numerator */
+        if (state->N > min_n && state->Sxx > 0.0)
+            agtv_float.val.float_value = sqrt(state->Sxx /
+                                              (state->N - (sample ? 1.0 : 0.0)));
+        else if (state->N > min_n && isnan(state->Sxx))
+            agtv_float.val.float_value = state->Sxx;
+    }
+
+    PG_RETURN_POINTER(gtype_value_to_gtype(&agtv_float));
+}
+
+PG_FUNCTION_INFO_V1(gtype_stddev_samp_aggfinalfn);
+
+Datum gtype_stddev_samp_aggfinalfn(PG_FUNCTION_ARGS)
+{
+    return float_agg_stddev(fcinfo, true);
+}
+
+PG_FUNCTION_INFO_V1(gtype_stddev_pop_aggfinalfn);
+
+Datum gtype_stddev_pop_aggfinalfn(PG_FUNCTION_ARGS)
+{
+    return float_agg_stddev(fcinfo, false);
+}
+
+PG_FUNCTION_INFO_V1(gtype_max_trans);
+
+Datum gtype_max_trans(PG_FUNCTION_ARGS)
+{
+    gtype *gtype_arg1;
+    gtype *gtype_arg2;
+    gtype *gtype_larger;
+    int test;
+
+    /* for max we need to ignore NULL values */
+    /* extract the args as gtype */
+    gtype_arg1 = get_one_gtype_from_variadic_args(fcinfo, 0, 2);
+    gtype_arg2 = get_one_gtype_from_variadic_args(fcinfo, 1, 1);
+
+    if (gtype_arg1 == NULL && gtype_arg2 == NULL)
+        PG_RETURN_NULL();
+    else if (gtype_arg2 == NULL)
+        PG_RETURN_POINTER(gtype_arg1);
+    else if (gtype_arg1 == NULL)
+        PG_RETURN_POINTER(gtype_arg2);
+
+    /* test for max value */
+    test = compare_gtype_containers_orderability(&gtype_arg1->root, &gtype_arg2->root);
+
+    gtype_larger = (test >= 0) ? gtype_arg1 : gtype_arg2;
+
+    PG_RETURN_POINTER(gtype_larger);
+}
+
+PG_FUNCTION_INFO_V1(gtype_min_trans);
+
+Datum gtype_min_trans(PG_FUNCTION_ARGS)
+{
+    gtype *gtype_arg1 = NULL;
+    gtype *gtype_arg2 = NULL;
+    gtype *gtype_smaller;
+    int test;
+
+    /* for min we need to ignore NULL values */
+    /* extract the args as gtype */
+    gtype_arg1 = get_one_gtype_from_variadic_args(fcinfo, 0, 2);
+    gtype_arg2 = get_one_gtype_from_variadic_args(fcinfo, 1, 1);
+
+    /* return NULL if both are NULL */
+    if (gtype_arg1 == NULL && gtype_arg2 == NULL)
+        PG_RETURN_NULL();
+    /* if one is NULL, return the other */
+    if (gtype_arg1 != NULL && gtype_arg2 == NULL)
+        PG_RETURN_POINTER(gtype_arg1);
+    if (gtype_arg1 == NULL && gtype_arg2 != NULL)
+        PG_RETURN_POINTER(gtype_arg2);
+
+    /* test for min value */
+    test = compare_gtype_containers_orderability(&gtype_arg1->root,
+                                                  &gtype_arg2->root);
+
+    gtype_smaller = (test <= 0) ? gtype_arg1 : gtype_arg2;
+
+    PG_RETURN_POINTER(gtype_smaller);
+}
+
+/* borrowed from PGs float8 routines for percentile_cont */
+static Datum float8_lerp(Datum lo, Datum hi, double pct)
+{
+    double loval = DatumGetFloat8(lo);
+    double hival = DatumGetFloat8(hi);
+
+    return Float8GetDatum(loval + (pct * (hival - loval)));
+}
+
+static int percentile_float8_cmp(const void *a, const void *b)
+{
+    return float8_cmp_internal(*(const float8 *)a, *(const float8 *)b);
+}
+
+/* validates and returns the percentile argument of the percentile aggregates */
+static float8 get_percentile_arg(FunctionCallInfo fcinfo, int argno)
+{
+    float8 percentile;
+
+    if (PG_ARGISNULL(argno))
+        ereport(ERROR, (errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+            errmsg("percentile value NULL is not a valid numeric value")));
+
+    percentile = DatumGetFloat8(DirectFunctionCall1(gtype_to_float8,
+                     PG_GETARG_DATUM(argno)));
+
+    if (percentile < 0 || percentile > 1 || isnan(percentile))
+        ereport(ERROR, (errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+                        errmsg("percentile value %g is not between 0 and 1",
+                               percentile)));
+
+    return percentile;
+}
+
+static PercentileGroupAggState *make_percentile_state(MemoryContext aggcontext,
+                                                      float8 percentile)
+{
+    PercentileGroupAggState *pgastate;
+
+    pgastate = MemoryContextAlloc(aggcontext, sizeof(PercentileGroupAggState));
+    pgastate->percentile = percentile;
+    pgastate->number_of_rows = 0;
+    pgastate->max_rows = 64;
+    pgastate->values = MemoryContextAlloc(aggcontext,
+                                          pgastate->max_rows * sizeof(float8));
+    pgastate->sorted = true;
+    pgastate->mcxt = aggcontext;
+    pgastate->sortstate = NULL;
+    pgastate->shutdown_registered = false;
+
+    return pgastate;
+}
+
+/*
+ * Ends the tuplesort of a percentile state. Registered as a shutdown callback
+ * of the aggregate, so the tuplesort and its temporary files are released
+ * when the aggregate context is reset, as PG's ordered_set_shutdown does.
+ */
+static void percentile_state_shutdown(Datum arg)
+{
+    PercentileGroupAggState *pgastate;
+
+    pgastate = (PercentileGroupAggState *) DatumGetPointer(arg);
+
+    if (pgastate->sortstate != NULL)
+        tuplesort_end(pgastate->sortstate);
+    pgastate->sortstate = NULL;
+}
+
+/*
+ * Moves the values to a tuplesort, which spills to disk, once the array would
+ * grow past work_mem. The tuplesort is flagged randomAccess, as the final
+ * function may rescan it. If fcinfo is not NULL, the state lives in the
+ * aggregate context and the tuplesort is ended when that context is reset.
+ * Otherwise the caller must end it with percentile_state_shutdown().
+ */
+static void percentile_state_begin_sort(FunctionCallInfo fcinfo,
+                                        PercentileGroupAggState *pgastate)
+{
+    MemoryContext old_mcxt;
+    int64 i;
+
+    old_mcxt = MemoryContextSwitchTo(pgastate->mcxt);
+    pgastate->sortstate = tuplesort_begin_datum(FLOAT8OID, Float8LessOperator,
+                                                InvalidOid, false, work_mem,
+                                                NULL, true);
+    MemoryContextSwitchTo(old_mcxt);
+
+    if (fcinfo != NULL)
+    {
+        AggRegisterCallback(fcinfo, percentile_state_shutdown,
+                            PointerGetDatum(pgastate));
+        pgastate->shutdown_registered = true;
+    }
+
+    for (i = 0; i < pgastate->number_of_rows; i++)
+        tuplesort_putdatum(pgastate->sortstate,
+                           Float8GetDatum(pgastate->values[i]), false);
+
+    pfree(pgastate->values);
+    pgastate->values = NULL;
+    pgastate->max_rows = 0;
+}
+
+static void percentile_state_append(FunctionCallInfo fcinfo,
+                                    PercentileGroupAggState *pgastate,
+                                    float8 value)
+{
+    if (pgastate->sortstate == NULL &&
+        pgastate->number_of_rows == pgastate->max_rows)
+    {
+        if (pgastate->max_rows * 2 * sizeof(float8) > (Size) work_mem * 1024)
+        {
+            percentile_state_begin_sort(fcinfo, pgastate);
+        }
+        else
+        {
+            pgastate->max_rows *= 2;
+            pgastate->values = repalloc_huge(pgastate->values,
+                                             pgastate->max_rows *
+                                             sizeof(float8));
+        }
+    }
+
+    if (pgastate->sortstate != NULL)
+        tuplesort_putdatum(pgastate->sortstate, Float8GetDatum(value), false);
+    else
+        pgastate->values[pgastate->number_of_rows] = value;
+
+    pgastate->number_of_rows++;
+    pgastate->sorted = false;
+}
+
+/*
+ * Sorts the values, or rewinds the tuplesort if they are already sorted. An
+ * array is sorted in place and stays valid for more transitions. A tuplesort
+ * does not take more values once it is sorted, so sorting it freezes the
+ * state for good: it can only be read from then on. The aggregates using
+ * this state have a READ_WRITE final function for that reason.
+ */
+static void percentile_state_sort(PercentileGroupAggState *pgastate)
+{
+    if (pgastate->sorted)
+    {
+        if (pgastate->sortstate != NULL)
+            tuplesort_rescan(pgastate->sortstate);
+        return;
+    }
+
+    if (pgastate->sortstate != NULL)
+        tuplesort_performsort(pgastate->sortstate);
+    else
+        qsort(pgastate->values, pgastate->number_of_rows, sizeof(float8),
+              percentile_float8_cmp);
+    pgastate->sorted = true;
+}
+
+/*
+ * Returns the value of the given row of the sorted values. If next_value is
+ * not NULL, it is set to the value of the row after it.
+ */
+static float8 percentile_state_get(PercentileGroupAggState *pgastate,
+                                   int64 row, float8 *next_value)
+{
+    Datum value;
+    bool isnull;
+    float8 result;
+
+    percentile_state_sort(pgastate);
+
+    if (pgastate->sortstate == NULL)
+    {
+        if (next_value != NULL)
+            *next_value = pgastate->values[row + 1];
+
+        return pgastate->values[row];
+    }
+
+    if (!tuplesort_skiptuples(pgastate->sortstate, row, true) ||
+        !tuplesort_getdatum(pgastate->sortstate, true, &value, &isnull, NULL))
+        elog(ERROR, "missing row in percentile aggregate");
+    result = DatumGetFloat8(value);
+
+    if (next_value != NULL)
+    {
+        if (!tuplesort_getdatum(pgastate->sortstate, true, &value, &isnull,
+                                NULL))
+            elog(ERROR, "missing row in percentile aggregate");
+        *next_value = DatumGetFloat8(value);
+    }
+
+    return result;
+}
+
+/*
+ * Adds the values of one percentile state to another. The values of the
+ * source are read in sorted order if they are in a tuplesort, which freezes
+ * the source.
+ */
+static void percentile_state_merge(FunctionCallInfo fcinfo,
+                                   PercentileGroupAggState *dst,
+                                   PercentileGroupAggState *src)
+{
+    Datum value;
+    bool isnull;
+    int64 i;
+
+    if (src->sortstate == NULL)
+    {
+        for (i = 0; i < src->number_of_rows; i++)
+            percentile_state_append(fcinfo, dst, src->values[i]);
+        return;
+    }
+
+    percentile_state_sort(src);
+    while (tuplesort_getdatum(src->sortstate, true, &value, &isnull, NULL))
+        percentile_state_append(fcinfo, dst, DatumGetFloat8(value));
+}
+
+/*
+ * The state of percentileCont() and percentileDisc(). The values are kept in
+ * an array, which is sorted by the final function. Unlike a tuplesort, the
+ * array can be merged with the one of another partial aggregate. Past
+ * work_mem the values move to a tuplesort, which is read back in order to
+ * merge or serialize the state. That only works because percentile_state_sort()
+ * freezes a tuplesort state for good: once it has been read back, no more
+ * values are added to it, which the READ_WRITE final function relies on.
+ */
+PG_FUNCTION_INFO_V1(gtype_percentile_aggtransfn);
+
+Datum gtype_percentile_aggtransfn(PG_FUNCTION_ARGS)
+{
+    PercentileGroupAggState *pgastate;
+    MemoryContext aggcontext;
+
+    if (!AggCheckCallContext(fcinfo, &aggcontext))
+        elog(ERROR, "percentile_aggtransfn called in non-aggregate context");
+
+    /* if this is the first invocation, create the state */
+    if (PG_ARGISNULL(0))
+        pgastate = make_percentile_state(aggcontext,
+                                         get_percentile_arg(fcinfo, 2));
+    /* otherwise, retrieve the state */
+    else
+        pgastate = (PercentileGroupAggState *) PG_GETARG_POINTER(0);
+
+    /* Add the value, but only if it's not null */
+    if (!PG_ARGISNULL(1))
+    {
+        Datum dfloat = DirectFunctionCall1(gtype_to_float8, PG_GETARG_DATUM(1));
+
+        percentile_state_append(fcinfo, pgastate, DatumGetFloat8(dfloat));
+    }
+    /* return the state */
+    PG_RETURN_POINTER(pgastate);
+}
+
+PG_FUNCTION_INFO_V1(gtype_percentile_aggcombinefn);
+
+Datum gtype_percentile_aggcombinefn(PG_FUNCTION_ARGS)
+{
+    PercentileGroupAggState *state1;
+    PercentileGroupAggState *state2;
+    MemoryContext aggcontext;
+
+    if (!AggCheckCallContext(fcinfo, &aggcontext))
+        elog(ERROR, "percentile_aggcombinefn called in non-aggregate context");
+
+    if (PG_ARGISNULL(1))
+    {
+        if (PG_ARGISNULL(0))
+            PG_RETURN_NULL();
+
+        PG_RETURN_POINTER(PG_GETARG_POINTER(0));
+    }
+
+    state2 = (PercentileGroupAggState *) PG_GETARG_POINTER(1);
+
+    /* the state of the other side may not live in the aggregate context */
+    if (PG_ARGISNULL(0))
+        state1 = make_percentile_state(aggcontext, state2->percentile);
+    else
+        state1 = (PercentileGroupAggState *) PG_GETARG_POINTER(0);
+
+    percentile_state_merge(fcinfo, state1, state2);
+
+    /* a deserialized state has no shutdown callback to end its tuplesort */
+    if (!state2->shutdown_registered)
+        percentile_state_shutdown(PointerGetDatum(state2));
+
+    PG_RETURN_POINTER(state1);
+}
+
+PG_FUNCTION_INFO_V1(gtype_percentile_aggserialfn);
+
+Datum gtype_percentile_aggserialfn(PG_FUNCTION_ARGS)
+{
+    PercentileGroupAggState *pgastate;
+    StringInfoData buf;
+    int64 i;
+
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "percentile_aggserialfn called in non-aggregate context");
+
+    pgastate = (PercentileGroupAggState *) PG_GETARG_POINTER(0);
+
+    pq_begintypsend(&buf);
+
+    pq_sendfloat8(&buf, pgastate->percentile);
+    pq_sendint64(&buf, pgastate->number_of_rows);
+    if (pgastate->sortstate != NULL)
+    {
+        Datum value;
+        bool isnull;
+
+        percentile_state_sort(pgastate);
+        while (tuplesort_getdatum(pgastate->sortstate, true, &value, &isnull,
+                                  NULL))
+            pq_sendfloat8(&buf, DatumGetFloat8(value));
+    }
+    else
+    {
+        for (i = 0; i < pgastate->number_of_rows; i++)
+            pq_sendfloat8(&buf, pgastate->values[i]);
+    }
+
+    PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+PG_FUNCTION_INFO_V1(gtype_percentile_aggdeserialfn);
+
+Datum gtype_percentile_aggdeserialfn(PG_FUNCTION_ARGS)
+{
+    bytea *sstate;
+    PercentileGroupAggState *pgastate;
+    StringInfoData buf;
+    float8 percentile;
+    int64 number_of_rows;
+    int64 i;
+
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "percentile_aggdeserialfn called in non-aggregate context");
+
+    sstate = PG_GETARG_BYTEA_PP(0);
+
+    initStringInfo(&buf);
+    appendBinaryStringInfo(&buf, VARDATA_ANY(sstate),
+                           VARSIZE_ANY_EXHDR(sstate));
+
+    percentile = pq_getmsgfloat8(&buf);
+    number_of_rows = pq_getmsgint64(&buf);
+
+    /*
+     * The values go through work_mem like the ones of the transition. The
+     * state does not live in the aggregate context, so its tuplesort is not
+     * registered for shutdown; the combine function ends it.
+     */
+    pgastate = make_percentile_state(CurrentMemoryContext, percentile);
+    for (i = 0; i < number_of_rows; i++)
+        percentile_state_append(NULL, pgastate, pq_getmsgfloat8(&buf));
+
+    pq_getmsgend(&buf);
+
+    PG_RETURN_POINTER(pgastate);
+}
+
+/* Code borrowed and adjusted from PG's percentile_cont_final function */
+PG_FUNCTION_INFO_V1(gtype_percentile_cont_aggfinalfn);
+
+Datum gtype_percentile_cont_aggfinalfn(PG_FUNCTION_ARGS)
+{
+    PercentileGroupAggState *pgastate;
+    float8 percentile;
+    int64 first_row = 0;
+    int64 second_row = 0;
+    Datum val;
+    double proportion;
+    gtype_value agtv_float;
+
+    /* verify we are in an aggregate context */
+    Assert(AggCheckCallContext(fcinfo, NULL) == AGG_CONTEXT_AGGREGATE);
+
+    /* If there were no regular rows, the result is NULL */
+    if (PG_ARGISNULL(0))
+        PG_RETURN_NULL();
+
+    /* retrieve the state and percentile */
+    pgastate = (PercentileGroupAggState *) PG_GETARG_POINTER(0);
+    percentile = pgastate->percentile;
+
+    /* number_of_rows could be zero if we only saw NULL input values */
+    if (pgastate->number_of_rows == 0)
+        PG_RETURN_NULL();
+
+    /* calculate the percentile cont*/
+    first_row = floor(percentile * (pgastate->number_of_rows - 1));
+    second_row = ceil(percentile * (pgastate->number_of_rows - 1));
+
+    Assert(first_row < pgastate->number_of_rows);
+
+    if (first_row == second_row)
+    {
+        val = Float8GetDatum(percentile_state_get(pgastate, first_row, NULL));
+    }
+    else
+    {
+        float8 first_val;
+        float8 second_val;
+
+        first_val = percentile_state_get(pgastate, first_row, &second_val);
+        proportion = (percentile * (pgastate->number_of_rows - 1)) - first_row;
+        val = float8_lerp(Float8GetDatum(first_val),
+                          Float8GetDatum(second_val), proportion);
+    }
+
+    /* convert to an gtype float and return the result */
+    agtv_float.type = AGTV_FLOAT;
+    agtv_float.val.float_value = DatumGetFloat8(val);
+
+    PG_RETURN_POINTER(gtype_value_to_gtype(&agtv_float));
+}
+
+/* Code borrowed and adjusted from PG's percentile_disc_final function */
+PG_FUNCTION_INFO_V1(gtype_percentile_disc_aggfinalfn);
+
+Datum gtype_percentile_disc_aggfinalfn(PG_FUNCTION_ARGS)
+{
+    PercentileGroupAggState *pgastate;
+    double percentile;
+    int64 rownum;
+    gtype_value agtv_float;
+
+    Assert(AggCheckCallContext(fcinfo, NULL) == AGG_CONTEXT_AGGREGATE);
+
+    /* If there were no regular rows, the result is NULL */
+    if (PG_ARGISNULL(0))
+        PG_RETURN_NULL();
+
+    pgastate = (PercentileGroupAggState *) PG_GETARG_POINTER(0);
+    percentile = pgastate->percentile;
+
+    /* number_of_rows could be zero if we only saw NULL input values */
+    if (pgastate->number_of_rows == 0)
+        PG_RETURN_NULL();
+
+    /*----------
+     * We need the smallest K such that (K/N) >= percentile.
+     * N>0, therefore K >= N*percentile, therefore K = ceil(N*percentile).
+     * So we skip K-1 rows (if K>0) and return the next row.
+     *----------
+     */
+    rownum = (int64) ceil(percentile * pgastate->number_of_rows);
+    Assert(rownum <= pgastate->number_of_rows);
+
+    /* convert to an gtype float and return the result */
+    agtv_float.type = AGTV_FLOAT;
+    agtv_float.val.float_value = percentile_state_get(
+        pgastate, rownum > 1 ? rownum - 1 : 0, NULL);
+
+    PG_RETURN_POINTER(gtype_value_to_gtype(&agtv_float));
+}
+
+/* functions to support the aggregate function percentileApprox() */
+static PercentileApproxAggState *make_percentile_approx_state(
+    MemoryContext aggcontext, float8 percentile)
+{
+    PercentileApproxAggState *state;
+
+    state = MemoryContextAllocZero(aggcontext,
+                                   sizeof(PercentileApproxAggState));
+    state->percentile = percentile;
+
+    return state;
+}
+
+static void percentile_approx_insert(PercentileApproxAggState *state,
+                                     MemoryContext aggcontext, int level,
+                                     float8 value);
+
+/* sorts a full level and moves every other value of it up a level */
+static void percentile_approx_compact(PercentileApproxAggState *state,
+                                      MemoryContext aggcontext, int level)
+{
+    float8 *values = state->levels[level];
+    int i;
+
+    qsort(values, PERCENTILE_APPROX_LEVEL_SIZE, sizeof(float8),
+          percentile_float8_cmp);
+
+    for (i = state->compaction_offset ? 1 : 0;
+         i < PERCENTILE_APPROX_LEVEL_SIZE; i += 2)
+        percentile_approx_insert(state, aggcontext, level + 1, values[i]);
+
+    state->level_counts[level] = 0;
+    state->compaction_offset = !state->compaction_offset;
+}
+
+static void percentile_approx_insert(PercentileApproxAggState *state,
+                                     MemoryContext aggcontext, int level,
+                                     float8 value)
+{
+    if (level >= PERCENTILE_APPROX_MAX_LEVELS)
+        elog(ERROR, "percentileApprox() sketch is out of levels");
+
+    while (state->num_levels <= level)
+    {
+        state->levels[state->num_levels] = MemoryContextAlloc(
+            aggcontext, PERCENTILE_APPROX_LEVEL_SIZE * sizeof(float8));
+        state->level_counts[state->num_levels] = 0;
+        state->num_levels++;
+    }
+
+    state->levels[level][state->level_counts[level]++] = value;
+
+    if (state->level_counts[level] == PERCENTILE_APPROX_LEVEL_SIZE)
+        percentile_approx_compact(state, aggcontext, level);
+}
+
+PG_FUNCTION_INFO_V1(gtype_percentile_approx_aggtransfn);
+
+Datum gtype_percentile_approx_aggtransfn(PG_FUNCTION_ARGS)
+{
+    PercentileApproxAggState *state;
+    MemoryContext aggcontext;
+
+    if (!AggCheckCallContext(fcinfo, &aggcontext))
+        elog(ERROR, "percentile_approx_aggtransfn called in non-aggregate context");
+
+    if (PG_ARGISNULL(0))
+        state = make_percentile_approx_state(aggcontext,
+                                             get_percentile_arg(fcinfo, 2));
+    else
+        state = (PercentileApproxAggState *) PG_GETARG_POINTER(0);
+
+    if (!PG_ARGISNULL(1))
+    {
+        Datum dfloat = DirectFunctionCall1(gtype_to_float8, PG_GETARG_DATUM(1));
+
+        percentile_approx_insert(state, aggcontext, 0, DatumGetFloat8(dfloat));
+        state->number_of_rows++;
+    }
+
+    PG_RETURN_POINTER(state);
+}
+
+PG_FUNCTION_INFO_V1(gtype_percentile_approx_aggcombinefn);
+
+Datum gtype_percentile_approx_aggcombinefn(PG_FUNCTION_ARGS)
+{
+    PercentileApproxAggState *state1;
+    PercentileApproxAggState *state2;
+    MemoryContext aggcontext;
+    int level;
+    int i;
+
+    if (!AggCheckCallContext(fcinfo, &aggcontext))
+        elog(ERROR, "percentile_approx_aggcombinefn called in non-aggregate context");
+
+    if (PG_ARGISNULL(1))
+    {
+        if (PG_ARGISNULL(0))
             PG_RETURN_NULL();
 
-        proportion = (percentile * (pgastate->number_of_rows - 1)) - first_row;
-        val = float8_lerp(first_val, second_val, proportion);
+        PG_RETURN_POINTER(PG_GETARG_POINTER(0));
     }
 
-    /* convert to an gtype float and return the result */
-    agtv_float.type = AGTV_FLOAT;
-    agtv_float.val.float_value = DatumGetFloat8(val);
+    state2 = (PercentileApproxAggState *) PG_GETARG_POINTER(1);
 
-    PG_RETURN_POINTER(gtype_value_to_gtype(&agtv_float));
+    if (PG_ARGISNULL(0))
+        state1 = make_percentile_approx_state(aggcontext, state2->percentile);
+    else
+        state1 = (PercentileApproxAggState *) PG_GETARG_POINTER(0);
+
+    /* a value keeps its weight, so it goes to the same level */
+    for (level = 0; level < state2->num_levels; level++)
+    {
+        for (i = 0; i < state2->level_counts[level]; i++)
+            percentile_approx_insert(state1, aggcontext, level,
+                                     state2->levels[level][i]);
+    }
+    state1->number_of_rows += state2->number_of_rows;
+
+    PG_RETURN_POINTER(state1);
 }
 
-/* Code borrowed and adjusted from PG's percentile_disc_final function */
-PG_FUNCTION_INFO_V1(gtype_percentile_disc_aggfinalfn);
+PG_FUNCTION_INFO_V1(gtype_percentile_approx_aggserialfn);
 
-Datum gtype_percentile_disc_aggfinalfn(PG_FUNCTION_ARGS)
+Datum gtype_percentile_approx_aggserialfn(PG_FUNCTION_ARGS)
 {
-    PercentileGroupAggState *pgastate;
-    double percentile;
-    Datum val;
-    bool isnull;
-    int64 rownum;
+    PercentileApproxAggState *state;
+    StringInfoData buf;
+    int level;
+    int i;
+
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "percentile_approx_aggserialfn called in non-aggregate context");
+
+    state = (PercentileApproxAggState *) PG_GETARG_POINTER(0);
+
+    pq_begintypsend(&buf);
+
+    pq_sendfloat8(&buf, state->percentile);
+    pq_sendint64(&buf, state->number_of_rows);
+    pq_sendbyte(&buf, state->compaction_offset);
+    pq_sendint32(&buf, state->num_levels);
+    for (level = 0; level < state->num_levels; level++)
+    {
+        pq_sendint32(&buf, state->level_counts[level]);
+        for (i = 0; i < state->level_counts[level]; i++)
+            pq_sendfloat8(&buf, state->levels[level][i]);
+    }
+
+    PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+PG_FUNCTION_INFO_V1(gtype_percentile_approx_aggdeserialfn);
+
+Datum gtype_percentile_approx_aggdeserialfn(PG_FUNCTION_ARGS)
+{
+    bytea *sstate;
+    PercentileApproxAggState *state;
+    StringInfoData buf;
+    int level;
+    int i;
+
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "percentile_approx_aggdeserialfn called in non-aggregate context");
+
+    sstate = PG_GETARG_BYTEA_PP(0);
+
+    initStringInfo(&buf);
+    appendBinaryStringInfo(&buf, VARDATA_ANY(sstate),
+                           VARSIZE_ANY_EXHDR(sstate));
+
+    state = make_percentile_approx_state(CurrentMemoryContext,
+                                         pq_getmsgfloat8(&buf));
+    state->number_of_rows = pq_getmsgint64(&buf);
+    state->compaction_offset = pq_getmsgbyte(&buf);
+    state->num_levels = pq_getmsgint(&buf, 4);
+
+    if (state->num_levels < 0 ||
+        state->num_levels > PERCENTILE_APPROX_MAX_LEVELS)
+        elog(ERROR, "invalid percentileApprox() sketch");
+
+    for (level = 0; level < state->num_levels; level++)
+    {
+        state->level_counts[level] = pq_getmsgint(&buf, 4);
+        if (state->level_counts[level] < 0 ||
+            state->level_counts[level] >= PERCENTILE_APPROX_LEVEL_SIZE)
+            elog(ERROR, "invalid percentileApprox() sketch");
+
+        state->levels[level] = palloc(PERCENTILE_APPROX_LEVEL_SIZE *
+                                      sizeof(float8));
+        for (i = 0; i < state->level_counts[level]; i++)
+            state->levels[level][i] = pq_getmsgfloat8(&buf);
+    }
+
+    pq_getmsgend(&buf);
+
+    PG_RETURN_POINTER(state);
+}
+
+typedef struct weighted_value
+{
+    float8 value;
+    int64 weight;
+} weighted_value;
+
+static int weighted_value_cmp(const void *a, const void *b)
+{
+    return float8_cmp_internal(((const weighted_value *)a)->value,
+                               ((const weighted_value *)b)->value);
+}
+
+/*
+ * Returns the smallest value of the sketch whose rank reaches the percentile,
+ * the way percentileDisc() does. While fewer rows than a level holds have
+ * been seen, this is exactly the result of percentileDisc().
+ */
+PG_FUNCTION_INFO_V1(gtype_percentile_approx_aggfinalfn);
+
+Datum gtype_percentile_approx_aggfinalfn(PG_FUNCTION_ARGS)
+{
+    PercentileApproxAggState *state;
+    weighted_value *values;
+    int num_values = 0;
+    int64 target;
+    int64 rank = 0;
+    int level;
+    int i;
     gtype_value agtv_float;
 
     Assert(AggCheckCallContext(fcinfo, NULL) == AGG_CONTEXT_AGGREGATE);
 
-    /* If there were no regular rows, the result is NULL */
     if (PG_ARGISNULL(0))
         PG_RETURN_NULL();
 
-    pgastate = (PercentileGroupAggState *) PG_GETARG_POINTER(0);
-    percentile = pgastate->percentile;
+    state = (PercentileApproxAggState *) PG_GETARG_POINTER(0);
 
-    /* number_of_rows could be zero if we only saw NULL input values */
-    if (pgastate->number_of_rows == 0)
+    if (state->number_of_rows == 0)
         PG_RETURN_NULL();
 
-    /* Finish the sort, or rescan if we already did */
-    if (!pgastate->sort_done)
+    values = palloc(state->num_levels * PERCENTILE_APPROX_LEVEL_SIZE *
+                    sizeof(weighted_value));
+    for (level = 0; level < state->num_levels; level++)
     {
-        tuplesort_performsort(pgastate->sortstate);
-        pgastate->sort_done = true;
+        for (i = 0; i < state->level_counts[level]; i++)
+        {
+            values[num_values].value = state->levels[level][i];
+            values[num_values].weight = INT64CONST(1) << level;
+            num_values++;
+        }
+    }
+
+    qsort(values, num_values, sizeof(weighted_value), weighted_value_cmp);
+
+    /* compaction keeps the total weight equal to the number of rows */
+    target = (int64) ceil(state->percentile * state->number_of_rows);
+    if (target < 1)
+        target = 1;
+
+    for (i = 0; i < num_values - 1; i++)
+    {
+        rank += values[i].weight;
+        if (rank >= target)
+            break;
+    }
+
+    agtv_float.type = AGTV_FLOAT;
+    agtv_float.val.float_value = values[i].value;
+
+    PG_RETURN_POINTER(gtype_value_to_gtype(&agtv_float));
+}
+
+/*
+ * functions to support the aggregate function approx_count_distinct()
+ *
+ * The values are counted with PG's HyperLogLog. It has no merge function
+ * of its own, so the combine function takes the larger of each register.
+ */
+#define APPROX_COUNT_DISTINCT_BWIDTH 14
+
+/* hashes a gtype the way gtype_hash_cmp() does, but to 32 bits */
+static uint32 gtype_hash_value(gtype *agt)
+{
+    uint32 hash = 0;
+    gtype_iterator *it;
+    gtype_iterator_token tok;
+    gtype_value r;
+    int depth = 0;
+
+    it = gtype_iterator_init(&agt->root);
+    while ((tok = gtype_iterator_next(&it, &r, false)) != WAGT_DONE)
+    {
+        if (IS_A_GTYPE_SCALAR(&r) && GTYPE_ITERATOR_TOKEN_IS_HASHABLE(tok))
+            gtype_hash_scalar_value(&r, &hash);
+        else if ((tok == WAGT_BEGIN_ARRAY && !r.val.array.raw_scalar) ||
+                 tok == WAGT_BEGIN_OBJECT)
+            hash ^= ++depth;
+        else if ((tok == WAGT_END_ARRAY && !r.val.array.raw_scalar) ||
+                 tok == WAGT_END_OBJECT)
+            hash ^= depth--;
     }
+
+    /* the rotations leave the bits of composites poorly mixed */
+    return murmurhash32(hash);
+}
+
+static hyperLogLogState *make_approx_count_distinct_state(MemoryContext mcxt)
+{
+    MemoryContext old_mcxt = MemoryContextSwitchTo(mcxt);
+    hyperLogLogState *state = palloc(sizeof(hyperLogLogState));
+
+    initHyperLogLog(state, APPROX_COUNT_DISTINCT_BWIDTH);
+
+    MemoryContextSwitchTo(old_mcxt);
+
+    return state;
+}
+
+PG_FUNCTION_INFO_V1(gtype_approx_count_distinct_aggtransfn);
+
+Datum gtype_approx_count_distinct_aggtransfn(PG_FUNCTION_ARGS)
+{
+    hyperLogLogState *state;
+    MemoryContext aggcontext;
+
+    if (!AggCheckCallContext(fcinfo, &aggcontext))
+        elog(ERROR, "approx_count_distinct_aggtransfn called in non-aggregate context");
+
+    if (PG_ARGISNULL(0))
+        state = make_approx_count_distinct_state(aggcontext);
     else
-        tuplesort_rescan(pgastate->sortstate);
+        state = (hyperLogLogState *) PG_GETARG_POINTER(0);
 
-    /*----------
-     * We need the smallest K such that (K/N) >= percentile.
-     * N>0, therefore K >= N*percentile, therefore K = ceil(N*percentile).
-     * So we skip K-1 rows (if K>0) and return the next row fetched.
-     *----------
-     */
-    rownum = (int64) ceil(percentile * pgastate->number_of_rows);
-    Assert(rownum <= pgastate->number_of_rows);
+    /* like count(DISTINCT), skip NULL and gtype null values */
+    if (!PG_ARGISNULL(1))
+    {
+        gtype *agt = AG_GET_ARG_GTYPE_P(1);
+
+        if (!is_gtype_null(agt))
+            addHyperLogLog(state, gtype_hash_value(agt));
+    }
+
+    PG_RETURN_POINTER(state);
+}
+
+PG_FUNCTION_INFO_V1(gtype_approx_count_distinct_aggcombinefn);
+
+Datum gtype_approx_count_distinct_aggcombinefn(PG_FUNCTION_ARGS)
+{
+    hyperLogLogState *state1;
+    hyperLogLogState *state2;
+    MemoryContext aggcontext;
+    Size i;
+
+    if (!AggCheckCallContext(fcinfo, &aggcontext))
+        elog(ERROR, "approx_count_distinct_aggcombinefn called in non-aggregate context");
+
+    if (PG_ARGISNULL(0))
+        state1 = make_approx_count_distinct_state(aggcontext);
+    else
+        state1 = (hyperLogLogState *) PG_GETARG_POINTER(0);
+
+    if (PG_ARGISNULL(1))
+        PG_RETURN_POINTER(state1);
+
+    state2 = (hyperLogLogState *) PG_GETARG_POINTER(1);
+
+    for (i = 0; i < state1->nRegisters; i++)
+        state1->hashesArr[i] = Max(state1->hashesArr[i], state2->hashesArr[i]);
+
+    PG_RETURN_POINTER(state1);
+}
+
+PG_FUNCTION_INFO_V1(gtype_approx_count_distinct_aggserialfn);
+
+Datum gtype_approx_count_distinct_aggserialfn(PG_FUNCTION_ARGS)
+{
+    hyperLogLogState *state;
+    bytea *result;
+
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "approx_count_distinct_aggserialfn called in non-aggregate context");
+
+    state = (hyperLogLogState *) PG_GETARG_POINTER(0);
+
+    /* the registers are single bytes, so they are sent as they are */
+    result = palloc(VARHDRSZ + state->nRegisters);
+    SET_VARSIZE(result, VARHDRSZ + state->nRegisters);
+    memcpy(VARDATA(result), state->hashesArr, state->nRegisters);
+
+    PG_RETURN_BYTEA_P(result);
+}
+
+PG_FUNCTION_INFO_V1(gtype_approx_count_distinct_aggdeserialfn);
+
+Datum gtype_approx_count_distinct_aggdeserialfn(PG_FUNCTION_ARGS)
+{
+    bytea *sstate;
+    hyperLogLogState *state;
+
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "approx_count_distinct_aggdeserialfn called in non-aggregate context");
+
+    sstate = PG_GETARG_BYTEA_PP(0);
+    state = make_approx_count_distinct_state(CurrentMemoryContext);
+
+    if (VARSIZE_ANY_EXHDR(sstate) != state->nRegisters)
+        elog(ERROR, "invalid approx_count_distinct() state");
+
+    memcpy(state->hashesArr, VARDATA_ANY(sstate), state->nRegisters);
+
+    PG_RETURN_POINTER(state);
+}
+
+PG_FUNCTION_INFO_V1(gtype_approx_count_distinct_aggfinalfn);
+
+Datum gtype_approx_count_distinct_aggfinalfn(PG_FUNCTION_ARGS)
+{
+    gtype_value agtv_result;
 
-    if (rownum > 1)
+    agtv_result.type = AGTV_INTEGER;
+    agtv_result.val.int_value = 0;
+
+    if (!PG_ARGISNULL(0))
+    {
+        hyperLogLogState *state = (hyperLogLogState *) PG_GETARG_POINTER(0);
+
+        agtv_result.val.int_value = (int64) rint(estimateHyperLogLog(state));
+    }
+
+    PG_RETURN_POINTER(gtype_value_to_gtype(&agtv_result));
+}
+
+/*
+ * functions to support the aggregate function COLLECT()
+ *
+ * The state keeps a copy of every collected value in the aggregate memory
+ * context and the array is only built by the final function. This keeps the
+ * state combinable and serializable, so collect() can run as a partial
+ * aggregate in parallel workers, and its memory is accounted for by hash
+ * aggregation.
+ */
+typedef struct collect_agg_state
+{
+    int num_elems;
+    int max_elems;
+    gtype **elems;
+} collect_agg_state;
+
+static collect_agg_state *make_collect_agg_state(MemoryContext aggcontext)
+{
+    collect_agg_state *state;
+
+    state = MemoryContextAlloc(aggcontext, sizeof(collect_agg_state));
+    state->num_elems = 0;
+    state->max_elems = 8;
+    state->elems = MemoryContextAlloc(aggcontext,
+                                      state->max_elems * sizeof(gtype *));
+
+    return state;
+}
+
+// appends a copy of the value, made in the aggregate memory context
+static void collect_agg_state_append(collect_agg_state *state,
+                                     MemoryContext aggcontext, gtype *agt)
+{
+    gtype *copy;
+
+    if (state->num_elems == state->max_elems)
+    {
+        state->max_elems *= 2;
+        state->elems = repalloc(state->elems,
+                                state->max_elems * sizeof(gtype *));
+    }
+
+    copy = MemoryContextAlloc(aggcontext, VARSIZE(agt));
+    memcpy(copy, agt, VARSIZE(agt));
+
+    state->elems[state->num_elems++] = copy;
+}
+
+PG_FUNCTION_INFO_V1(gtype_collect_aggtransfn);
+
+Datum gtype_collect_aggtransfn(PG_FUNCTION_ARGS)
+{
+    collect_agg_state *state;
+    MemoryContext aggcontext;
+
+    if (!AggCheckCallContext(fcinfo, &aggcontext))
+        elog(ERROR, "collect_aggtransfn called in non-aggregate context");
+
+    /* if this is the first invocation, create the state */
+    if (PG_ARGISNULL(0))
+        state = make_collect_agg_state(aggcontext);
+    else
+        state = (collect_agg_state *) PG_GETARG_POINTER(0);
+
+    /* nulls and gtype nulls are skipped over */
+    if (!PG_ARGISNULL(1))
+    {
+        gtype *agt_arg = AG_GET_ARG_GTYPE_P(1);
+
+        if (!is_gtype_null(agt_arg))
+            collect_agg_state_append(state, aggcontext, agt_arg);
+    }
+
+    PG_RETURN_POINTER(state);
+}
+
+PG_FUNCTION_INFO_V1(gtype_collect_aggcombinefn);
+
+Datum gtype_collect_aggcombinefn(PG_FUNCTION_ARGS)
+{
+    collect_agg_state *state1;
+    collect_agg_state *state2;
+    MemoryContext aggcontext;
+    int i;
+
+    if (!AggCheckCallContext(fcinfo, &aggcontext))
+        elog(ERROR, "collect_aggcombinefn called in non-aggregate context");
+
+    if (PG_ARGISNULL(1))
     {
-        if (!tuplesort_skiptuples(pgastate->sortstate, rownum - 1, true))
-            elog(ERROR, "missing row in percentile_disc");
+        if (PG_ARGISNULL(0))
+            PG_RETURN_NULL();
+
+        PG_RETURN_POINTER(PG_GETARG_POINTER(0));
     }
 
-    if (!tuplesort_getdatum(pgastate->sortstate, true, &val, &isnull, NULL))
-        elog(ERROR, "missing row in percentile_disc");
+    /* the state of the other side may not live in the aggregate context */
+    if (PG_ARGISNULL(0))
+        state1 = make_collect_agg_state(aggcontext);
+    else
+        state1 = (collect_agg_state *) PG_GETARG_POINTER(0);
+
+    state2 = (collect_agg_state *) PG_GETARG_POINTER(1);
+
+    for (i = 0; i < state2->num_elems; i++)
+        collect_agg_state_append(state1, aggcontext, state2->elems[i]);
+
+    PG_RETURN_POINTER(state1);
+}
+
+PG_FUNCTION_INFO_V1(gtype_collect_aggserialfn);
+
+Datum gtype_collect_aggserialfn(PG_FUNCTION_ARGS)
+{
+    collect_agg_state *state;
+    StringInfoData buf;
+    int i;
+
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "collect_aggserialfn called in non-aggregate context");
 
-    /* We shouldn't have stored any nulls, but do the right thing anyway */
-    if (isnull)
-        PG_RETURN_NULL();
+    state = (collect_agg_state *) PG_GETARG_POINTER(0);
 
-    /* convert to an gtype float and return the result */
-    agtv_float.type = AGTV_FLOAT;
-    agtv_float.val.float_value = DatumGetFloat8(val);
+    pq_begintypsend(&buf);
 
-    PG_RETURN_POINTER(gtype_value_to_gtype(&agtv_float));
+    pq_sendint32(&buf, state->num_elems);
+    for (i = 0; i < state->num_elems; i++)
+    {
+        pq_sendint32(&buf, VARSIZE(state->elems[i]));
+        pq_sendbytes(&buf, (char *)state->elems[i], VARSIZE(state->elems[i]));
+    }
+
+    PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
 }
 
-/* functions to support the aggregate function COLLECT() */
-PG_FUNCTION_INFO_V1(gtype_collect_aggtransfn);
+PG_FUNCTION_INFO_V1(gtype_collect_aggdeserialfn);
 
-Datum gtype_collect_aggtransfn(PG_FUNCTION_ARGS)
+Datum gtype_collect_aggdeserialfn(PG_FUNCTION_ARGS)
 {
-    gtype_in_state *castate;
-    int nargs;
-    Datum *args;
-    bool *nulls;
-    Oid *types;
-    MemoryContext old_mcxt;
+    bytea *sstate;
+    collect_agg_state *state;
+    StringInfoData buf;
+    int num_elems;
+    int i;
 
-    /* verify we are in an aggregate context */
-    Assert(AggCheckCallContext(fcinfo, NULL) == AGG_CONTEXT_AGGREGATE);
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "collect_aggdeserialfn called in non-aggregate context");
 
-    /*
-     * Switch to the correct aggregate context. Otherwise, the data added to the
-     * array will be lost.
-     */
-    old_mcxt = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
+    sstate = PG_GETARG_BYTEA_PP(0);
 
-    /* if this is the first invocation, create the state */
-    if (PG_ARGISNULL(0)) {
-        castate = palloc0(sizeof(gtype_in_state));
-        memset(castate, 0, sizeof(gtype_in_state));
+    initStringInfo(&buf);
+    appendBinaryStringInfo(&buf, VARDATA_ANY(sstate),
+                           VARSIZE_ANY_EXHDR(sstate));
 
-        castate->res = push_gtype_value(&castate->parse_state, WAGT_BEGIN_ARRAY, NULL);
-    } else {
-        castate = (gtype_in_state *) PG_GETARG_POINTER(0);
-    }
+    num_elems = pq_getmsgint(&buf, 4);
 
-    /*
-     * Extract the variadic args, of which there should only be one.
-     * Insert the arg into the array, unless it is null. Nulls are
-     * skipped over.
-     */
-    if (PG_ARGISNULL(1))
-        nargs = 0;
-    else
-        nargs = extract_variadic_args(fcinfo, 1, true, &args, &types, &nulls);
-
-    if (nargs == 1) {
-        /* only add non null values */
-        if (nulls[0] == false) {
-            /* we need to check for gtype null and skip it, if found */
-            if (types[0] == GTYPEOID) {
-                gtype *agt_arg;
-                gtype_value *agtv_value;
-
-                /* get the gtype argument */
-                agt_arg = DATUM_GET_GTYPE_P(args[0]);
-                agtv_value = get_ith_gtype_value_from_container(&agt_arg->root, 0);
-                /* add the arg if not gtype null */
-                if (agtv_value->type != AGTV_NULL)
-                    add_gtype(args[0], nulls[0], castate, types[0], false);
-            } else {
-                add_gtype(args[0], nulls[0], castate, types[0], false);
-            }
-        }
-    } else if (nargs > 1) {
-        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                        errmsg("collect() invalid number of arguments")));
+    state = palloc(sizeof(collect_agg_state));
+    state->num_elems = num_elems;
+    state->max_elems = Max(num_elems, 1);
+    state->elems = palloc(state->max_elems * sizeof(gtype *));
+
+    /* copy the values out of the buffer, where they are not aligned */
+    for (i = 0; i < num_elems; i++)
+    {
+        int len = pq_getmsgint(&buf, 4);
+
+        state->elems[i] = palloc(len);
+        memcpy(state->elems[i], pq_getmsgbytes(&buf, len), len);
     }
 
-    /* restore the old context */
-    MemoryContextSwitchTo(old_mcxt);
+    pq_getmsgend(&buf);
 
-    /* return the state */
-    PG_RETURN_POINTER(castate);
+    PG_RETURN_POINTER(state);
 }
 
 PG_FUNCTION_INFO_V1(gtype_collect_aggfinalfn);
 
 Datum gtype_collect_aggfinalfn(PG_FUNCTION_ARGS) {
-    gtype_in_state *castate;
-    MemoryContext old_mcxt;
+    collect_agg_state *state;
+    gtype_in_state result;
+    int i;
 
     /* verify we are in an aggregate context */
     Assert(AggCheckCallContext(fcinfo, NULL) == AGG_CONTEXT_AGGREGATE);
 
+    memset(&result, 0, sizeof(gtype_in_state));
+
+    result.res = push_gtype_value(&result.parse_state, WAGT_BEGIN_ARRAY, NULL);
+
     /*
-     * Get the state. There are cases where the age_collect_aggtransfn never
-     * gets called. So, check to see if this is one.
+     * There are cases where the transition function never gets called and
+     * the state is NULL. The result is then an empty array.
      */
-    if (PG_ARGISNULL(0)) {
-        /* create and initialize the state */
-        castate = palloc0(sizeof(gtype_in_state));
-        memset(castate, 0, sizeof(gtype_in_state));
-        /* start the array */
-        castate->res = push_gtype_value(&castate->parse_state, WAGT_BEGIN_ARRAY, NULL);
-    } else {
-        castate = (gtype_in_state *) PG_GETARG_POINTER(0);
-    }
-
-    old_mcxt = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
+    if (!PG_ARGISNULL(0))
+    {
+        state = (collect_agg_state *) PG_GETARG_POINTER(0);
 
-    castate->res = push_gtype_value(&castate->parse_state, WAGT_END_ARRAY, NULL);
+        for (i = 0; i < state->num_elems; i++)
+            add_gtype(GTYPE_P_GET_DATUM(state->elems[i]), false, &result,
+                      GTYPEOID, false);
+    }
 
-    MemoryContextSwitchTo(old_mcxt);
+    result.res = push_gtype_value(&result.parse_state, WAGT_END_ARRAY, NULL);
 
-    PG_RETURN_POINTER(gtype_value_to_gtype(castate->res));
+    PG_RETURN_POINTER(gtype_value_to_gtype(result.res));
 }
 
 /*
@@ -4725,6 +5933,157 @@ gtype_value *get_gtype_value(char *funcname, gtype *agt_arg,
     return agtv_value;
 }
 
+/*
+ * Per-query state of =~, kept in fn_extra: the last pattern and either its
+ * literal prefix, when the pattern is just an anchored literal, or its
+ * compiled regex. Compiling the pattern goes through the same regex engine
+ * and flags as textregexeq, with the C collation.
+ */
+typedef struct regex_cache
+{
+    char *pattern;
+    int pattern_len;
+    /* length of the literal prefix, or -1 if the regex must be run */
+    int prefix_len;
+    bool compiled;
+    regex_t re;
+} regex_cache;
+
+static void free_regex_cache(void *arg)
+{
+    regex_cache *cache = (regex_cache *)arg;
+
+    if (cache->compiled)
+        pg_regfree(&cache->re);
+}
+
+/*
+ * Returns the length of the literal prefix of patterns like '^abc' and
+ * '^abc.*', which match exactly the strings starting with 'abc', or -1 for
+ * any other pattern.
+ */
+static int get_regex_literal_prefix(const char *pattern, int len)
+{
+    int i;
+
+    if (len == 0 || pattern[0] != '^')
+        return -1;
+
+    for (i = 1; i < len; i++)
+    {
+        if (strchr(".[]()*+?{}|^$\\", pattern[i]) != NULL)
+            break;
+    }
+
+    /* what follows the literal must not constrain the match */
+    if (i == len || (len - i == 2 && strncmp(pattern + i, ".*", 2) == 0) ||
+        (len - i == 3 && strncmp(pattern + i, ".*$", 3) == 0))
+        return i - 1;
+
+    return -1;
+}
+
+static regex_cache *get_regex_cache(FunctionCallInfo fcinfo, char *pattern,
+                                    int len)
+{
+    regex_cache *cache = (regex_cache *)fcinfo->flinfo->fn_extra;
+    pg_wchar *wpattern;
+    int wlen;
+    int regcomp_result;
+
+    if (cache == NULL)
+    {
+        MemoryContextCallback *cb;
+
+        cache = MemoryContextAllocZero(fcinfo->flinfo->fn_mcxt,
+                                       sizeof(regex_cache));
+
+        /* the compiled regex is malloc'd, so free it with the cache */
+        cb = MemoryContextAlloc(fcinfo->flinfo->fn_mcxt,
+                                sizeof(MemoryContextCallback));
+        cb->func = free_regex_cache;
+        cb->arg = cache;
+        MemoryContextRegisterResetCallback(fcinfo->flinfo->fn_mcxt, cb);
+
+        fcinfo->flinfo->fn_extra = cache;
+    }
+    else if (cache->pattern_len == len &&
+             memcmp(cache->pattern, pattern, len) == 0)
+    {
+        return cache;
+    }
+
+    if (cache->compiled)
+    {
+        pg_regfree(&cache->re);
+        cache->compiled = false;
+    }
+    if (cache->pattern != NULL)
+        pfree(cache->pattern);
+
+    cache->pattern = MemoryContextAlloc(fcinfo->flinfo->fn_mcxt, len + 1);
+    memcpy(cache->pattern, pattern, len);
+    cache->pattern_len = len;
+
+    cache->prefix_len = get_regex_literal_prefix(pattern, len);
+    if (cache->prefix_len >= 0)
+        return cache;
+
+    wpattern = palloc((len + 1) * sizeof(pg_wchar));
+    wlen = pg_mb2wchar_with_len(pattern, wpattern, len);
+
+    regcomp_result = pg_regcomp(&cache->re, wpattern, wlen, REG_ADVANCED,
+                                C_COLLATION_OID);
+    pfree(wpattern);
+
+    if (regcomp_result != REG_OKAY)
+    {
+        char errMsg[100];
+
+        /* forget the pattern, it was not compiled */
+        cache->pattern_len = -1;
+
+        CHECK_FOR_INTERRUPTS();
+        pg_regerror(regcomp_result, &cache->re, errMsg, sizeof(errMsg));
+        ereport(ERROR, (errcode(ERRCODE_INVALID_REGULAR_EXPRESSION),
+                        errmsg("invalid regular expression: %s", errMsg)));
+    }
+    cache->compiled = true;
+
+    return cache;
+}
+
+static bool regex_cache_match(regex_cache *cache, char *string, int len)
+{
+    pg_wchar *wstring;
+    int wlen;
+    int regexec_result;
+
+    /* an anchored literal only needs the bytes compared */
+    if (cache->prefix_len >= 0)
+        return len >= cache->prefix_len &&
+               memcmp(string, cache->pattern + 1, cache->prefix_len) == 0;
+
+    wstring = palloc((len + 1) * sizeof(pg_wchar));
+    wlen = pg_mb2wchar_with_len(string, wstring, len);
+
+    regexec_result = pg_regexec(&cache->re, wstring, wlen, 0, NULL, 0, NULL,
+                                0);
+    pfree(wstring);
+
+    if (regexec_result != REG_OKAY && regexec_result != REG_NOMATCH)
+    {
+        char errMsg[100];
+
+        CHECK_FOR_INTERRUPTS();
+        pg_regerror(regexec_result, &cache->re, errMsg, sizeof(errMsg));
+        ereport(ERROR, (errcode(ERRCODE_INVALID_REGULAR_EXPRESSION),
+                        errmsg("regular expression failed: %s", errMsg)));
+    }
+
+    return regexec_result == REG_OKAY;
+}
+
 PG_FUNCTION_INFO_V1(gtype_eq_tilde);
 /*
  * function for =~ aka regular expression comparisons
@@ -4746,15 +6105,13 @@ Datum gtype_eq_tilde(PG_FUNCTION_ARGS)
 
         /* only strings can be compared, all others are errors */
         if (agtv_string->type == AGTV_STRING && agtv_pattern->type == AGTV_STRING) {
-            text *string = cstring_to_text_with_len(agtv_string->val.string.val,
-                                                    agtv_string->val.string.len);
-            text *pattern = cstring_to_text_with_len(agtv_pattern->val.string.val,
-                                                     agtv_pattern->val.string.len);
-
-            Datum result = (DirectFunctionCall2Coll(textregexeq, C_COLLATION_OID,
-                                                    PointerGetDatum(string),
-                                                    PointerGetDatum(pattern)));
-            return boolean_to_gtype(DatumGetBool(result));
+            regex_cache *cache = get_regex_cache(fcinfo,
+                                                 agtv_pattern->val.string.val,
+                                                 agtv_pattern->val.string.len);
+
+            return boolean_to_gtype(regex_cache_match(cache,
+                                        agtv_string->val.string.val,
+                                        agtv_string->val.string.len));
         }
     }
 
@@ -4762,103 +6119,21 @@ Datum gtype_eq_tilde(PG_FUNCTION_ARGS)
                     errmsg("gtype string values expected")));
 }
 
-/*
- * Helper function to step through and retrieve keys from an object.
- * borrowed and modified from get_next_object_pair() in gtype_vle.c
- */
-static gtype_iterator *get_next_object_key(gtype_iterator *it, gtype_container *agtc, gtype_value *key) {
-    gtype_iterator_token itok;
-    gtype_value tmp;
-
-    /* verify input params */
-    Assert(agtc != NULL);
-    Assert(key != NULL);
-
-    /* check to see if the container is empty */
-    if (GTYPE_CONTAINER_SIZE(agtc) == 0)
-        return NULL;
-
-    /* if the passed iterator is NULL, this is the first time, create it */
-    if (it == NULL) {
-        /* initial the iterator */
-        it = gtype_iterator_init(agtc);
-        /* get the first token */
-        itok = gtype_iterator_next(&it, &tmp, false);
-        /* it should be WAGT_BEGIN_OBJECT */
-        Assert(itok == WAGT_BEGIN_OBJECT);
-    }
-
-    /* the next token should be a key or the end of the object */
-    itok = gtype_iterator_next(&it, &tmp, false);
-    Assert(itok == WAGT_KEY || WAGT_END_OBJECT);
-    /* if this is the end of the object return NULL */
-    if (itok == WAGT_END_OBJECT)
-        return NULL;
-
-    /* this should be the key, copy it */
-    if (itok == WAGT_KEY)
-        memcpy(key, &tmp, sizeof(gtype_value));
-
-    /*
-     * The next token should be a value but, it could be a begin tokens for
-     * arrays or objects. For those we just return NULL to ignore them.
-     */
-    itok = gtype_iterator_next(&it, &tmp, true);
-    Assert(itok == WAGT_VALUE);
-
-    /* return the iterator */
-    return it;
-}
-
 PG_FUNCTION_INFO_V1(vertex_keys);
 Datum vertex_keys(PG_FUNCTION_ARGS)
 {
-    gtype *agt_arg = NULL;
-    gtype_value *agtv_result = NULL;
-    gtype_value obj_key = {0};
-    gtype_iterator *it = NULL;
-    gtype_parse_state *parse_state = NULL;
     vertex *v = AG_GET_ARG_VERTEX(0);
-    	agt_arg = extract_vertex_properties(v);
-
-    agtv_result = push_gtype_value(&parse_state, WAGT_BEGIN_ARRAY, NULL);
-
-    while ((it = get_next_object_key(it, &agt_arg->root, &obj_key)))
-        agtv_result = push_gtype_value(&parse_state, WAGT_ELEM, &obj_key);
-
-    /* push the end of the array*/
-    agtv_result = push_gtype_value(&parse_state, WAGT_END_ARRAY, NULL);
-
-    Assert(agtv_result != NULL);
-    Assert(agtv_result->type == AGTV_ARRAY);
 
-    PG_RETURN_POINTER(gtype_value_to_gtype(agtv_result));
+    AG_RETURN_GTYPE_P(gtype_object_keys(&extract_vertex_properties(v)->root));
 }
 
 
 PG_FUNCTION_INFO_V1(edge_keys);
 Datum edge_keys(PG_FUNCTION_ARGS)
-{   
-    gtype *agt_arg = NULL;
-    gtype_value *agtv_result = NULL;
-    gtype_value obj_key = {0};
-    gtype_iterator *it = NULL;
-    gtype_parse_state *parse_state = NULL;
-    edge *v = AG_GET_ARG_EDGE(0);
-        agt_arg = extract_edge_properties(v);
-
-    agtv_result = push_gtype_value(&parse_state, WAGT_BEGIN_ARRAY, NULL);
-
-    while ((it = get_next_object_key(it, &agt_arg->root, &obj_key)))
-        agtv_result = push_gtype_value(&parse_state, WAGT_ELEM, &obj_key);
-
-    /* push the end of the array*/
-    agtv_result = push_gtype_value(&parse_state, WAGT_END_ARRAY, NULL);
-
-    Assert(agtv_result != NULL);
-    Assert(agtv_result->type == AGTV_ARRAY);
+{
+    edge *e = AG_GET_ARG_EDGE(0);
 
-    PG_RETURN_POINTER(gtype_value_to_gtype(agtv_result));
+    AG_RETURN_GTYPE_P(gtype_object_keys(&extract_edge_properties(e)->root));
 }
 
 
@@ -4866,12 +6141,7 @@ Datum edge_keys(PG_FUNCTION_ARGS)
 PG_FUNCTION_INFO_V1(gtype_keys);
 Datum gtype_keys(PG_FUNCTION_ARGS)
 {
-    gtype *agt_arg = NULL;
-    gtype_value *agtv_result = NULL;
-    gtype_value obj_key = {0};
-    gtype_iterator *it = NULL;
-    gtype_parse_state *parse_state = NULL;
-    agt_arg = AG_GET_ARG_GTYPE_P(0);
+    gtype *agt_arg = AG_GET_ARG_GTYPE_P(0);
 
     if (is_gtype_null(agt_arg))
         PG_RETURN_NULL();
@@ -4881,18 +6151,7 @@ Datum gtype_keys(PG_FUNCTION_ARGS)
                 errmsg("keys() argument must be an object")));
     }
 
-    agtv_result = push_gtype_value(&parse_state, WAGT_BEGIN_ARRAY, NULL);
-
-    while ((it = get_next_object_key(it, &agt_arg->root, &obj_key)))
-        agtv_result = push_gtype_value(&parse_state, WAGT_ELEM, &obj_key);
-
-    /* push the end of the array*/
-    agtv_result = push_gtype_value(&parse_state, WAGT_END_ARRAY, NULL);
-
-    Assert(agtv_result != NULL);
-    Assert(agtv_result->type == AGTV_ARRAY);
-
-    PG_RETURN_POINTER(gtype_value_to_gtype(agtv_result));
+    AG_RETURN_GTYPE_P(gtype_object_keys(&agt_arg->root));
 }
 
 /*
@@ -4945,23 +6204,24 @@ static int64 get_int64_from_int_datums(Datum d, Oid type, char *funcname, bool *
     return result;
 }
 
-PG_FUNCTION_INFO_V1(gtype_range);
-/*
- * Execution function to implement openCypher range() function
- */
-Datum gtype_range(PG_FUNCTION_ARGS)
+/* State of unnest_range(), kept in the multi-call memory context */
+typedef struct range_unnest_state
+{
+    int64 next;
+    int64 end_idx;
+    int64 step;
+    bool done;
+} range_unnest_state;
+
+/* validates the arguments of range() and unnest_range() */
+static void get_range_args(FunctionCallInfo fcinfo, int64 *start_idx,
+                           int64 *end_idx, int64 *step)
 {
     Datum *args = NULL;
     bool *nulls = NULL;
     Oid *types = NULL;
     int nargs;
-    int64 start_idx = 0;
-    int64 end_idx = 0;
-    /* step defaults to 1 */
-    int64 step = 1;
     bool is_agnull = false;
-    gtype_in_state agis_result;
-    int64 i = 0;
 
     /* get the arguments */
     nargs = extract_variadic_args(fcinfo, 0, false, &args, &types, &nulls);
@@ -4979,28 +6239,44 @@ Datum gtype_range(PG_FUNCTION_ARGS)
                  errmsg("range(): neither start or end can be NULL")));
 
     /* get the start index */
-    start_idx = get_int64_from_int_datums(args[0], types[0], "range", &is_agnull);
+    *start_idx = get_int64_from_int_datums(args[0], types[0], "range", &is_agnull);
     if (is_agnull)
         ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
                  errmsg("range(): start cannot be NULL")));
 
     /* get the end index */
-    end_idx = get_int64_from_int_datums(args[1], types[1], "range", &is_agnull);
+    *end_idx = get_int64_from_int_datums(args[1], types[1], "range", &is_agnull);
     if (is_agnull)
         ereport(ERROR,
                 (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
                  errmsg("range(): end cannot be NULL")));
 
-    /* get the step */
+    /* step defaults to 1 */
+    *step = 1;
     if (nargs == 3 && !nulls[2]) {
-        step = get_int64_from_int_datums(args[2], types[2], "range", &is_agnull);
+        *step = get_int64_from_int_datums(args[2], types[2], "range", &is_agnull);
         if (is_agnull)
-            step = 1;
+            *step = 1;
     }
 
-    if (step == 0)
+    if (*step == 0)
         ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
                  errmsg("range(): step cannot be zero")));
+}
+
+PG_FUNCTION_INFO_V1(gtype_range);
+/*
+ * Execution function to implement openCypher range() function
+ */
+Datum gtype_range(PG_FUNCTION_ARGS)
+{
+    int64 start_idx = 0;
+    int64 end_idx = 0;
+    int64 step = 1;
+    gtype_in_state agis_result;
+    int64 i = 0;
+
+    get_range_args(fcinfo, &start_idx, &end_idx, &step);
 
     MemSet(&agis_result, 0, sizeof(gtype_in_state));
 
@@ -5020,81 +6296,181 @@ Datum gtype_range(PG_FUNCTION_ARGS)
     PG_RETURN_POINTER(gtype_value_to_gtype(agis_result.res));
 }
 
-PG_FUNCTION_INFO_V1(gtype_unnest);
+PG_FUNCTION_INFO_V1(gtype_unnest_range);
 /*
- * Function to convert the Array type of Agtype into each row. It is used for
- * Cypher `UNWIND` clause, but considering the situation in which the user can
- * directly use this function in vanilla PGSQL, put a second parameter related
- * to this.
+ * Returns the elements of range() one row at a time, without building the
+ * list. The transform of UNWIND uses it in place of unnest(range(...)).
  */
-Datum gtype_unnest(PG_FUNCTION_ARGS)
+Datum gtype_unnest_range(PG_FUNCTION_ARGS)
 {
-    gtype *gtype_arg = AG_GET_ARG_GTYPE_P(0);
-    bool block_types = PG_GETARG_BOOL(1);
-    ReturnSetInfo *rsi;
-    Tuplestorestate *tuple_store;
-    TupleDesc tupdesc;
-    TupleDesc ret_tdesc;
-    MemoryContext old_cxt, tmp_cxt;
-    bool skipNested = false;
-    gtype_iterator *it;
-    gtype_value v;
-    gtype_iterator_token r;
+    FuncCallContext *funcctx;
+    range_unnest_state *state;
+    gtype_value agtv;
 
-    if (!AGT_ROOT_IS_ARRAY(gtype_arg))
-        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                        errmsg("cannot extract elements from an object")));
+    if (SRF_IS_FIRSTCALL())
+    {
+        MemoryContext old_cxt;
+        int64 start_idx;
+
+        funcctx = SRF_FIRSTCALL_INIT();
+
+        old_cxt = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+        state = palloc(sizeof(range_unnest_state));
+        MemoryContextSwitchTo(old_cxt);
+
+        get_range_args(fcinfo, &start_idx, &state->end_idx, &state->step);
+        state->next = start_idx;
+        state->done = false;
+
+        funcctx->user_fctx = state;
+    }
+
+    funcctx = SRF_PERCALL_SETUP();
+    state = (range_unnest_state *) funcctx->user_fctx;
+
+    if (state->done ||
+        (state->step > 0 && state->next > state->end_idx) ||
+        (state->step < 0 && state->next < state->end_idx))
+        SRF_RETURN_DONE(funcctx);
+
+    agtv.type = AGTV_INTEGER;
+    agtv.val.int_value = state->next;
+
+    /* stop instead of wrapping around at the ends of int64 */
+    if (pg_add_s64_overflow(state->next, state->step, &state->next))
+        state->done = true;
+
+    SRF_RETURN_NEXT(funcctx, PointerGetDatum(gtype_value_to_gtype(&agtv)));
+}
 
-    rsi = (ReturnSetInfo *) fcinfo->resultinfo;
+/* returns the integer value of a gtype constant, if it is one */
+static bool get_range_const_arg(Node *node, int64 *result)
+{
+    Const *c;
+    gtype *agt;
+    gtype_value *agtv;
+
+    if (!IsA(node, Const))
+        return false;
+
+    c = (Const *) node;
+    if (c->constisnull || c->consttype != GTYPEOID)
+        return false;
+
+    agt = DATUM_GET_GTYPE_P(c->constvalue);
+    if (!AGT_ROOT_IS_SCALAR(agt))
+        return false;
 
-    rsi->returnMode = SFRM_Materialize;
+    agtv = get_ith_gtype_value_from_container(&agt->root, 0);
+    if (agtv->type != AGTV_INTEGER)
+        return false;
 
-    /* it's a simple type, so don't use get_call_result_type() */
-    tupdesc = rsi->expectedDesc;
+    *result = agtv->val.int_value;
+    return true;
+}
 
-    old_cxt = MemoryContextSwitchTo(rsi->econtext->ecxt_per_query_memory);
+PG_FUNCTION_INFO_V1(gtype_unnest_range_support);
+/*
+ * Planner support function for unnest_range(). Like the one of
+ * generate_series(), it estimates the number of rows when the arguments
+ * are constants.
+ *
+ * Code borrowed and adjusted from PG's generate_series_int8_support
+ * function.
+ */
+Datum gtype_unnest_range_support(PG_FUNCTION_ARGS)
+{
+    Node *rawreq = (Node *) PG_GETARG_POINTER(0);
+    SupportRequestRows *req;
+    FuncExpr *expr;
+    int64 start_idx;
+    int64 end_idx;
+    int64 step = 1;
 
-    ret_tdesc = CreateTupleDescCopy(tupdesc);
-    BlessTupleDesc(ret_tdesc);
-    tuple_store = tuplestore_begin_heap(rsi->allowedModes & SFRM_Materialize_Random, false, work_mem);
+    if (!IsA(rawreq, SupportRequestRows))
+        PG_RETURN_POINTER(NULL);
 
-    MemoryContextSwitchTo(old_cxt);
+    req = (SupportRequestRows *) rawreq;
+    if (!is_funcclause(req->node))
+        PG_RETURN_POINTER(NULL);
 
-    tmp_cxt = AllocSetContextCreate(CurrentMemoryContext, "age_unnest temporary cxt", ALLOCSET_DEFAULT_SIZES);
+    expr = (FuncExpr *) req->node;
 
-    it = gtype_iterator_init(&gtype_arg->root);
+    /* try to simplify the arguments to constants */
+    if (!get_range_const_arg(estimate_expression_value(req->root,
+                                 linitial(expr->args)), &start_idx) ||
+        !get_range_const_arg(estimate_expression_value(req->root,
+                                 lsecond(expr->args)), &end_idx))
+        PG_RETURN_POINTER(NULL);
 
-    while ((r = gtype_iterator_next(&it, &v, skipNested)) != WAGT_DONE)
+    if (list_length(expr->args) == 3)
     {
-        skipNested = true;
+        Node *arg = estimate_expression_value(req->root, lthird(expr->args));
 
-        if (r == WAGT_ELEM)
-        {
-            HeapTuple tuple;
-            Datum values[1];
-            bool nulls[1] = {false};
-            gtype *val = gtype_value_to_gtype(&v);
+        /* a NULL step means 1, anything else unknown gives up */
+        if (!(IsA(arg, Const) && ((Const *) arg)->constisnull) &&
+            !get_range_const_arg(arg, &step))
+            PG_RETURN_POINTER(NULL);
+    }
+
+    /* the function errors for a zero step, so it doesn't matter */
+    if (step == 0)
+        PG_RETURN_POINTER(NULL);
+
+    /* use doubles, so the difference can't overflow */
+    req->rows = floor(((double) end_idx - (double) start_idx + (double) step) /
+                      (double) step);
+    if (req->rows < 0)
+        req->rows = 0;
+
+    PG_RETURN_POINTER(req);
+}
 
-            /* use the tmp context so we can clean up after each tuple is done */
-            old_cxt = MemoryContextSwitchTo(tmp_cxt);
+PG_FUNCTION_INFO_V1(gtype_unnest);
+/*
+ * Function to convert the Array type of Agtype into each row. It is used for
+ * Cypher `UNWIND` clause, but considering the situation in which the user can
+ * directly use this function in vanilla PGSQL, put a second parameter related
+ * to this.
+ *
+ * The rows are returned one per call, straight from the array's container,
+ * so a LIMIT or a filter above UNWIND stops the work early.
+ */
+Datum gtype_unnest(PG_FUNCTION_ARGS)
+{
+    FuncCallContext *funcctx;
+    gtype *gtype_arg;
+    gtype_value *v;
+
+    if (SRF_IS_FIRSTCALL())
+    {
+        MemoryContext old_cxt;
 
-            values[0] = PointerGetDatum(val);
+        funcctx = SRF_FIRSTCALL_INIT();
 
-            tuple = heap_form_tuple(ret_tdesc, values, nulls);
+        /* detoast once, into memory that lasts for all of the calls */
+        old_cxt = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+        gtype_arg = AG_GET_ARG_GTYPE_P(0);
+        MemoryContextSwitchTo(old_cxt);
 
-            tuplestore_puttuple(tuple_store, tuple);
+        if (!AGT_ROOT_IS_ARRAY(gtype_arg))
+            ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                            errmsg("cannot extract elements from an object")));
 
-            MemoryContextSwitchTo(old_cxt);
-            MemoryContextReset(tmp_cxt);
-        }
+        funcctx->max_calls = AGT_ROOT_COUNT(gtype_arg);
+        funcctx->user_fctx = gtype_arg;
     }
 
-    MemoryContextDelete(tmp_cxt);
+    funcctx = SRF_PERCALL_SETUP();
+
+    if (funcctx->call_cntr >= funcctx->max_calls)
+        SRF_RETURN_DONE(funcctx);
 
-    rsi->setResult = tuple_store;
-    rsi->setDesc = ret_tdesc;
+    gtype_arg = (gtype *) funcctx->user_fctx;
+    v = get_ith_gtype_value_from_container(&gtype_arg->root,
+                                           funcctx->call_cntr);
 
-    PG_RETURN_NULL();
+    SRF_RETURN_NEXT(funcctx, PointerGetDatum(gtype_value_to_gtype(v)));
 }
 
 
@@ -940,8 +940,6 @@ Datum gtype_exists(PG_FUNCTION_ARGS)
 {
     gtype *agt = AG_GET_ARG_GTYPE_P(0);
     text *key = PG_GETARG_TEXT_PP(1);
-    gtype_value aval;
-    gtype_value *v = NULL;
 
     /*
      * We only match Object keys (which are naturally always Strings), or
@@ -949,13 +947,8 @@ Datum gtype_exists(PG_FUNCTION_ARGS)
      * scalar elements.  Existence of a key/element is only considered at the
      * top level.  No recursion occurs.
      */
-    aval.type = AGTV_STRING;
-    aval.val.string.val = VARDATA_ANY(key);
-    aval.val.string.len = VARSIZE_ANY_EXHDR(key);
-
-    v = find_gtype_value_from_container(&agt->root, AGT_FOBJECT | AGT_FARRAY, &aval);
-
-    PG_RETURN_BOOL(v != NULL);
+    PG_RETURN_BOOL(gtype_container_has_key(&agt->root, VARDATA_ANY(key),
+                                           VARSIZE_ANY_EXHDR(key)));
 }
 
 PG_FUNCTION_INFO_V1(gtype_exists_any);
@@ -976,16 +969,11 @@ Datum gtype_exists_any(PG_FUNCTION_ARGS)
 
     for (i = 0; i < elem_count; i++)
     {
-        gtype_value strVal;
-
         if (key_nulls[i])
             continue;
 
-        strVal.type = AGTV_STRING;
-        strVal.val.string.val = VARDATA(key_datums[i]);
-        strVal.val.string.len = VARSIZE(key_datums[i]) - VARHDRSZ;
-
-        if (find_gtype_value_from_container(&agt->root, AGT_FOBJECT | AGT_FARRAY, &strVal) != NULL)
+        if (gtype_container_has_key(&agt->root, VARDATA_ANY(key_datums[i]),
+                                     VARSIZE_ANY_EXHDR(key_datums[i])))
             PG_RETURN_BOOL(true);
     }
 
@@ -1000,7 +988,7 @@ PG_FUNCTION_INFO_V1(gtype_exists_all);
 Datum gtype_exists_all(PG_FUNCTION_ARGS)
 {
     gtype *agt = AG_GET_ARG_GTYPE_P(0);
-    ArrayType  *keys = PG_GETARG_ARRAYTYPE_P(1);
+    ArrayType *keys = PG_GETARG_ARRAYTYPE_P(1);
     int i;
     Datum *key_datums;
     bool *key_nulls;
@@ -1008,17 +996,13 @@ Datum gtype_exists_all(PG_FUNCTION_ARGS)
 
     deconstruct_array(keys, TEXTOID, -1, false, 'i', &key_datums, &key_nulls, &elem_count);
 
-    for (i = 0; i < elem_count; i++) {
-        gtype_value strVal;
-
+    for (i = 0; i < elem_count; i++)
+    {
         if (key_nulls[i])
             continue;
 
-        strVal.type = AGTV_STRING;
-        strVal.val.string.val = VARDATA(key_datums[i]);
-        strVal.val.string.len = VARSIZE(key_datums[i]) - VARHDRSZ;
-
-        if (find_gtype_value_from_container(&agt->root, AGT_FOBJECT | AGT_FARRAY, &strVal) == NULL)
+        if (!gtype_container_has_key(&agt->root, VARDATA_ANY(key_datums[i]),
+                                     VARSIZE_ANY_EXHDR(key_datums[i])))
             PG_RETURN_BOOL(false);
     }
 
@@ -126,6 +126,71 @@ gtype *gtype_value_to_gtype(gtype_value *val)
     return out;
 }
 
+/*
+ * Allocates a gtype string scalar of len bytes, laid out the way
+ * gtype_value_to_gtype() lays it out, and sets *data to where the caller
+ * writes the bytes of the string. The string functions use this to build
+ * their result with a single allocation.
+ */
+gtype *make_gtype_string(int len, char **data)
+{
+    gtype *out;
+    int totallen = sizeof(uint32) + sizeof(agtentry) + len;
+
+    if (totallen > AGTENTRY_OFFLENMASK)
+        ereport(ERROR,
+                (errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+                 errmsg("total size of gtype array elements exceeds the maximum of %u bytes",
+                        AGTENTRY_OFFLENMASK)));
+
+    out = palloc(VARHDRSZ + totallen);
+    SET_VARSIZE(out, VARHDRSZ + totallen);
+
+    /* a raw scalar is an array of one element */
+    out->root.header = 1 | AGT_FARRAY | AGT_FSCALAR;
+    out->root.children[0] = AGTENTRY_IS_STRING | AGTENTRY_HAS_OFF | len;
+
+    *data = (char *)&out->root.children[1];
+
+    return out;
+}
+
+/*
+ * Allocates an integer or float scalar laid out the way
+ * ag_serialize_extended_type() lays it out: the AGT_HEADER word followed by
+ * the 8 byte value. Both are fixed size, so the math functions can build
+ * their result without a gtype_value or a StringInfo.
+ */
+static gtype *make_gtype_fixed_scalar(uint32 agt_header, const void *value)
+{
+    gtype *out;
+    char *data;
+    int datalen = sizeof(uint32) + sizeof(int64);
+    int totallen = sizeof(uint32) + sizeof(agtentry) + datalen;
+
+    out = palloc(VARHDRSZ + totallen);
+    SET_VARSIZE(out, VARHDRSZ + totallen);
+
+    out->root.header = 1 | AGT_FARRAY | AGT_FSCALAR;
+    out->root.children[0] = AGTENTRY_IS_GTYPE | AGTENTRY_HAS_OFF | datalen;
+
+    data = (char *)&out->root.children[1];
+    *((uint32 *)data) = agt_header;
+    memcpy(data + sizeof(uint32), value, sizeof(int64));
+
+    return out;
+}
+
+gtype *make_gtype_integer(int64 i)
+{
+    return make_gtype_fixed_scalar(AGT_HEADER_INTEGER, &i);
+}
+
+gtype *make_gtype_float(float8 f)
+{
+    return make_gtype_fixed_scalar(AGT_HEADER_FLOAT, &f);
+}
+
 /*
  * Get the offset of the variable-length portion of an gtype node within
  * the variable-length-data part of its container.  The node is identified
@@ -484,6 +549,85 @@ gtype_value *find_gtype_value_from_container(gtype_container *container,
     return NULL;
 }
 
+/*
+ * Returns true if the string is one of the container's top-level object
+ * keys, or one of its string elements if it is an array, which is what the
+ * ? operators test. For objects, only the key agtentrys are binary searched
+ * and compared in place, so no value is ever decoded.
+ */
+bool gtype_container_has_key(gtype_container *container, char *key, int len)
+{
+    gtype_value agtv;
+
+    if (GTYPE_CONTAINER_IS_OBJECT(container))
+    {
+        int count = GTYPE_CONTAINER_SIZE(container);
+        char *base_addr = (char *)(container->children + count * 2);
+        uint32 stop_low = 0;
+        uint32 stop_high = count;
+
+        while (stop_low < stop_high)
+        {
+            uint32 stop_middle = stop_low + (stop_high - stop_low) / 2;
+            int candidate_len = get_gtype_length(container, stop_middle);
+            int difference;
+
+            /* keys are sorted by length first, then by their bytes */
+            if (candidate_len == len)
+                difference = memcmp(base_addr + get_gtype_offset(container, stop_middle),
+                                    key, len);
+            else
+                difference = (candidate_len > len) ? 1 : -1;
+
+            if (difference == 0)
+                return true;
+            else if (difference < 0)
+                stop_low = stop_middle + 1;
+            else
+                stop_high = stop_middle;
+        }
+
+        return false;
+    }
+
+    agtv.type = AGTV_STRING;
+    agtv.val.string.val = key;
+    agtv.val.string.len = len;
+
+    return find_gtype_value_from_container(container, AGT_FARRAY, &agtv) != NULL;
+}
+
+/*
+ * Returns the top-level keys of an object container as a gtype array. The
+ * keys come first in an object's agtentrys and data, laid out with the same
+ * offset stride an array uses, so both are copied over as they are without
+ * looking at the values.
+ */
+gtype *gtype_object_keys(gtype_container *container)
+{
+    int count = GTYPE_CONTAINER_SIZE(container);
+    uint32 datalen = 0;
+    int totallen;
+    gtype *out;
+
+    Assert(GTYPE_CONTAINER_IS_OBJECT(container));
+
+    if (count > 0)
+        datalen = get_gtype_offset(container, count - 1) +
+                  get_gtype_length(container, count - 1);
+
+    totallen = sizeof(uint32) + sizeof(agtentry) * count + datalen;
+
+    out = palloc(VARHDRSZ + totallen);
+    SET_VARSIZE(out, VARHDRSZ + totallen);
+
+    out->root.header = count | AGT_FARRAY;
+    memcpy(out->root.children, container->children, sizeof(agtentry) * count);
+    memcpy(&out->root.children[count], &container->children[count * 2], datalen);
+
+    return out;
+}
+
 /*
  * Get i-th value of an gtype array.
  *
@@ -17,6 +17,8 @@
  */
 #include "postgraph.h"
 
+#include "common/hashfn.h"
+#include "port/pg_bitutils.h"
 #include "utils/fmgrprotos.h"
 #include "utils/varlena.h"
 
@@ -37,16 +39,118 @@ Datum traversal_in(PG_FUNCTION_ARGS) {
     AG_RETURN_TRAVERSAL(NULL);
 }
 
+/*
+ * Returns the i'th entity of the traversal.
+ */
+char *get_traversal_entity(traversal *t, int i) {
+    char *ptr;
+
+    Assert(i >= 0 && i < TRAVERSAL_SIZE(t));
+
+    if (t->children[0] & TRAVERSAL_HAS_OFFSETS)
+        return (char *)t + t->children[1 + i];
+
+    // traversals without the offset table have to be walked
+    ptr = (char *)&t->children[1];
+    for (; i > 0; i--)
+        ptr = ptr + VARSIZE(ptr);
+
+    return ptr;
+}
+
+/*
+ * Starts a traversal or a VariableEdge of count entities: the varlena header,
+ * the header word, and the offset table that append_path_entity() fills in.
+ */
+void init_path_builder(path_builder *pb, int count, uint32 header) {
+    // a path has at most count / 2 + 1 vertices, so the table stays half empty
+    uint32 nslots = pg_nextpower2_32(Max(count, 1) + 1);
+
+    initStringInfo(&pb->buffer);
+
+    // header
+    reserve_from_buffer(&pb->buffer, VARHDRSZ);
+
+    // length
+    append_to_buffer(&pb->buffer, (char *)&header, sizeof(uint32));
+
+    // offsets
+    reserve_from_buffer(&pb->buffer, sizeof(uint32) * count);
+
+    pb->vertices = palloc0(sizeof(path_vertex_slot) * nslots);
+    pb->mask = nslots - 1;
+}
+
+/*
+ * Sets the i'th entity of the path being built. A vertex the path already
+ * passed through is not copied again, its offset is reused. A vertex with the
+ * same graphid but other properties gets its own copy.
+ */
+void append_path_entity(path_builder *pb, int i, char *entity, bool is_vertex) {
+    uint32 *offsets = (uint32 *)(pb->buffer.data + VARHDRSZ + sizeof(uint32));
+    path_vertex_slot *slot = NULL;
+    graphid id = 0;
+
+    if (is_vertex) {
+        id = EXTRACT_VERTEX_ID((vertex *)entity);
+
+        uint32 h = hash_bytes_uint32((uint32)(id ^ (id >> 32)));
+
+        for (slot = &pb->vertices[h & pb->mask]; slot->offset != 0; slot = &pb->vertices[++h & pb->mask]) {
+            char *prev = pb->buffer.data + slot->offset;
+
+            if (slot->id != id)
+                continue;
+
+            if (VARSIZE(prev) == VARSIZE(entity) && memcmp(prev, entity, VARSIZE(entity)) == 0) {
+                offsets[i] = slot->offset;
+                return;
+            }
+
+            slot = NULL;
+            break;
+        }
+    }
+
+    offsets[i] = pb->buffer.len;
+
+    if (slot != NULL) {
+        slot->id = id;
+        slot->offset = pb->buffer.len;
+    }
+
+    append_to_buffer(&pb->buffer, entity, VARSIZE(entity));
+}
+
+/*
+ * Sets the varlena size of the path built and returns it.
+ */
+void *finish_path_builder(path_builder *pb) {
+    pfree(pb->vertices);
+
+    SET_VARSIZE(pb->buffer.data, pb->buffer.len);
+
+    return pb->buffer.data;
+}
+
+void init_traversal(path_builder *pb, int count) {
+    init_path_builder(pb, count, count | TRAVERSAL_HAS_OFFSETS);
+}
+
+void append_traversal_entity(path_builder *pb, int i, char *entity) {
+    append_path_entity(pb, i, entity, i % 2 == 0);
+}
+
 PG_FUNCTION_INFO_V1(traversal_out);
 Datum traversal_out(PG_FUNCTION_ARGS) {
     traversal *v = AG_GET_ARG_TRAVERSAL(0);
     StringInfo str = makeStringInfo();
 
     appendStringInfoString(str, "[");
-    
-    char *ptr = &v->children[1];
-    for (int i = 0; i < v->children[0]; i++, ptr = ptr + VARSIZE(ptr)) {
-	
+
+    for (int i = 0; i < TRAVERSAL_SIZE(v); i++) {
+	char *ptr = get_traversal_entity(v, i);
+
 	if (i % 2 == 0) {
             append_vertex_to_string(str, (vertex *)ptr);
         } else {
@@ -63,20 +167,13 @@ Datum traversal_out(PG_FUNCTION_ARGS) {
 PG_FUNCTION_INFO_V1(build_traversal);
 Datum
 build_traversal(PG_FUNCTION_ARGS) {
-    StringInfoData buffer;
-    initStringInfo(&buffer);
+    path_builder pb;
     Datum *args;
     bool *nulls;
     Oid *types;
     pentry nargs = extract_variadic_args(fcinfo, 0, true, &args, &types, &nulls);
-    int32 size;
-
-    // header
-    reserve_from_buffer(&buffer, VARHDRSZ);
-
-    // length
-    reserve_from_buffer(&buffer, sizeof(pentry));
 
+    // check the arguments and count the entities, to size the offset table
     int cnt = 0;
     for (int i = 0; i < nargs; i++) {
         if (i % 2 == 0) {
@@ -84,7 +181,6 @@ build_traversal(PG_FUNCTION_ARGS) {
                  ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 					 errmsg("arguement %i build_traversal() must be a vertex", i)));
             cnt++;
-            append_to_buffer(&buffer, DATUM_GET_VERTEX(args[i]), VARSIZE_ANY(args[i]));
 	}
 	else {
 
@@ -95,26 +191,29 @@ build_traversal(PG_FUNCTION_ARGS) {
                  ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 					 errmsg("traversals must end with a vertex")));
 
-            if (types[i] == EDGEOID) {
-                append_to_buffer(&buffer, DATUM_GET_EDGE(args[i]), VARSIZE_ANY(args[i]));
+            if (types[i] == EDGEOID)
 	        cnt++;
-	    } else {
-		VariableEdge *v = DATUM_GET_VARIABLE_EDGE(args[i]);
-                char *ptr = &v->children[1];
-                for (int i = 0; i < v->children[0]; i++, ptr = ptr + VARSIZE(ptr)) {
-                     append_to_buffer(&buffer, DATUM_GET_EDGE(ptr), VARSIZE_ANY(ptr));
-		     cnt++;
-                }
-	    }
+	    else
+                cnt += VARIABLE_EDGE_SIZE(DATUM_GET_VARIABLE_EDGE(args[i]));
 	}
     }
 
-    traversal *p = (traversal *)buffer.data;
+    init_traversal(&pb, cnt);
 
-    p->children[0] = cnt;
-    SET_VARSIZE(p, buffer.len);
+    cnt = 0;
+    for (int i = 0; i < nargs; i++) {
+        if (types[i] == VERTEXOID) {
+            append_traversal_entity(&pb, cnt++, DATUM_GET_VERTEX(args[i]));
+        } else if (types[i] == EDGEOID) {
+            append_traversal_entity(&pb, cnt++, DATUM_GET_EDGE(args[i]));
+	} else {
+	    VariableEdge *v = DATUM_GET_VARIABLE_EDGE(args[i]);
+            for (int j = 0; j < VARIABLE_EDGE_SIZE(v); j++)
+                append_traversal_entity(&pb, cnt++, get_variable_edge_entity(v, j));
+	}
+    }
 
-    AG_RETURN_TRAVERSAL(p);
+    AG_RETURN_TRAVERSAL(finish_path_builder(&pb));
 }
 
 PG_FUNCTION_INFO_V1(traversal_edges);
@@ -122,19 +221,11 @@ Datum traversal_edges(PG_FUNCTION_ARGS) {
     traversal *v = AG_GET_ARG_TRAVERSAL(0);
     Datum *array_value;
 
-    int size = (v->children[0] - 1) / 2;
+    int size = (TRAVERSAL_SIZE(v) - 1) / 2;
     array_value = (Datum *) palloc(sizeof(Datum) * size);
 
-
-    char *ptr = &v->children[1];
-    for (int i = 0; i < v->children[0]; i++, ptr = ptr + VARSIZE(ptr)) {
-
-        if (i % 2 == 0) {
-            continue;
-        } else {
-	    array_value[(i - 1) / 2] = EDGE_GET_DATUM((edge *)ptr);
-        }
-    }
+    for (int i = 0; i < size; i++)
+        array_value[i] = EDGE_GET_DATUM((edge *)get_traversal_entity(v, i * 2 + 1));
 
     ArrayType *result = construct_array(array_value, size, EDGEOID, -1, false, TYPALIGN_INT);
 
@@ -146,19 +237,11 @@ Datum traversal_nodes(PG_FUNCTION_ARGS) {
     traversal *v = AG_GET_ARG_TRAVERSAL(0);
     Datum *array_value;
 
-    int size = (v->children[0] + 1) / 2;
+    int size = (TRAVERSAL_SIZE(v) + 1) / 2;
     array_value = (Datum *) palloc(sizeof(Datum) * size);
 
-
-    char *ptr = &v->children[1];
-    for (int i = 0; i < v->children[0]; i++, ptr = ptr + VARSIZE(ptr)) {
-
-        if (i % 2 == 0) {
-	    array_value[i/2] = VERTEX_GET_DATUM((vertex *)ptr);
-        } else {
-	    continue;
-        }
-    }
+    for (int i = 0; i < size; i++)
+        array_value[i] = VERTEX_GET_DATUM((vertex *)get_traversal_entity(v, i * 2));
 
     ArrayType *result = construct_array(array_value, size, VERTEXOID, -1, false, TYPALIGN_INT);
 
@@ -169,12 +252,136 @@ PG_FUNCTION_INFO_V1(traversal_size);
 Datum traversal_size(PG_FUNCTION_ARGS) {
     traversal *v = AG_GET_ARG_TRAVERSAL(0);
 
-    gtype_value gtv = { .type = AGTV_INTEGER, .val = { .int_value = v->children[0] } };
+    gtype_value gtv = { .type = AGTV_INTEGER, .val = { .int_value = TRAVERSAL_SIZE(v) } };
 
     AG_RETURN_GTYPE_P(gtype_value_to_gtype(&gtv));
 }
 
 
+/*
+ * Comparison and Hash Support
+ *
+ * Two traversals are equal when they pass through the same vertices and edges,
+ * so only the graphids are compared and hashed, never the properties.
+ * Ordering compares the graphids in path order, and a traversal that is a
+ * prefix of another sorts first.
+ */
+static inline graphid get_path_entity_id(traversal *t, int i, int vertex_parity) {
+    char *entity = get_traversal_entity(t, i);
+
+    return i % 2 == vertex_parity ? EXTRACT_VERTEX_ID(entity) : EXTRACT_EDGE_ID(entity);
+}
+
+int compare_paths(traversal *lhs, traversal *rhs, int vertex_parity) {
+    int lsize = TRAVERSAL_SIZE(lhs);
+    int rsize = TRAVERSAL_SIZE(rhs);
+
+    for (int i = 0; i < lsize && i < rsize; i++) {
+        graphid lid = get_path_entity_id(lhs, i, vertex_parity);
+        graphid rid = get_path_entity_id(rhs, i, vertex_parity);
+
+        if (lid != rid)
+            return lid < rid ? -1 : 1;
+    }
+
+    if (lsize == rsize)
+        return 0;
+
+    return lsize < rsize ? -1 : 1;
+}
+
+// the graphids of the path, back to back, for hash_any
+static graphid *get_path_ids(traversal *t, int vertex_parity, int *size) {
+    graphid *ids;
+
+    *size = TRAVERSAL_SIZE(t);
+    ids = palloc(sizeof(graphid) * Max(*size, 1));
+
+    for (int i = 0; i < *size; i++)
+        ids[i] = get_path_entity_id(t, i, vertex_parity);
+
+    return ids;
+}
+
+Datum hash_path(traversal *t, int vertex_parity) {
+    int size;
+    graphid *ids = get_path_ids(t, vertex_parity, &size);
+
+    return hash_any((unsigned char *)ids, sizeof(graphid) * size);
+}
+
+// with a seed of 0 the low 32 bits match hash_path()
+Datum hash_path_extended(traversal *t, int vertex_parity, uint64 seed) {
+    int size;
+    graphid *ids = get_path_ids(t, vertex_parity, &size);
+
+    return hash_any_extended((unsigned char *)ids, sizeof(graphid) * size, seed);
+}
+
+PG_FUNCTION_INFO_V1(traversal_eq);
+Datum
+traversal_eq(PG_FUNCTION_ARGS) {
+    traversal *lhs = AG_GET_ARG_TRAVERSAL(0);
+    traversal *rhs = AG_GET_ARG_TRAVERSAL(1);
+
+    PG_RETURN_BOOL(TRAVERSAL_SIZE(lhs) == TRAVERSAL_SIZE(rhs) && compare_paths(lhs, rhs, 0) == 0);
+}
+
+PG_FUNCTION_INFO_V1(traversal_ne);
+Datum
+traversal_ne(PG_FUNCTION_ARGS) {
+    traversal *lhs = AG_GET_ARG_TRAVERSAL(0);
+    traversal *rhs = AG_GET_ARG_TRAVERSAL(1);
+
+    PG_RETURN_BOOL(TRAVERSAL_SIZE(lhs) != TRAVERSAL_SIZE(rhs) || compare_paths(lhs, rhs, 0) != 0);
+}
+
+PG_FUNCTION_INFO_V1(traversal_lt);
+Datum
+traversal_lt(PG_FUNCTION_ARGS) {
+    PG_RETURN_BOOL(compare_paths(AG_GET_ARG_TRAVERSAL(0), AG_GET_ARG_TRAVERSAL(1), 0) < 0);
+}
+
+PG_FUNCTION_INFO_V1(traversal_gt);
+Datum
+traversal_gt(PG_FUNCTION_ARGS) {
+    PG_RETURN_BOOL(compare_paths(AG_GET_ARG_TRAVERSAL(0), AG_GET_ARG_TRAVERSAL(1), 0) > 0);
+}
+
+PG_FUNCTION_INFO_V1(traversal_le);
+Datum
+traversal_le(PG_FUNCTION_ARGS) {
+    PG_RETURN_BOOL(compare_paths(AG_GET_ARG_TRAVERSAL(0), AG_GET_ARG_TRAVERSAL(1), 0) <= 0);
+}
+
+PG_FUNCTION_INFO_V1(traversal_ge);
+Datum
+traversal_ge(PG_FUNCTION_ARGS) {
+    PG_RETURN_BOOL(compare_paths(AG_GET_ARG_TRAVERSAL(0), AG_GET_ARG_TRAVERSAL(1), 0) >= 0);
+}
+
+PG_FUNCTION_INFO_V1(traversal_btree_cmp);
+Datum
+traversal_btree_cmp(PG_FUNCTION_ARGS) {
+    PG_RETURN_INT32(compare_paths(AG_GET_ARG_TRAVERSAL(0), AG_GET_ARG_TRAVERSAL(1), 0));
+}
+
+PG_FUNCTION_INFO_V1(traversal_hash_cmp);
+Datum
+traversal_hash_cmp(PG_FUNCTION_ARGS) {
+    return hash_path(AG_GET_ARG_TRAVERSAL(0), 0);
+}
+
+/*
+ * Extended hash function, used by hash partitioning. With a seed of 0 the
+ * low 32 bits match traversal_hash_cmp().
+ */
+PG_FUNCTION_INFO_V1(traversal_hash_extended);
+Datum
+traversal_hash_extended(PG_FUNCTION_ARGS) {
+    return hash_path_extended(AG_GET_ARG_TRAVERSAL(0), 0, PG_GETARG_INT64(1));
+}
+
 static void
 append_to_buffer(StringInfo buffer, const char *data, int len) {
     int offset = reserve_from_buffer(buffer, len);
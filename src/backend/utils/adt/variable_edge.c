@@ -24,7 +24,6 @@
 #include "utils/variable_edge.h"
 #include "utils/vertex.h"
 
-static void append_to_buffer(StringInfo buffer, const char *data, int len);
 
 /*
  * I/O routines for vertex type
@@ -36,18 +35,50 @@ Datum variable_edge_in(PG_FUNCTION_ARGS) {
     AG_RETURN_VARIABLE_EDGE(NULL);
 }
 
+/*
+ * Returns the i'th entity of the VariableEdge.
+ */
+char *get_variable_edge_entity(VariableEdge *v, int i) {
+    char *ptr;
+
+    Assert(i >= 0 && i < VARIABLE_EDGE_SIZE(v));
+
+    if (v->children[0] & VARIABLE_EDGE_HAS_OFFSETS)
+        return (char *)v + v->children[1 + i];
+
+    // VariableEdges without the offset table have to be walked
+    ptr = (char *)&v->children[1];
+    for (; i > 0; i--)
+        ptr = ptr + VARSIZE(ptr);
+
+    return ptr;
+}
+
+/*
+ * Starts a VariableEdge of count entities, see init_path_builder().
+ */
+void init_variable_edge(path_builder *pb, int count) {
+    init_path_builder(pb, count, count | VARIABLE_EDGE_HAS_OFFSETS);
+}
+
+/*
+ * Sets the i'th entity of the VariableEdge being built, sharing the copy of a
+ * vertex that is already in it.
+ */
+void append_variable_edge_entity(path_builder *pb, int i, char *entity) {
+    append_path_entity(pb, i, entity, i % 2 == 1);
+}
+
 PG_FUNCTION_INFO_V1(variable_edge_out);
 Datum variable_edge_out(PG_FUNCTION_ARGS) {
     VariableEdge *v = AG_GET_ARG_VARIABLE_EDGE(0);
     StringInfo str = makeStringInfo();
 
     appendStringInfoString(str, "[");
- //      ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-   //                 errmsg("%i", v->children[0])));
 
+    for (int i = 0; i < VARIABLE_EDGE_SIZE(v); i++) {
+	char *ptr = get_variable_edge_entity(v, i);
 
-    char *ptr = &v->children[1];
-    for (int i = 0; i < v->children[0]; i++, ptr = ptr + VARSIZE(ptr)) {
 	if (i % 2 == 1) {
 	    appendStringInfoString(str, ", ");
             append_vertex_to_string(str, (vertex *)ptr);
@@ -64,18 +95,13 @@ Datum variable_edge_out(PG_FUNCTION_ARGS) {
 PG_FUNCTION_INFO_V1(build_variable_edge);
 Datum
 build_variable_edge(PG_FUNCTION_ARGS) {
-    StringInfoData buffer;
-    initStringInfo(&buffer);
+    path_builder pb;
     Datum *args;
     bool *nulls;
     Oid *types;
     prentry nargs = extract_variadic_args(fcinfo, 0, true, &args, &types, &nulls);
-    int32 size;
-
-    // header
-    reserve_from_buffer(&buffer, VARHDRSZ);
 
-    append_to_buffer(&buffer, (char *)&nargs, sizeof(prentry));
+    init_variable_edge(&pb, nargs);
 
     for (int i = 0; i < nargs; i++) {
         if (i % 2 == 1) {
@@ -86,7 +112,7 @@ build_variable_edge(PG_FUNCTION_ARGS) {
                  ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 					 errmsg("VariableEdges must end with an edge")));
 
-            append_to_buffer(&buffer, DATUM_GET_VERTEX(args[i]), VARSIZE(args[i]));
+            append_variable_edge_entity(&pb, i, DATUM_GET_VERTEX(args[i]));
 	}
 	else {
 
@@ -94,15 +120,11 @@ build_variable_edge(PG_FUNCTION_ARGS) {
                  ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 					 errmsg("arguement %i build_traversal() must be an edge", i)));
 
-            append_to_buffer(&buffer, DATUM_GET_EDGE(args[i]), VARSIZE(args[i]));
+            append_variable_edge_entity(&pb, i, DATUM_GET_EDGE(args[i]));
 	}
     }
 
-    VariableEdge *p = (VariableEdge *)buffer.data;
-
-    SET_VARSIZE(p, buffer.len);
-
-    AG_RETURN_VARIABLE_EDGE(p);
+    AG_RETURN_VARIABLE_EDGE(finish_path_builder(&pb));
 }
 
 /*
@@ -115,11 +137,8 @@ Datum match_vles(PG_FUNCTION_ARGS) {
     VariableEdge *lhs = AG_GET_ARG_VARIABLE_EDGE(0);
     VariableEdge *rhs = AG_GET_ARG_VARIABLE_EDGE(1);
 
-    edge *left_edge = (edge *)&lhs->children[1];
-
-    char *ptr = &rhs->children[1];
-    for (int i = 0; i < rhs->children[0] - 1; i++, ptr = ptr + VARSIZE(ptr));
-    edge *right_edge = (edge *)ptr;
+    edge *left_edge = (edge *)get_variable_edge_entity(lhs, 0);
+    edge *right_edge = (edge *)get_variable_edge_entity(rhs, VARIABLE_EDGE_SIZE(rhs) - 1);
 
     graphid left_start =  *((int64 *)(&left_edge->children[2]));
     graphid left_end =  *((int64 *)(&left_edge->children[4]));
@@ -132,8 +151,77 @@ PG_RETURN_BOOL(left_start == right_start || left_end == right_start ||
 }
 
 
-static void
-append_to_buffer(StringInfo buffer, const char *data, int len) {
-    int offset = reserve_from_buffer(buffer, len);
-    memcpy(buffer->data + offset, data, len);
-}       
+/*
+ * Comparison and Hash Support
+ *
+ * Two VariableEdges are equal when they pass through the same vertices and edges,
+ * so only the graphids are compared and hashed, never the properties.
+ * Ordering compares the graphids in path order, and a VariableEdge that is a
+ * prefix of another sorts first. The traversal support does the work, with
+ * the vertices at the odd indexes.
+ */
+#define compare_variable_edges(lhs, rhs) compare_paths((traversal *)(lhs), (traversal *)(rhs), 1)
+
+PG_FUNCTION_INFO_V1(variable_edge_eq);
+Datum
+variable_edge_eq(PG_FUNCTION_ARGS) {
+    VariableEdge *lhs = AG_GET_ARG_VARIABLE_EDGE(0);
+    VariableEdge *rhs = AG_GET_ARG_VARIABLE_EDGE(1);
+
+    PG_RETURN_BOOL(VARIABLE_EDGE_SIZE(lhs) == VARIABLE_EDGE_SIZE(rhs) && compare_variable_edges(lhs, rhs) == 0);
+}
+
+PG_FUNCTION_INFO_V1(variable_edge_ne);
+Datum
+variable_edge_ne(PG_FUNCTION_ARGS) {
+    VariableEdge *lhs = AG_GET_ARG_VARIABLE_EDGE(0);
+    VariableEdge *rhs = AG_GET_ARG_VARIABLE_EDGE(1);
+
+    PG_RETURN_BOOL(VARIABLE_EDGE_SIZE(lhs) != VARIABLE_EDGE_SIZE(rhs) || compare_variable_edges(lhs, rhs) != 0);
+}
+
+PG_FUNCTION_INFO_V1(variable_edge_lt);
+Datum
+variable_edge_lt(PG_FUNCTION_ARGS) {
+    PG_RETURN_BOOL(compare_variable_edges(AG_GET_ARG_VARIABLE_EDGE(0), AG_GET_ARG_VARIABLE_EDGE(1)) < 0);
+}
+
+PG_FUNCTION_INFO_V1(variable_edge_gt);
+Datum
+variable_edge_gt(PG_FUNCTION_ARGS) {
+    PG_RETURN_BOOL(compare_variable_edges(AG_GET_ARG_VARIABLE_EDGE(0), AG_GET_ARG_VARIABLE_EDGE(1)) > 0);
+}
+
+PG_FUNCTION_INFO_V1(variable_edge_le);
+Datum
+variable_edge_le(PG_FUNCTION_ARGS) {
+    PG_RETURN_BOOL(compare_variable_edges(AG_GET_ARG_VARIABLE_EDGE(0), AG_GET_ARG_VARIABLE_EDGE(1)) <= 0);
+}
+
+PG_FUNCTION_INFO_V1(variable_edge_ge);
+Datum
+variable_edge_ge(PG_FUNCTION_ARGS) {
+    PG_RETURN_BOOL(compare_variable_edges(AG_GET_ARG_VARIABLE_EDGE(0), AG_GET_ARG_VARIABLE_EDGE(1)) >= 0);
+}
+
+PG_FUNCTION_INFO_V1(variable_edge_btree_cmp);
+Datum
+variable_edge_btree_cmp(PG_FUNCTION_ARGS) {
+    PG_RETURN_INT32(compare_variable_edges(AG_GET_ARG_VARIABLE_EDGE(0), AG_GET_ARG_VARIABLE_EDGE(1)));
+}
+
+PG_FUNCTION_INFO_V1(variable_edge_hash_cmp);
+Datum
+variable_edge_hash_cmp(PG_FUNCTION_ARGS) {
+    return hash_path((traversal *)AG_GET_ARG_VARIABLE_EDGE(0), 1);
+}
+
+/*
+ * Extended hash function, used by hash partitioning. With a seed of 0 the
+ * low 32 bits match variable_edge_hash_cmp().
+ */
+PG_FUNCTION_INFO_V1(variable_edge_hash_extended);
+Datum
+variable_edge_hash_extended(PG_FUNCTION_ARGS) {
+    return hash_path_extended((traversal *)AG_GET_ARG_VARIABLE_EDGE(0), 1, PG_GETARG_INT64(1));
+}
@@ -22,10 +22,15 @@
 
 #include "postgraph.h"
 
+#include "catalog/namespace.h"
+#include "nodes/makefuncs.h"
+#include "nodes/supportnodes.h"
 #include "utils/fmgrprotos.h"
 #include "utils/varlena.h"
 
+#include "catalog/ag_label.h"
 #include "commands/label_commands.h"
+#include "utils/ag_func.h"
 #include "utils/gtype.h"
 #include "utils/graphid.h"
 #include "utils/vertex.h"
@@ -237,17 +242,7 @@ vertex_exists(PG_FUNCTION_ARGS) {
     gtype *agt = extract_vertex_properties(v);
     text *key = PG_GETARG_TEXT_PP(1);
 
-    /*
-     * We only match Object keys (which are naturally always Strings), or
-     * In particular, we do not match non-string scalar elements. 
-     * Existence of a key/element is only considered at the
-     * top level.  No recursion occurs.
-     */
-    gtype_value agtv = { .type = AGTV_STRING, .val.string = {VARSIZE_ANY_EXHDR(key), VARDATA_ANY(key)} };
-
-    gtype_value *val = find_gtype_value_from_container(&agt->root, AGT_FOBJECT | AGT_FARRAY, &agtv);
-
-    PG_RETURN_BOOL(val != NULL);
+    PG_RETURN_BOOL(gtype_container_has_key(&agt->root, VARDATA_ANY(key), VARSIZE_ANY_EXHDR(key)));
 }
 
 // ?| operator
@@ -267,9 +262,7 @@ vertex_exists_any(PG_FUNCTION_ARGS) {
         if (key_nulls[i])
             continue;
 
-        gtype_value agtv = { .type = AGTV_STRING, .val.string = { VARSIZE(key_datums[i]) - VARHDRSZ, VARDATA_ANY(key_datums[i]) } };
-
-        if (find_gtype_value_from_container(&agt->root, AGT_FOBJECT | AGT_FARRAY, &agtv) != NULL)
+        if (gtype_container_has_key(&agt->root, VARDATA_ANY(key_datums[i]), VARSIZE_ANY_EXHDR(key_datums[i])))
             PG_RETURN_BOOL(true);
     }
 
@@ -293,15 +286,136 @@ vertex_exists_all(PG_FUNCTION_ARGS) {
         if (key_nulls[i])
             continue;
 
-        gtype_value agtv = { .type = AGTV_STRING, .val.string = { VARSIZE(key_datums[i]) - VARHDRSZ, VARDATA_ANY(key_datums[i]) } };
-
-        if (find_gtype_value_from_container(&agt->root, AGT_FOBJECT | AGT_FARRAY, &agtv) == NULL)
+        if (!gtype_container_has_key(&agt->root, VARDATA_ANY(key_datums[i]), VARSIZE_ANY_EXHDR(key_datums[i])))
             PG_RETURN_BOOL(false);
     }
 
     PG_RETURN_BOOL(true);
 }
 
+/*
+ * Planner support for the ?, ?| and ?& operators. They only look at the
+ * properties, so when the vertex is built by build_vertex() from a label
+ * table's columns, rewrite them to the gtype operator on the properties
+ * column, which a GIN index on that column can answer.
+ */
+PG_FUNCTION_INFO_V1(vertex_exists_support);
+Datum
+vertex_exists_support(PG_FUNCTION_ARGS) {
+    Node *rawreq = (Node *) PG_GETARG_POINTER(0);
+    SupportRequestSimplify *req;
+    FuncExpr *func;
+    FuncExpr *build;
+    char *opname;
+    Oid right_type;
+    Oid opno;
+
+    if (!IsA(rawreq, SupportRequestSimplify))
+        PG_RETURN_POINTER(NULL);
+
+    req = (SupportRequestSimplify *) rawreq;
+    func = req->fcall;
+
+    if (list_length(func->args) != 2 || !IsA(linitial(func->args), FuncExpr))
+        PG_RETURN_POINTER(NULL);
+
+    /*
+     * Only a label table's properties column is rewritten. The id of a label
+     * table's row is never null, so dropping build_vertex() can't change a
+     * null result.
+     */
+    build = linitial(func->args);
+    if (list_length(build->args) != 3 || !is_oid_ag_func(build->funcid, "build_vertex") ||
+        !is_label_column(lthird(build->args), req->root, Anum_ag_label_vertex_table_properties))
+        PG_RETURN_POINTER(NULL);
+
+    if (is_oid_ag_func(func->funcid, "vertex_exists")) {
+        opname = "?";
+        right_type = TEXTOID;
+    } else if (is_oid_ag_func(func->funcid, "vertex_exists_any")) {
+        opname = "?|";
+        right_type = TEXTARRAYOID;
+    } else if (is_oid_ag_func(func->funcid, "vertex_exists_all")) {
+        opname = "?&";
+        right_type = TEXTARRAYOID;
+    } else {
+        PG_RETURN_POINTER(NULL);
+    }
+
+    opno = OpernameGetOprid(list_make2(makeString(CATALOG_SCHEMA), makeString(opname)),
+                            GTYPEOID, right_type);
+    if (!OidIsValid(opno))
+        PG_RETURN_POINTER(NULL);
+
+    PG_RETURN_POINTER(make_opclause(opno, BOOLOID, false, (Expr *) lthird(build->args),
+                                    (Expr *) lsecond(func->args), InvalidOid,
+                                    func->inputcollid));
+}
+
+/*
+ * Planner support for the vertex accessors. The vertices a MATCH produces
+ * are build_vertex() calls over the label table's columns, and once the
+ * subquery is pulled up id(), properties() and property access can read
+ * those columns directly. The vertex is then only built where it is
+ * returned whole, and the joins, sorts and hash tables below carry the
+ * graphid, plus the properties column only where it is read.
+ */
+PG_FUNCTION_INFO_V1(vertex_accessor_support);
+Datum
+vertex_accessor_support(PG_FUNCTION_ARGS) {
+    Node *rawreq = (Node *) PG_GETARG_POINTER(0);
+    SupportRequestSimplify *req;
+    FuncExpr *func;
+    FuncExpr *build;
+    Node *id;
+    Node *props;
+    FuncExpr *result;
+
+    if (!IsA(rawreq, SupportRequestSimplify))
+        PG_RETURN_POINTER(NULL);
+
+    req = (SupportRequestSimplify *) rawreq;
+    func = req->fcall;
+
+    if (list_length(func->args) < 1 || !IsA(linitial(func->args), FuncExpr))
+        PG_RETURN_POINTER(NULL);
+
+    // as in vertex_exists_support, only a label table's columns are read directly
+    build = linitial(func->args);
+    if (list_length(build->args) != 3 || !is_oid_ag_func(build->funcid, "build_vertex") ||
+        !is_label_column(linitial(build->args), req->root, Anum_ag_label_vertex_table_id) ||
+        !is_label_column(lthird(build->args), req->root, Anum_ag_label_vertex_table_properties))
+        PG_RETURN_POINTER(NULL);
+
+    id = linitial(build->args);
+    props = lthird(build->args);
+
+    if (is_oid_ag_func(func->funcid, "id")) {
+        result = makeFuncExpr(get_ag_func_oid("graphid_to_gtype", 1, GRAPHIDOID), GTYPEOID,
+                              list_make1(id), InvalidOid, InvalidOid, COERCE_EXPLICIT_CALL);
+    } else if (is_oid_ag_func(func->funcid, "properties") || is_oid_ag_func(func->funcid, "age_properties")) {
+        PG_RETURN_POINTER(props);
+    } else if (is_oid_ag_func(func->funcid, "vertex_property_access")) {
+        result = makeFuncExpr(get_ag_func_oid("gtype_object_field", 2, GTYPEOID, TEXTOID), GTYPEOID,
+                              list_make2(props, lsecond(func->args)), InvalidOid, func->inputcollid,
+                              COERCE_EXPLICIT_CALL);
+    } else if (is_oid_ag_func(func->funcid, "vertex_property_access_gtype")) {
+        result = makeFuncExpr(get_ag_func_oid("gtype_field_access", 2, GTYPEOID, GTYPEOID), GTYPEOID,
+                              list_make2(props, lsecond(func->args)), InvalidOid, func->inputcollid,
+                              COERCE_EXPLICIT_CALL);
+    } else if (is_oid_ag_func(func->funcid, "vertex_property_access_text")) {
+        result = makeFuncExpr(get_ag_func_oid("gtype_object_field_text", 2, GTYPEOID, TEXTOID), TEXTOID,
+                              list_make2(props, lsecond(func->args)), InvalidOid, func->inputcollid,
+                              COERCE_EXPLICIT_CALL);
+    } else {
+        PG_RETURN_POINTER(NULL);
+    }
+
+    result->location = func->location;
+
+    PG_RETURN_POINTER(result);
+}
+
 /*
  * Functions
  */
@@ -349,15 +463,13 @@ append_to_buffer(StringInfo buffer, const char *data, int len) {
 char *
 extract_vertex_label(vertex *v) {
     graphid id = EXTRACT_VERTEX_ID(v);
-    int32 label_id = get_graphid_label_id(id);
-
     Oid graph_oid = EXTRACT_VERTEX_GRAPH_OID(v);
 
-    label_cache_data *cache_data = search_label_graph_oid_cache(graph_oid, label_id);
-    char *label = NameStr(cache_data->name);
+    char *label = search_label_name_array_cache(graph_oid, GET_LABEL_ID(id));
 
-    if (IS_AG_DEFAULT_LABEL(label))
-	    return "";
+    if (label == NULL)
+        ereport(ERROR, (errcode(ERRCODE_UNDEFINED_OBJECT),
+                        errmsg("label for graphid %ld does not exist", id)));
 
     return label;
 }
@@ -32,6 +32,7 @@
 #include "utils/syscache.h"
 
 #include "catalog/ag_namespace.h"
+#include "utils/ag_cache.h"
 #include "utils/ag_func.h"
 
 // checks that func_oid is of func_name function in CATALOG_SCHEMA
@@ -68,7 +69,6 @@ Oid get_ag_func_oid(const char *func_name, const int nargs, ...)
     Oid oids[FUNC_MAX_ARGS];
     va_list ap;
     int i;
-    oidvector *arg_types;
     Oid func_oid;
 
     AssertArg(func_name);
@@ -79,12 +79,8 @@ Oid get_ag_func_oid(const char *func_name, const int nargs, ...)
         oids[i] = va_arg(ap, Oid);
     va_end(ap);
 
-    arg_types = buildoidvector(oids, nargs);
-
-    func_oid = GetSysCacheOid3(PROCNAMEARGSNSP, Anum_pg_proc_oid,
-                               CStringGetDatum(func_name),
-                               PointerGetDatum(arg_types),
-                               ObjectIdGetDatum(postgraph_namespace_id()));
+    func_oid = search_func_oid_cache(func_name, postgraph_namespace_id(), nargs,
+                                     oids);
     if (!OidIsValid(func_oid))
     {
         ereport(ERROR, (errmsg_internal("ag function does not exist"),
@@ -99,7 +95,6 @@ Oid get_pg_func_oid(const char *func_name, const int nargs, ...)
     Oid oids[FUNC_MAX_ARGS];
     va_list ap;
     int i;
-    oidvector *arg_types;
     Oid func_oid;
 
     AssertArg(func_name);
@@ -110,12 +105,8 @@ Oid get_pg_func_oid(const char *func_name, const int nargs, ...)
         oids[i] = va_arg(ap, Oid);
     va_end(ap);
 
-    arg_types = buildoidvector(oids, nargs);
-
-    func_oid = GetSysCacheOid3(PROCNAMEARGSNSP, Anum_pg_proc_oid,
-                               CStringGetDatum(func_name),
-                               PointerGetDatum(arg_types),
-                               ObjectIdGetDatum(pg_catalog_namespace_id()));
+    func_oid = search_func_oid_cache(func_name, pg_catalog_namespace_id(), nargs,
+                                     oids);
     if (!OidIsValid(func_oid))
     {
         ereport(ERROR, (errmsg_internal("pg function does not exist"),
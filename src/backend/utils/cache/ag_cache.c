@@ -27,7 +27,10 @@
 #include "access/skey.h"
 #include "access/stratnum.h"
 #include "access/tupdesc.h"
+#include "catalog/namespace.h"
 #include "catalog/pg_collation.h"
+#include "catalog/pg_proc.h"
+#include "catalog/pg_type.h"
 #include "fmgr.h"
 #include "storage/lockdefs.h"
 #include "utils/builtins.h"
@@ -40,8 +43,11 @@
 #include "utils/relcache.h"
 #include "utils/syscache.h"
 
+#include "postgraph.h"
+
 #include "catalog/ag_graph.h"
 #include "catalog/ag_label.h"
+#include "commands/label_commands.h"
 #include "utils/ag_cache.h"
 #include "utils/graphid.h"
 
@@ -87,6 +93,34 @@ typedef struct label_relation_cache_entry
     label_cache_data data;
 } label_relation_cache_entry;
 
+typedef struct label_name_array_slot
+{
+    bool valid;
+    Oid relation;
+    char *name;
+} label_name_array_slot;
+
+typedef struct label_name_array_cache_entry
+{
+    Oid graph; // hash key
+    int32 size;
+    label_name_array_slot *slots; // indexed by ag_label.id
+} label_name_array_cache_entry;
+
+typedef struct func_oid_cache_key
+{
+    NameData name;
+    Oid namespace;
+    int nargs;
+    Oid arg_types[FUNC_MAX_ARGS];
+} func_oid_cache_key;
+
+typedef struct func_oid_cache_entry
+{
+    func_oid_cache_key key; // hash key
+    Oid oid;
+} func_oid_cache_entry;
+
 // ag_graph.name
 static HTAB *graph_name_cache_hash = NULL;
 static ScanKeyData graph_name_scan_keys[1];
@@ -107,6 +141,34 @@ static ScanKeyData label_graph_oid_scan_keys[2];
 static HTAB *label_relation_cache_hash = NULL;
 static ScanKeyData label_relation_scan_keys[1];
 
+// ag_label.graph, ag_label.id -> label name for output
+static HTAB *label_name_array_cache_hash = NULL;
+static MemoryContext label_name_array_cache_mcxt = NULL;
+static label_name_array_cache_entry *last_label_name_array = NULL;
+
+// pg_namespace.oid of CATALOG_SCHEMA
+static Oid ag_namespace_oid = InvalidOid;
+
+// pg_type.oid of the extension types, indexed by ag_type_id
+static Oid type_oid_cache[AG_TYPE_COUNT];
+static const char *const type_oid_cache_names[AG_TYPE_COUNT] = {
+    [AG_TYPE_GRAPHID] = "graphid",
+    [AG_TYPE_GRAPHIDARRAY] = "_graphid",
+    [AG_TYPE_GTYPE] = "gtype",
+    [AG_TYPE_GTYPEARRAY] = "_gtype",
+    [AG_TYPE_VERTEX] = "vertex",
+    [AG_TYPE_VERTEXARRAY] = "_vertex",
+    [AG_TYPE_EDGE] = "edge",
+    [AG_TYPE_EDGEARRAY] = "_edge",
+    [AG_TYPE_VARIABLEEDGE] = "variable_edge",
+    [AG_TYPE_VARIABLEEDGEARRAY] = "_variable_edge",
+    [AG_TYPE_TRAVERSAL] = "traversal",
+    [AG_TYPE_TRAVERSALARRAY] = "_traversal"
+};
+
+// pg_proc.proname, pg_proc.proargtypes, pg_proc.pronamespace
+static HTAB *func_oid_cache_hash = NULL;
+
 // initialize all caches
 static void initialize_caches(void);
 
@@ -135,6 +197,7 @@ static void create_label_caches(void);
 static void create_label_name_graph_cache(void);
 static void create_label_graph_oid_cache(void);
 static void create_label_relation_cache(void);
+static void create_label_name_array_cache(void);
 static void invalidate_label_caches(Datum arg, Oid relid);
 static void invalidate_label_name_graph_cache(Oid relid);
 static void flush_label_name_graph_cache(void);
@@ -142,6 +205,9 @@ static void invalidate_label_graph_oid_cache(Oid relid);
 static void flush_label_graph_oid_cache(void);
 static void invalidate_label_relation_cache(Oid relid);
 static void flush_label_relation_cache(void);
+static void invalidate_label_name_array_cache(Oid relid);
+static label_name_array_slot *search_label_name_array_cache_miss(
+    label_name_array_cache_entry *entry, Oid graph, int32 id);
 static label_cache_data *search_label_name_graph_cache_miss(Name name,
                                                             Oid graph);
 static void *label_name_graph_cache_hash_search(Name name, Oid graph,
@@ -154,6 +220,16 @@ static label_cache_data *search_label_relation_cache_miss(Oid relation);
 static void fill_label_cache_data(label_cache_data *cache_data,
                                   HeapTuple tuple, TupleDesc tuple_desc);
 
+// pg_namespace, pg_type and pg_proc
+static void initialize_oid_caches(void);
+static void create_func_oid_cache(void);
+static void invalidate_namespace_oid_cache(Datum arg, int cache_id,
+                                           uint32 hash_value);
+static void invalidate_type_oid_cache(Datum arg, int cache_id,
+                                      uint32 hash_value);
+static void invalidate_func_oid_cache(Datum arg, int cache_id,
+                                      uint32 hash_value);
+
 static void initialize_caches(void)
 {
     static bool initialized = false;
@@ -166,6 +242,7 @@ static void initialize_caches(void)
 
     initialize_graph_caches();
     initialize_label_caches();
+    initialize_oid_caches();
 
     initialized = true;
 }
@@ -496,6 +573,7 @@ static void create_label_caches(void)
     create_label_name_graph_cache();
     create_label_graph_oid_cache();
     create_label_relation_cache();
+    create_label_name_array_cache();
 }
 
 static void create_label_name_graph_cache(void)
@@ -548,6 +626,31 @@ static void create_label_relation_cache(void)
                                             &hash_ctl, HASH_ELEM | HASH_BLOBS);
 }
 
+static void create_label_name_array_cache(void)
+{
+    HASHCTL hash_ctl;
+
+    /*
+     * The label name arrays are allocated in their own context so they can
+     * be grown without touching the other caches.
+     */
+    label_name_array_cache_mcxt = AllocSetContextCreate(
+        CacheMemoryContext, "ag_label (graph, id) name array cache",
+        ALLOCSET_SMALL_SIZES);
+
+    MemSet(&hash_ctl, 0, sizeof(hash_ctl));
+    hash_ctl.keysize = sizeof(Oid);
+    hash_ctl.entrysize = sizeof(label_name_array_cache_entry);
+
+    /*
+     * Please see the comment of hash_create() for the nelem value 16 here.
+     * HASH_BLOBS flag is set because the size of the key is sizeof(uint32).
+     */
+    label_name_array_cache_hash = hash_create(
+        "ag_label (graph) name array cache", 16, &hash_ctl,
+        HASH_ELEM | HASH_BLOBS);
+}
+
 static void invalidate_label_caches(Datum arg, Oid relid)
 {
     Assert(label_name_graph_cache_hash);
@@ -564,6 +667,8 @@ static void invalidate_label_caches(Datum arg, Oid relid)
         flush_label_graph_oid_cache();
         flush_label_relation_cache();
     }
+
+    invalidate_label_name_array_cache(relid);
 }
 
 static void invalidate_label_name_graph_cache(Oid relid)
@@ -932,6 +1037,129 @@ static label_cache_data *search_label_relation_cache_miss(Oid relation)
     return entry;
 }
 
+/*
+ * Marks the slots of the given label relation, or all slots if relid is
+ * InvalidOid, as invalid.
+ *
+ * The name strings are not freed: a caller may still hold a name returned
+ * before the invalidation (e.g. across a table_open()). When a slot is
+ * filled again with an unchanged name, the old string is reused, so only
+ * renamed labels leave a string behind.
+ */
+static void invalidate_label_name_array_cache(Oid relid)
+{
+    HASH_SEQ_STATUS hash_seq;
+
+    hash_seq_init(&hash_seq, label_name_array_cache_hash);
+    for (;;)
+    {
+        label_name_array_cache_entry *entry;
+
+        entry = hash_seq_search(&hash_seq);
+        if (!entry)
+            break;
+
+        for (int32 i = 0; i < entry->size; i++)
+        {
+            if (!OidIsValid(relid) || entry->slots[i].relation == relid)
+                entry->slots[i].valid = false;
+        }
+    }
+}
+
+/*
+ * Returns the name of the label with the given id in the given graph as it
+ * is shown in vertex and edge output, i.e. "" for the default labels. This
+ * is on the output path of every vertex and edge, so the label names are
+ * kept in a flat array per graph indexed by label id. Returns NULL if the
+ * label does not exist.
+ */
+char *search_label_name_array_cache(Oid graph, int32 id)
+{
+    label_name_array_cache_entry *entry = last_label_name_array;
+    label_name_array_slot *slot;
+
+    if (entry == NULL || entry->graph != graph)
+    {
+        bool found;
+
+        initialize_caches();
+
+        entry = hash_search(label_name_array_cache_hash, &graph, HASH_ENTER,
+                            &found);
+        if (!found)
+        {
+            entry->size = 0;
+            entry->slots = NULL;
+        }
+
+        last_label_name_array = entry;
+    }
+
+    if (id >= 0 && id < entry->size && entry->slots[id].valid)
+        return entry->slots[id].name;
+
+    slot = search_label_name_array_cache_miss(entry, graph, id);
+
+    return slot ? slot->name : NULL;
+}
+
+static label_name_array_slot *search_label_name_array_cache_miss(
+    label_name_array_cache_entry *entry, Oid graph, int32 id)
+{
+    label_cache_data *cache_data;
+    label_name_array_slot *slot;
+    const char *name;
+
+    if (!label_id_is_valid(id))
+        return NULL;
+
+    /*
+     * This might process invalidation messages, which only mark slots as
+     * invalid, so entry stays valid.
+     */
+    cache_data = search_label_graph_oid_cache(graph, id);
+    if (!cache_data)
+        return NULL;
+
+    if (id >= entry->size)
+    {
+        int32 new_size = Max(entry->size, 16);
+
+        while (new_size <= id)
+            new_size *= 2;
+        new_size = Min(new_size, LABEL_ID_MAX + 1);
+
+        if (entry->slots == NULL)
+        {
+            entry->slots = MemoryContextAllocZero(
+                label_name_array_cache_mcxt,
+                new_size * sizeof(label_name_array_slot));
+        }
+        else
+        {
+            entry->slots = repalloc(entry->slots,
+                                    new_size * sizeof(label_name_array_slot));
+            MemSet(&entry->slots[entry->size], 0,
+                   (new_size - entry->size) * sizeof(label_name_array_slot));
+        }
+
+        entry->size = new_size;
+    }
+
+    name = NameStr(cache_data->name);
+    if (IS_AG_DEFAULT_LABEL(name))
+        name = "";
+
+    slot = &entry->slots[id];
+    if (slot->name == NULL || strcmp(slot->name, name) != 0)
+        slot->name = MemoryContextStrdup(label_name_array_cache_mcxt, name);
+    slot->relation = cache_data->relation;
+    slot->valid = true;
+
+    return slot;
+}
+
 static void fill_label_cache_data(label_cache_data *cache_data,
                                   HeapTuple tuple, TupleDesc tuple_desc)
 {
@@ -962,3 +1190,150 @@ static void fill_label_cache_data(label_cache_data *cache_data,
     Assert(!is_null);
     cache_data->relation = DatumGetObjectId(value);
 }
+
+static void initialize_oid_caches(void)
+{
+    MemSet(type_oid_cache, 0, sizeof(type_oid_cache));
+
+    create_func_oid_cache();
+
+    /*
+     * The cached OIDs only change when the extension is dropped and created
+     * again, which is seen as invalidation events of the catalogs they come
+     * from.
+     */
+    CacheRegisterSyscacheCallback(NAMESPACEOID, invalidate_namespace_oid_cache,
+                                  (Datum)0);
+    CacheRegisterSyscacheCallback(TYPEOID, invalidate_type_oid_cache,
+                                  (Datum)0);
+    CacheRegisterSyscacheCallback(PROCOID, invalidate_func_oid_cache,
+                                  (Datum)0);
+}
+
+static void create_func_oid_cache(void)
+{
+    HASHCTL hash_ctl;
+
+    MemSet(&hash_ctl, 0, sizeof(hash_ctl));
+    hash_ctl.keysize = sizeof(func_oid_cache_key);
+    hash_ctl.entrysize = sizeof(func_oid_cache_entry);
+
+    /*
+     * Please see the comment of hash_create() for the nelem value 16 here.
+     * HASH_BLOBS flag is set because the key for this hash is fixed-size.
+     */
+    func_oid_cache_hash = hash_create("pg_proc (name, args, namespace) cache",
+                                      16, &hash_ctl, HASH_ELEM | HASH_BLOBS);
+}
+
+static void invalidate_namespace_oid_cache(Datum arg, int cache_id,
+                                           uint32 hash_value)
+{
+    ag_namespace_oid = InvalidOid;
+}
+
+static void invalidate_type_oid_cache(Datum arg, int cache_id,
+                                      uint32 hash_value)
+{
+    /*
+     * hash_value is for an entry in TYPEOID cache, not for the type name, so
+     * all entries are reset. They are cheap to look up again.
+     */
+    MemSet(type_oid_cache, 0, sizeof(type_oid_cache));
+}
+
+static void invalidate_func_oid_cache(Datum arg, int cache_id,
+                                      uint32 hash_value)
+{
+    HASH_SEQ_STATUS hash_seq;
+
+    Assert(func_oid_cache_hash);
+
+    hash_seq_init(&hash_seq, func_oid_cache_hash);
+    for (;;)
+    {
+        func_oid_cache_entry *entry;
+        void *removed;
+
+        entry = hash_seq_search(&hash_seq);
+        if (!entry)
+            break;
+
+        removed = hash_search(func_oid_cache_hash, &entry->key, HASH_REMOVE,
+                              NULL);
+        if (!removed)
+            ereport(ERROR, (errmsg_internal("function oid cache corrupted")));
+    }
+}
+
+Oid search_namespace_oid_cache(void)
+{
+    initialize_caches();
+
+    if (!OidIsValid(ag_namespace_oid))
+        ag_namespace_oid = get_namespace_oid(CATALOG_SCHEMA, false);
+
+    return ag_namespace_oid;
+}
+
+/*
+ * Only valid OIDs are cached, so a lookup done while the extension is being
+ * created, before the type exists, is repeated on the next call.
+ */
+Oid search_type_oid_cache(ag_type_id type)
+{
+    AssertArg(type >= 0 && type < AG_TYPE_COUNT);
+
+    initialize_caches();
+
+    if (!OidIsValid(type_oid_cache[type]))
+    {
+        type_oid_cache[type] = GetSysCacheOid2(
+            TYPENAMENSP, Anum_pg_type_oid,
+            CStringGetDatum(type_oid_cache_names[type]),
+            ObjectIdGetDatum(search_namespace_oid_cache()));
+    }
+
+    return type_oid_cache[type];
+}
+
+Oid search_func_oid_cache(const char *name, Oid namespace, int nargs,
+                          const Oid *arg_types)
+{
+    func_oid_cache_key key;
+    func_oid_cache_entry *entry;
+    oidvector *arg_vector;
+    Oid oid;
+    bool found;
+
+    AssertArg(name);
+    AssertArg(nargs >= 0 && nargs <= FUNC_MAX_ARGS);
+
+    initialize_caches();
+
+    // the key is hashed as a blob, so unused bytes must be zeroed
+    MemSet(&key, 0, sizeof(key));
+    namestrcpy(&key.name, name);
+    key.namespace = namespace;
+    key.nargs = nargs;
+    memcpy(key.arg_types, arg_types, nargs * sizeof(Oid));
+
+    entry = hash_search(func_oid_cache_hash, &key, HASH_FIND, NULL);
+    if (entry)
+        return entry->oid;
+
+    arg_vector = buildoidvector(arg_types, nargs);
+    oid = GetSysCacheOid3(PROCNAMEARGSNSP, Anum_pg_proc_oid,
+                          CStringGetDatum(name), PointerGetDatum(arg_vector),
+                          ObjectIdGetDatum(namespace));
+    pfree(arg_vector);
+
+    if (!OidIsValid(oid))
+        return InvalidOid;
+
+    entry = hash_search(func_oid_cache_hash, &key, HASH_ENTER, &found);
+    Assert(!found); // no concurrent update on func_oid_cache_hash
+    entry->oid = oid;
+
+    return oid;
+}
@@ -103,6 +103,8 @@ static void create_hashtables(graph_context *ggctx);
 static void load_hashtables(graph_context *ggctx);
 static void load_vertex_hashtable(graph_context *ggctx);
 static void load_edge_hashtable(graph_context *ggctx);
+static void load_edge_relation(graph_context *ggctx, Oid label_oid,
+                               Oid relation, Snapshot snapshot);
 static void freeze_hashtables(graph_context *ggctx);
 static List *get_labels(Snapshot snapshot, Oid graph_oid, char label_type);
 static bool insert_edge(graph_context *ggctx, graphid id, Datum properties, graphid start_id, graphid end_id, Oid oid);
@@ -327,7 +329,7 @@ static void load_vertex_hashtable(graph_context *ggctx) {
         
         Oid oid = get_relname_relid(label_name, graph_namespace_oid);
        
-        Relation graph_vertex_label = table_open(oid, ShareLock);
+        Relation graph_vertex_label = table_open(get_label_storage_relation(oid), ShareLock);
         scan_desc = table_beginscan(graph_vertex_label, snapshot, 0, NULL);
       
         tupdesc = RelationGetDescr(graph_vertex_label);
@@ -393,50 +395,62 @@ static void load_edge_hashtable(graph_context *ggctx) {
     labels = get_labels(snapshot, graph_oid, LABEL_TYPE_EDGE);
 
     foreach (lc, labels) {
-        HeapTuple tuple;
         char *label = lfirst(lc);
-
         Oid oid = get_relname_relid(label, graph_namespace_oid);
-        Relation graph_edge_label = table_open(oid, ShareLock);
-        TableScanDesc scan_desc = table_beginscan(graph_edge_label, snapshot, 0, NULL);
-        TupleDesc tupdesc = RelationGetDescr(graph_edge_label);
-        Assert (tupdesc->natts == 4);
-
-        while((tuple = heap_getnext(scan_desc, ForwardScanDirection)) != NULL) {
-	    graphid id, start_id, end_id;
-            Datum properties;
-            bool inserted = false;
-            bool isnull;
-            HeapTupleHeader hth;
-            HeapTupleData tmptup, *htd;
+        ListCell *lc2;
 
-            hth = tuple->t_data;
-            tmptup.t_len = HeapTupleHeaderGetDatumLength(hth);
-            tmptup.t_data = hth;
-            htd = &tmptup;
-
-            Assert(HeapTupleIsValid(tuple));
-            // id
-            id = DATUM_GET_GRAPHID(heap_getattr(htd, 1, tupdesc, &isnull));
-            // start_id
-            start_id = DATUM_GET_GRAPHID(heap_getattr(htd, 2, tupdesc, &isnull));
-            // end_id
-            end_id = DATUM_GET_GRAPHID(heap_getattr(htd, 3, tupdesc, &isnull));
-            // properties
-            properties = heap_getattr(htd, 4, tupdesc, &isnull);
+        // a hash partitioned label is loaded one partition at a time
+        foreach (lc2, get_label_storage_relations(oid))
+            load_edge_relation(ggctx, oid, lfirst_oid(lc2), snapshot);
+    }
+}
 
-            /* insert edge into edge hashtable */
-            inserted = insert_edge(ggctx, id, properties, start_id, end_id, oid);
-            Assert (inserted);
+/*
+ * Helper function to load the edges stored in the given relation, which holds
+ * rows of the edge label backed by label_oid.
+ */
+static void load_edge_relation(graph_context *ggctx, Oid label_oid,
+                               Oid relation, Snapshot snapshot) {
+    HeapTuple tuple;
+    Relation graph_edge_label = table_open(relation, ShareLock);
+    TableScanDesc scan_desc = table_beginscan(graph_edge_label, snapshot, 0, NULL);
+    TupleDesc tupdesc = RelationGetDescr(graph_edge_label);
+    Assert (tupdesc->natts == 4);
 
-            /* insert the edge into the start and end vertices edge lists */
-            insert_vertex(ggctx, start_id, end_id, id);
-        }
+    while((tuple = heap_getnext(scan_desc, ForwardScanDirection)) != NULL) {
+        graphid id, start_id, end_id;
+        Datum properties;
+        bool inserted = false;
+        bool isnull;
+        HeapTupleHeader hth;
+        HeapTupleData tmptup, *htd;
+
+        hth = tuple->t_data;
+        tmptup.t_len = HeapTupleHeaderGetDatumLength(hth);
+        tmptup.t_data = hth;
+        htd = &tmptup;
 
-        /* end the scan and close the relation */
-        table_endscan(scan_desc);
-        table_close(graph_edge_label, ShareLock);
+        Assert(HeapTupleIsValid(tuple));
+        // id
+        id = DATUM_GET_GRAPHID(heap_getattr(htd, 1, tupdesc, &isnull));
+        // start_id
+        start_id = DATUM_GET_GRAPHID(heap_getattr(htd, 2, tupdesc, &isnull));
+        // end_id
+        end_id = DATUM_GET_GRAPHID(heap_getattr(htd, 3, tupdesc, &isnull));
+        // properties
+        properties = heap_getattr(htd, 4, tupdesc, &isnull);
+
+        /* insert edge into edge hashtable */
+        inserted = insert_edge(ggctx, id, properties, start_id, end_id, label_oid);
+        Assert (inserted);
+
+        /* insert the edge into the start and end vertices edge lists */
+        insert_vertex(ggctx, start_id, end_id, id);
     }
+
+    /* end the scan and close the relation */
+    table_endscan(scan_desc);
+    table_close(graph_edge_label, ShareLock);
 }
 
 static void freeze_hashtables(graph_context *ggctx) {
@@ -43,6 +43,14 @@
 #define EXISTS_HTAB_NAME "known edges"
 #define EXISTS_HTAB_NAME_INITIAL_SIZE 1000
 #define MAXIMUM_NUMBER_OF_CACHED_LOCAL_CONTEXTS 5
+/*
+ * The dfs is only started from the end vertex when the start vertex has more
+ * than VLE_REVERSE_MIN_DEGREE edges to follow and the end vertex has less than
+ * 1/VLE_REVERSE_DEGREE_RATIO of them. Below that, the order the paths are
+ * returned in is kept as is.
+ */
+#define VLE_REVERSE_MIN_DEGREE 8
+#define VLE_REVERSE_DEGREE_RATIO 2
 
 // edge state entry for the edge_state_hashtable 
 typedef struct edge_state_entry
@@ -64,6 +72,7 @@ typedef struct path_finding_context
     int64 uidx;                    // upper (end) bound index 
     bool uidx_infinite;            // flag if the upper bound is omitted 
     cypher_rel_dir edge_direction; // the direction of the edge 
+    bool reversed;                 // vsid and veid were swapped for the dfs 
     HTAB *edge_state_hashtable;    // local state hashtable for our edges 
     HTAB *exists_hash;
     Queue *dfs_vertex_queue; // dfs queue for vertices 
@@ -100,6 +109,8 @@ static edge_state_entry *get_edge_state(path_finding_context *path_ctx, graphid
 static void load_initial_dfs_queues(path_finding_context *path_ctx);
 static bool dfs_find_a_path_between(path_finding_context *path_ctx);
 static bool do_vsid_and_veid_exist(path_finding_context *path_ctx);
+static int64 get_traversal_degree(path_finding_context *path_ctx, graphid vertex_id, cypher_rel_dir edge_direction);
+static void choose_traversal_direction(path_finding_context *path_ctx);
 static void add_edges(path_finding_context *path_ctx, graphid vertex_id);
 static graphid get_next_vertex(path_finding_context *path_ctx, edge_entry *ee);
 // VLE path and edge building functions 
@@ -107,12 +118,6 @@ static path_container *create_path_container(int64 path_size);
 static path_container *build_path_container(path_finding_context *path_ctx);
 VariableEdge *create_variable_edge(path_container *vpc);
 
-static void 
-append_to_buffer(StringInfo buffer, const char *data, int len) {
-    int offset = reserve_from_buffer(buffer, len);
-    memcpy(buffer->data + offset, data, len);
-}
-
 
 // helper function to create the local VLE edge state hashtable. 
 static void create_hashtable(path_finding_context *path_ctx) {
@@ -201,12 +206,81 @@ static bool do_vsid_and_veid_exist(path_finding_context *path_ctx)
     return ((get_vertex_entry(path_ctx->ggctx, path_ctx->vsid) != NULL) && (get_vertex_entry(path_ctx->ggctx, path_ctx->veid) != NULL));
 }
 
+/*
+ * Helper function to get the number of edges add_edges would look at for the
+ * given vertex when traversing in the given direction.
+ */
+static int64 get_traversal_degree(path_finding_context *path_ctx, graphid vertex_id, cypher_rel_dir edge_direction)
+{
+    vertex_entry *ve = get_vertex_entry(path_ctx->ggctx, vertex_id);
+    Queue *edges = NULL;
+    int64 degree = 0;
+
+    if (edge_direction != CYPHER_REL_DIR_LEFT) {
+        edges = get_vertex_entry_edges_out(ve);
+        degree += (edges != NULL) ? queue_size(edges) : 0;
+    }
+
+    if (edge_direction != CYPHER_REL_DIR_RIGHT) {
+        edges = get_vertex_entry_edges_in(ve);
+        degree += (edges != NULL) ? queue_size(edges) : 0;
+    }
+
+    edges = get_vertex_entry_edges_self(ve);
+    degree += (edges != NULL) ? queue_size(edges) : 0;
+
+    return degree;
+}
+
+/*
+ * Both end points of the VLE edge are always bound, so the paths between them
+ * can be found starting from either one. Starting from a hub vertex is a lot
+ * more work than starting from a vertex with only a few edges, so start the
+ * dfs from the end vertex, against the edge direction, when its fan out is
+ * smaller. build_path_container() puts the path back in the right order.
+ */
+static void choose_traversal_direction(path_finding_context *path_ctx)
+{
+    cypher_rel_dir reverse_direction;
+    int64 start_degree;
+    int64 end_degree;
+    graphid temp;
+
+    switch (path_ctx->edge_direction) {
+        case CYPHER_REL_DIR_RIGHT:
+            reverse_direction = CYPHER_REL_DIR_LEFT;
+            break;
+        case CYPHER_REL_DIR_LEFT:
+            reverse_direction = CYPHER_REL_DIR_RIGHT;
+            break;
+        default:
+            reverse_direction = CYPHER_REL_DIR_NONE;
+            break;
+    }
+
+    start_degree = get_traversal_degree(path_ctx, path_ctx->vsid, path_ctx->edge_direction);
+    if (start_degree <= VLE_REVERSE_MIN_DEGREE)
+        return;
+
+    end_degree = get_traversal_degree(path_ctx, path_ctx->veid, reverse_direction);
+    if (end_degree * VLE_REVERSE_DEGREE_RATIO >= start_degree)
+        return;
+
+    temp = path_ctx->vsid;
+    path_ctx->vsid = path_ctx->veid;
+    path_ctx->veid = temp;
+    path_ctx->edge_direction = reverse_direction;
+    path_ctx->reversed = true;
+}
+
 // load the initial edges into the dfs_edge_queue 
 static void load_initial_dfs_queues(path_finding_context *path_ctx)
 {
     if (!do_vsid_and_veid_exist(path_ctx))
         return;
 
+    choose_traversal_direction(path_ctx);
+
     // add in the edges for the start vertex 
     add_edges(path_ctx, path_ctx->vsid);
 }
@@ -655,6 +729,19 @@ static path_container *build_path_container(path_finding_context *path_ctx) {
 	graphid_array[index+1] = vid;
     }
 
+    // the dfs ran from the end vertex, flip the path so it starts at vsid 
+    if (path_ctx->reversed) {
+        int64 left = 0;
+        int64 right = vpc->graphid_array_size - 1;
+
+        while (left < right) {
+            graphid temp = graphid_array[left];
+
+            graphid_array[left++] = graphid_array[right];
+            graphid_array[right--] = temp;
+        }
+    }
+
     // return the container 
     return vpc;
 }
@@ -726,9 +813,7 @@ Datum gtype_vle(PG_FUNCTION_ARGS) {
 }
 
 VariableEdge *create_variable_edge(path_container *vpc) {
-    StringInfoData buffer;
-    initStringInfo(&buffer);
-    int32 size;
+    path_builder pb;
 
     graphid *graphid_array = GET_GRAPHID_ARRAY_FROM_CONTAINER(vpc);
     int graphid_array_size = vpc->graphid_array_size;
@@ -737,10 +822,8 @@ VariableEdge *create_variable_edge(path_container *vpc) {
 
     Assert(ggctx != NULL);
 
-    // header
-    reserve_from_buffer(&buffer, VARHDRSZ);
-    size = graphid_array_size - 2;
-    append_to_buffer(&buffer, (char *)&size, sizeof(prentry));
+    // the path's first and last vertices are not part of the VariableEdge
+    init_variable_edge(&pb, graphid_array_size - 2);
 
     int cnt = 0;
     for (int index = 0; index < graphid_array_size; index += 2) {
@@ -753,8 +836,7 @@ VariableEdge *create_variable_edge(path_container *vpc) {
 	    gtype *prop = DATUM_GET_GTYPE_P(get_vertex_entry_properties(ve));
             Datum d = VERTEX_GET_DATUM(create_vertex(id, vpc->graph_oid, prop));
 
-            append_to_buffer(&buffer, DATUM_GET_VERTEX(d), VARSIZE(d));
-            cnt++;
+            append_variable_edge_entity(&pb, cnt++, DATUM_GET_VERTEX(d));
         }
         if (index + 1 == graphid_array_size)
                 break;
@@ -769,15 +851,10 @@ VariableEdge *create_variable_edge(path_container *vpc) {
         gtype *prop = DATUM_GET_GTYPE_P(get_edge_entry_properties(ee));
         Datum d = EDGE_GET_DATUM(create_edge(id, startid, endid, vpc->graph_oid, prop));
 
-        append_to_buffer(&buffer, DATUM_GET_EDGE(d), VARSIZE(d));
-        cnt++;
+        append_variable_edge_entity(&pb, cnt++, DATUM_GET_EDGE(d));
     }
 
-    VariableEdge *p = (VariableEdge *)buffer.data;
-
-    SET_VARSIZE(p, buffer.len);
-
-    return p;
+    return finish_path_builder(&pb);
 }
 
 // function checks the edges in a MATCH clause to see if they are unique or not.
@@ -821,19 +898,16 @@ Datum _ag_enforce_edge_uniqueness(PG_FUNCTION_ARGS) {
         }
 	else if (types[i] == VARIABLEEDGEOID) {
             VariableEdge *ve = DATUM_GET_VARIABLE_EDGE(args[i]);
-            char *ptr = &ve->children[1];
-            for (int i = 0; i < ve->children[0]; i++, ptr = ptr + VARSIZE(ptr)) {
-                if (i % 2 == 1) {
-                    continue;
-                } else {
-	            edge *e = (edge *)ptr;
-
-                    graphid i =  *((int64 *)(&e->children[0]));
-	            bool found;
-                    (int64 *)hash_search(exists_hash, (void *)&i, HASH_ENTER, &found);
-                    if (found)
-                        PG_RETURN_BOOL(false);
-	        }
+
+            // the edges are every other entity, starting with the first
+            for (int j = 0; j < VARIABLE_EDGE_SIZE(ve); j += 2) {
+	        edge *e = (edge *)get_variable_edge_entity(ve, j);
+
+                graphid edge_id =  *((int64 *)(&e->children[0]));
+	        bool found;
+                hash_search(exists_hash, (void *)&edge_id, HASH_ENTER, &found);
+                if (found)
+                    PG_RETURN_BOOL(false);
             }
 
 	}
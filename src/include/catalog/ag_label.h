@@ -23,8 +23,10 @@
 #include "postgres.h"
 
 #include "nodes/execnodes.h"
+#include "nodes/pathnodes.h"
 
 #include "catalog/ag_catalog.h"
+#include "utils/graphid.h"
 
 #define Anum_ag_label_vertex_table_id 1
 #define Anum_ag_label_vertex_table_properties 2
@@ -72,6 +74,10 @@ void delete_label(Oid relation);
 int32 get_label_id(const char *label_name, Oid graph_oid);
 Oid get_label_relation(const char *label_name, Oid graph_oid);
 char *get_label_relation_name(const char *label_name, Oid graph_oid);
+Oid get_label_storage_relation(Oid relation);
+List *get_label_storage_relations(Oid relation);
+Oid get_label_partition_for_start_id(Oid relation, graphid start_id);
+bool is_label_column(Node *node, PlannerInfo *root, AttrNumber attno);
 
 bool label_id_exists(Oid graph_oid, int32 label_id);
 RangeVar *get_label_range_var(char *graph_name, Oid graph_oid,
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2023 PostGraphDB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef AG_AG_LABEL_STATS_H
+#define AG_AG_LABEL_STATS_H
+
+#include "postgres.h"
+
+#include "catalog/ag_catalog.h"
+
+#define Anum_ag_label_stats_graph 1
+#define Anum_ag_label_stats_id 2
+#define Anum_ag_label_stats_row_count 3
+#define Anum_ag_label_stats_avg_out_degree 4
+#define Anum_ag_label_stats_max_out_degree 5
+#define Anum_ag_label_stats_avg_in_degree 6
+#define Anum_ag_label_stats_max_in_degree 7
+
+#define Natts_ag_label_stats 7
+
+#define Anum_ag_label_endpoint_stats_graph 1
+#define Anum_ag_label_endpoint_stats_id 2
+#define Anum_ag_label_endpoint_stats_start_label_id 3
+#define Anum_ag_label_endpoint_stats_end_label_id 4
+#define Anum_ag_label_endpoint_stats_row_count 5
+
+#define Natts_ag_label_endpoint_stats 5
+
+#define ag_label_stats_relation_id() \
+    ag_relation_id("ag_label_stats", "table")
+#define ag_label_stats_graph_id_index_id() \
+    ag_relation_id("ag_label_stats_graph_id_index", "index")
+#define ag_label_endpoint_stats_relation_id() \
+    ag_relation_id("ag_label_endpoint_stats", "table")
+#define ag_label_endpoint_stats_graph_id_index_id() \
+    ag_relation_id("ag_label_endpoint_stats_graph_id_index", "index")
+
+/*
+ * label_stats contains the same fields that ag_label_stats catalog table
+ * has. The degree fields are only set for edge labels: the out-degree is
+ * the number of edges of the label per distinct start vertex, the in-degree
+ * per distinct end vertex.
+ */
+typedef struct label_stats
+{
+    Oid graph;
+    int32 id;
+    int64 row_count;
+    bool has_degrees;
+    float8 avg_out_degree;
+    int64 max_out_degree;
+    float8 avg_in_degree;
+    int64 max_in_degree;
+} label_stats;
+
+void insert_label_stats(label_stats *stats);
+void insert_label_endpoint_stats(Oid graph_oid, int32 label_id,
+                                 int32 start_label_id, int32 end_label_id,
+                                 int64 row_count);
+void delete_label_stats(Oid graph_oid, int32 label_id);
+
+#endif
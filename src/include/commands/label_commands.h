@@ -56,5 +56,7 @@
 
 void create_label(char *graph_name, char *label_name, char label_type,
                   List *parents);
+void create_partitioned_label(char *graph_name, char *label_name,
+                              char label_type);
 
 #endif
@@ -103,6 +103,11 @@ TupleTableSlot *populate_edge_tts(
 
 ResultRelInfo *create_entity_result_rel_info(EState *estate, char *graph_name,
                                              char *label_name);
+List *create_entity_result_rel_infos(EState *estate, char *graph_name,
+                                     char *label_name);
+ResultRelInfo *route_edge_result_rel_info(EState *estate,
+                                          ResultRelInfo *resultRelInfo,
+                                          graphid start_id);
 void destroy_entity_result_rel_info(ResultRelInfo *result_rel_info);
 
 bool entity_exists(EState *estate, Oid graph_oid, graphid id);
@@ -40,6 +40,24 @@ typedef struct label_cache_data
     Oid relation;
 } label_cache_data;
 
+// extension types whose OIDs are cached, see search_type_oid_cache()
+typedef enum ag_type_id
+{
+    AG_TYPE_GRAPHID,
+    AG_TYPE_GRAPHIDARRAY,
+    AG_TYPE_GTYPE,
+    AG_TYPE_GTYPEARRAY,
+    AG_TYPE_VERTEX,
+    AG_TYPE_VERTEXARRAY,
+    AG_TYPE_EDGE,
+    AG_TYPE_EDGEARRAY,
+    AG_TYPE_VARIABLEEDGE,
+    AG_TYPE_VARIABLEEDGEARRAY,
+    AG_TYPE_TRAVERSAL,
+    AG_TYPE_TRAVERSALARRAY,
+    AG_TYPE_COUNT
+} ag_type_id;
+
 // callers of these functions must not modify the returned struct
 graph_cache_data *search_graph_name_cache(const char *name);
 graph_cache_data *search_graph_namespace_cache(Oid namespace);
@@ -47,5 +65,12 @@ label_cache_data *search_label_oid_cache(Oid oid);
 label_cache_data *search_label_name_graph_cache(const char *name, Oid graph);
 label_cache_data *search_label_graph_oid_cache(Oid graph, int32 id);
 label_cache_data *search_label_relation_cache(Oid relation);
+char *search_label_name_array_cache(Oid graph, int32 id);
+
+// backend-local OIDs of the extension's namespace, types and functions
+Oid search_namespace_oid_cache(void);
+Oid search_type_oid_cache(ag_type_id type);
+Oid search_func_oid_cache(const char *name, Oid namespace, int nargs,
+                          const Oid *arg_types);
 
 #endif
@@ -38,6 +38,7 @@
 
 #include "catalog/ag_namespace.h"
 #include "catalog/pg_type.h"
+#include "utils/ag_cache.h"
 #include "utils/graphid.h"
 #include "utils/gtype.h"
 
@@ -60,6 +61,7 @@ typedef uint32 eentry;
 #define EXTRACT_EDGE_ENDID(e) \
     (*((int64 *)(&((edge *)e)->children[4])))
 
+// needed for the label and by startNode()/endNode(), see vertex.h
 #define EXTRACT_EDGE_GRAPH_OID(v) \
     (*((Oid *)(&((edge *)v)->children[6])))
 
@@ -82,11 +84,9 @@ Datum build_edge(PG_FUNCTION_ARGS);
 edge *create_edge(graphid id,graphid start_id,graphid end_id, Oid graph_oid, gtype *properties);
 int extract_edge_label_length(edge *v);
 
-#define EDGEOID \
-    (GetSysCacheOid2(TYPENAMENSP, Anum_pg_type_oid, CStringGetDatum("edge"), ObjectIdGetDatum(postgraph_namespace_id())))
+#define EDGEOID (search_type_oid_cache(AG_TYPE_EDGE))
 
-#define EDGEARRAYOID \
-    (GetSysCacheOid2(TYPENAMENSP, Anum_pg_type_oid, CStringGetDatum("_edge"), ObjectIdGetDatum(postgraph_namespace_id())))
+#define EDGEARRAYOID (search_type_oid_cache(AG_TYPE_EDGEARRAY))
 
 
 #endif
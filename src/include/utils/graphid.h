@@ -28,6 +28,7 @@
 
 #include "catalog/ag_namespace.h"
 #include "catalog/pg_type.h"
+#include "utils/ag_cache.h"
 
 typedef int64 graphid;
 #define F_GRAPHIDEQ F_INT8EQ
@@ -54,10 +55,8 @@ typedef int64 graphid;
 #define AG_RETURN_GRAPHID(x) return GRAPHID_GET_DATUM(x)
 
 /* Oid accessors for GRAPHID */
-#define GRAPHIDOID \
-    (GetSysCacheOid2(TYPENAMENSP, Anum_pg_type_oid, CStringGetDatum("graphid"), ObjectIdGetDatum(postgraph_namespace_id())))
-#define GRAPHIDARRAYOID \
-    (GetSysCacheOid2(TYPENAMENSP, Anum_pg_type_oid, CStringGetDatum("_graphid"), ObjectIdGetDatum(postgraph_namespace_id())))
+#define GRAPHIDOID (search_type_oid_cache(AG_TYPE_GRAPHID))
+#define GRAPHIDARRAYOID (search_type_oid_cache(AG_TYPE_GRAPHIDARRAY))
 
 
 #define GET_LABEL_ID(id) \
@@ -47,6 +47,7 @@
 
 #include "catalog/ag_namespace.h"
 #include "catalog/pg_type.h"
+#include "utils/ag_cache.h"
 #include "utils/graphid.h"
 
 /* Tokens used when sequentially processing an gtype value */
@@ -440,11 +441,16 @@ uint32 get_gtype_offset(const gtype_container *agtc, int index);
 uint32 get_gtype_length(const gtype_container *agtc, int index);
 int compare_gtype_containers_orderability(gtype_container *a, gtype_container *b);
 gtype_value *find_gtype_value_from_container(gtype_container *container, uint32 flags, const gtype_value *key);
+bool gtype_container_has_key(gtype_container *container, char *key, int len);
+gtype *gtype_object_keys(gtype_container *container);
 gtype_value *get_ith_gtype_value_from_container(gtype_container *container, uint32 i);
 gtype_value *push_gtype_value(gtype_parse_state **pstate, gtype_iterator_token seq, gtype_value *agtval);
 gtype_iterator *gtype_iterator_init(gtype_container *container);
 gtype_iterator_token gtype_iterator_next(gtype_iterator **it, gtype_value *val, bool skip_nested);
 gtype *gtype_value_to_gtype(gtype_value *val);
+gtype *make_gtype_string(int len, char **data);
+gtype *make_gtype_integer(int64 i);
+gtype *make_gtype_float(float8 f);
 bool gtype_deep_contains(gtype_iterator **val, gtype_iterator **m_contained);
 void gtype_hash_scalar_value(const gtype_value *scalar_val, uint32 *hash);
 void gtype_hash_scalar_value_extended(const gtype_value *scalar_val, uint64 *hash, uint64 seed);
@@ -478,11 +484,9 @@ void add_gtype(Datum val, bool is_null, gtype_in_state *result, Oid val_type, bo
 
 Datum gtype_to_float8(PG_FUNCTION_ARGS);
 
-#define GTYPEOID \
-    (GetSysCacheOid2(TYPENAMENSP, Anum_pg_type_oid, CStringGetDatum("gtype"), ObjectIdGetDatum(postgraph_namespace_id())))
+#define GTYPEOID (search_type_oid_cache(AG_TYPE_GTYPE))
 
-#define GTYPEARRAYOID \
-    (GetSysCacheOid2(TYPENAMENSP, Anum_pg_type_oid, CStringGetDatum("_gtype"), ObjectIdGetDatum(postgraph_namespace_id())))
+#define GTYPEARRAYOID (search_type_oid_cache(AG_TYPE_GTYPEARRAY))
 
 Datum gtype_object_field_impl(FunctionCallInfo fcinfo, gtype *gtype_in, char *key, int key_len, bool as_text);
 
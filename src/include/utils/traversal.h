@@ -33,6 +33,7 @@
 
 #include "catalog/ag_namespace.h"
 #include "catalog/pg_type.h"
+#include "utils/ag_cache.h"
 #include "utils/graphid.h"
 
 /* Convenience macros */
@@ -55,11 +56,60 @@ typedef struct
     pentry children[FLEXIBLE_ARRAY_MEMBER];
 } traversal;
 
-#define TRAVERSALOID \
-    (GetSysCacheOid2(TYPENAMENSP, Anum_pg_type_oid, CStringGetDatum("traversal"), ObjectIdGetDatum(postgraph_namespace_id())))
+/*
+ * children[0] holds the number of entities, vertices and edges alternating.
+ * When TRAVERSAL_HAS_OFFSETS is set, it is followed by one pentry per entity
+ * holding the entity's byte offset from the start of the traversal, so any
+ * entity can be found without walking the ones before it. A vertex that occurs
+ * more than once in the path is stored once, and its offsets all point to
+ * that copy. Traversals written before the flag existed have the entities
+ * back to back right after the count.
+ */
+#define TRAVERSAL_COUNT_MASK  0x7FFFFFFF
+#define TRAVERSAL_HAS_OFFSETS 0x80000000
+
+#define TRAVERSAL_SIZE(t) ((t)->children[0] & TRAVERSAL_COUNT_MASK)
+
+/*
+ * Builds a traversal or a VariableEdge in buffer. vertices is an open
+ * addressing table, keyed by graphid, of the vertices stored so far, so a
+ * vertex the path returns to is found without comparing it to every vertex
+ * before it. A slot with an offset of 0 is empty.
+ */
+typedef struct path_vertex_slot
+{
+    graphid id;
+    uint32 offset;
+} path_vertex_slot;
+
+typedef struct path_builder
+{
+    StringInfoData buffer;
+    path_vertex_slot *vertices;
+    uint32 mask;
+} path_builder;
+
+void init_path_builder(path_builder *pb, int count, uint32 header);
+void append_path_entity(path_builder *pb, int i, char *entity, bool is_vertex);
+void *finish_path_builder(path_builder *pb);
+
+char *get_traversal_entity(traversal *t, int i);
+
+/*
+ * A VariableEdge is laid out like a traversal, so the comparison and hash
+ * support takes either. vertex_parity is the parity of the vertices' indexes:
+ * 0 for a traversal, 1 for a VariableEdge.
+ */
+int compare_paths(traversal *lhs, traversal *rhs, int vertex_parity);
+Datum hash_path(traversal *t, int vertex_parity);
+Datum hash_path_extended(traversal *t, int vertex_parity, uint64 seed);
+
+void init_traversal(path_builder *pb, int count);
+void append_traversal_entity(path_builder *pb, int i, char *entity);
+
+#define TRAVERSALOID (search_type_oid_cache(AG_TYPE_TRAVERSAL))
 
-#define TRAVERSALARRAYOID \
-    (GetSysCacheOid2(TYPENAMENSP, Anum_pg_type_oid, CStringGetDatum("_traversal"), ObjectIdGetDatum(postgraph_namespace_id())))
+#define TRAVERSALARRAYOID (search_type_oid_cache(AG_TYPE_TRAVERSALARRAY))
 
 
 #endif
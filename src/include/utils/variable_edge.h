@@ -33,7 +33,9 @@
 
 #include "catalog/ag_namespace.h"
 #include "catalog/pg_type.h"
+#include "utils/ag_cache.h"
 #include "utils/graphid.h"
+#include "utils/traversal.h"
 
 /* Convenience macros */
 #define DATUM_GET_VARIABLE_EDGE(d) ((vertex *)PG_DETOAST_DATUM(d))
@@ -55,10 +57,23 @@ typedef struct
     prentry children[FLEXIBLE_ARRAY_MEMBER];
 } VariableEdge;
 
-#define VARIABLEEDGEOID \
-    (GetSysCacheOid2(TYPENAMENSP, Anum_pg_type_oid, CStringGetDatum("variable_edge"), ObjectIdGetDatum(postgraph_namespace_id())))
+/*
+ * Laid out like a traversal, but starting and ending with an edge: the count
+ * and, when VARIABLE_EDGE_HAS_OFFSETS is set, a table of the entities' byte
+ * offsets from the start of the VariableEdge. Repeated vertices share one
+ * copy.
+ */
+#define VARIABLE_EDGE_COUNT_MASK  0x7FFFFFFF
+#define VARIABLE_EDGE_HAS_OFFSETS 0x80000000
+
+#define VARIABLE_EDGE_SIZE(v) ((v)->children[0] & VARIABLE_EDGE_COUNT_MASK)
+
+char *get_variable_edge_entity(VariableEdge *v, int i);
+void init_variable_edge(path_builder *pb, int count);
+void append_variable_edge_entity(path_builder *pb, int i, char *entity);
+
+#define VARIABLEEDGEOID (search_type_oid_cache(AG_TYPE_VARIABLEEDGE))
 
-#define VARIABLEEDGEARRAYOID \
-    (GetSysCacheOid2(TYPENAMENSP, Anum_pg_type_oid, CStringGetDatum("_variable_edge"), ObjectIdGetDatum(postgraph_namespace_id())))
+#define VARIABLEEDGEARRAYOID (search_type_oid_cache(AG_TYPE_VARIABLEEDGEARRAY))
 
 #endif
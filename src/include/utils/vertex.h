@@ -45,6 +45,7 @@
 
 #include "catalog/ag_namespace.h"
 #include "catalog/pg_type.h"
+#include "utils/ag_cache.h"
 #include "utils/graphid.h"
 #include "utils/gtype.h"
 
@@ -60,6 +61,13 @@ typedef uint32 ventry;
 #define EXTRACT_VERTEX_ID(v) \
     (*((int64 *)(&((vertex *)v)->children[0])))
 
+/*
+ * The graph oid is kept in every vertex even though the label id is in the
+ * graphid: a vertex can outlive the cypher() call that made it (stored in a
+ * table, or built with build_vertex()), and vertex_out has no query state to
+ * find the graph in. Resolving the label from it is an array lookup in
+ * search_label_name_array_cache().
+ */
 #define EXTRACT_VERTEX_GRAPH_OID(v) \
     (*((Oid *)(&((vertex *)v)->children[2])))
 
@@ -81,10 +89,8 @@ Datum build_vertex(PG_FUNCTION_ARGS);
 vertex *create_vertex(graphid id, Oid graph_oid, gtype *properties);	
 int extract_vertex_label_length(vertex *v);
 
-#define VERTEXOID \
-    (GetSysCacheOid2(TYPENAMENSP, Anum_pg_type_oid, CStringGetDatum("vertex"), ObjectIdGetDatum(postgraph_namespace_id())))
+#define VERTEXOID (search_type_oid_cache(AG_TYPE_VERTEX))
 
-#define VERTEXARRAYOID \
-    (GetSysCacheOid2(TYPENAMENSP, Anum_pg_type_oid, CStringGetDatum("_vertex"), ObjectIdGetDatum(postgraph_namespace_id())))
+#define VERTEXARRAYOID (search_type_oid_cache(AG_TYPE_VERTEXARRAY))
 
 #endif